@@ -14,13 +14,274 @@
 
 #ifdef DEFERRED_APPLY_DEBUG
 #include <cxxabi.h>   // for abi::__cxa_deferred_apply_internal::demangle
+
+#include <cstdio>
+#include <typeinfo>
 #endif
 
+#include <cstddef>
 #include <cstdlib>
 #include <memory>
+#include <new>
+#include <stdexcept>
 #include <tuple>
 #include <type_traits>
 #include <utility>
+#if __cplusplus >= 201703L
+#include <optional>
+#endif
+
+/**
+ * @brief Placeholders that put arguments given to apply() at any position of the bound arguments
+ *
+ * Example of use:
+ * @code {.cpp}
+ * using namespace deferred_apply_placeholders;
+ * auto da = make_deferred_apply( f, _2, a, _1 );
+ * da.apply( x, y );   // f( y, a, x )
+ * @endcode
+ *
+ * A placeholder is an empty class, and it is held by value. Therefore, it takes no storage in the held arguments,
+ * and the argument to be applied is resolved at compile time.
+ *
+ * @brief apply()に渡した引数を、保持している引数の任意の位置に配置するためのプレースホルダ
+ *
+ * プレースホルダは空のクラスであり、値として保持される。そのため、保持している引数の領域を使用せず、
+ * 適用する引数はコンパイル時に決定される。
+ */
+namespace deferred_apply_placeholders {
+
+template <size_t N>
+struct placeholder {
+	static_assert( N > 0, "the index of placeholder starts from 1" );
+};
+
+constexpr placeholder<1> _1 {};
+constexpr placeholder<2> _2 {};
+constexpr placeholder<3> _3 {};
+constexpr placeholder<4> _4 {};
+constexpr placeholder<5> _5 {};
+constexpr placeholder<6> _6 {};
+constexpr placeholder<7> _7 {};
+constexpr placeholder<8> _8 {};
+
+}   // namespace deferred_apply_placeholders
+
+/**
+ * @brief 例外を使用できるかどうか。-fno-exceptionsでビルドした場合は0となる。
+ */
+#ifndef DEFERRED_APPLY_HAS_EXCEPTIONS
+#if defined( __cpp_exceptions ) || defined( __EXCEPTIONS )
+#define DEFERRED_APPLY_HAS_EXCEPTIONS 1
+#else
+#define DEFERRED_APPLY_HAS_EXCEPTIONS 0
+#endif
+#endif
+
+/**
+ * @brief 例外を使用できない場合に、コピーできない関数と引数をコピーしようとした際などに呼び出されるハンドラの型
+ *
+ * ハンドラから戻った場合は、std::abort()を呼び出す。
+ */
+using deferred_apply_error_handler_t = void ( * )( const char* p_what );
+
+namespace deferred_apply_internal {
+
+inline deferred_apply_error_handler_t& error_handler( void )
+{
+	static deferred_apply_error_handler_t handler = nullptr;
+	return handler;
+}
+
+/**
+ * @brief 例外Eを送出する。例外を使用できない場合は、エラーハンドラを呼び出してからstd::abort()を呼び出す。
+ */
+template <typename E>
+[[noreturn]] inline void raise_error( void )
+{
+#if DEFERRED_APPLY_HAS_EXCEPTIONS
+	throw( E() );
+#else
+	deferred_apply_error_handler_t handler = error_handler();
+	if ( handler != nullptr ) {
+		handler( E().what() );
+	}
+	std::abort();
+#endif
+}
+
+}   // namespace deferred_apply_internal
+
+/**
+ * @brief 例外を使用できない場合のエラーハンドラを設定する
+ *
+ * 例外を使用できる場合は、ハンドラは呼び出されず、例外が送出される。
+ * スレッドセーフではないため、deferred_applyを使用する前に設定すること。
+ *
+ * @return 以前に設定されていたハンドラ。未設定の場合はnullptr
+ */
+inline deferred_apply_error_handler_t set_deferred_apply_error_handler( deferred_apply_error_handler_t handler )
+{
+	deferred_apply_error_handler_t old_handler = deferred_apply_internal::error_handler();
+	deferred_apply_internal::error_handler()   = handler;
+	return old_handler;
+}
+
+/**
+ * @brief deferred_applyが、内部バッファに収まらない関数と引数を配置する領域を確保する関数の型
+ *
+ * 確保できない場合は、std::bad_allocを送出するか、処理を終了すること。
+ */
+using deferred_apply_allocate_t = void* ( * )( size_t size );
+
+/**
+ * @brief deferred_apply_allocate_tで確保した領域を解放する関数の型
+ *
+ * sizeには、確保時に指定したサイズが渡される。
+ */
+using deferred_apply_deallocate_t = void ( * )( void* p, size_t size );
+
+/**
+ * @brief deferred_applyが、内部バッファに収まらない関数と引数の配置に使用するアロケータ
+ */
+struct deferred_apply_heap_allocator {
+	deferred_apply_allocate_t   allocate_;
+	deferred_apply_deallocate_t deallocate_;
+};
+
+namespace deferred_apply_internal {
+
+inline void* default_heap_allocate( size_t size )
+{
+	return ::operator new( size );
+}
+
+inline void default_heap_deallocate( void* p, size_t )
+{
+	::operator delete( p );
+}
+
+inline deferred_apply_heap_allocator& heap_allocator( void )
+{
+	static deferred_apply_heap_allocator allocator = { default_heap_allocate, default_heap_deallocate };
+	return allocator;
+}
+
+/**
+ * @brief 確保した領域の先頭に置く、解放関数を記録するヘッダ
+ *
+ * アロケータを差し替えても、確保時のアロケータで解放できるようにする。
+ * 後ろに配置するコンテナのアライメントを保つため、ヘッダのサイズはstd::max_align_tのアライメントとする。
+ */
+union heap_block_header {
+	deferred_apply_deallocate_t deallocate_;
+	std::max_align_t            padding_;
+};
+
+inline void* heap_allocate( size_t size )
+{
+	deferred_apply_heap_allocator cur_allocator = heap_allocator();
+
+	heap_block_header* p_header = static_cast<heap_block_header*>( cur_allocator.allocate_( sizeof( heap_block_header ) + size ) );
+	p_header->deallocate_       = cur_allocator.deallocate_;
+	return p_header + 1;
+}
+
+inline void heap_deallocate( void* p, size_t size ) noexcept
+{
+	if ( p == nullptr ) return;
+
+	heap_block_header* p_header = static_cast<heap_block_header*>( p ) - 1;
+	p_header->deallocate_( p_header, sizeof( heap_block_header ) + size );
+}
+
+}   // namespace deferred_apply_internal
+
+/**
+ * @brief deferred_applyが、内部バッファに収まらない関数と引数の配置に使用するアロケータを設定する
+ *
+ * 構築とコピーの両方で使用される。確保した領域は、差し替え後も確保時のアロケータで解放される。
+ * スレッドセーフではないため、deferred_applyを使用する前に設定すること。
+ *
+ * @return 以前に設定されていたアロケータ
+ */
+inline deferred_apply_heap_allocator set_deferred_apply_heap_allocator( deferred_apply_heap_allocator allocator )
+{
+	deferred_apply_heap_allocator old_allocator = deferred_apply_internal::heap_allocator();
+	deferred_apply_internal::heap_allocator()   = allocator;
+	return old_allocator;
+}
+
+/**
+ * @brief 保持している引数の、保持方式
+ */
+enum class deferred_argument_storage {
+	reference,     //!< 左辺値参照として保持する。値はコピーされない
+	pointer,       //!< ポインタとして保持する。配列型と関数型も、decayしてポインタとして保持する
+	owned_value,   //!< 値をムーブ、あるいはコピーして保持する
+	placeholder,   //!< プレースホルダ。値は保持しない
+	lazy,          //!< deferred_lazy()で生成した、適用時に評価する引数
+};
+
+/**
+ * @brief deferred_applyが、関数と引数を保持するコンテナを配置している領域
+ */
+enum class deferred_apply_storage_mode {
+	empty,           //!< 関数と引数を保持していない
+	inline_buffer,   //!< 内部バッファに配置している
+	heap,            //!< 内部バッファに収まらないため、ヒープに配置している
+};
+
+/**
+ * @brief Layout of the function and arguments held by deferred_apply or deferred_applying_arguments
+ *
+ * Example of use:
+ * @code {.cpp}
+ * deferred_apply_introspection info = da.introspect();
+ * if ( ( info.storage_mode == deferred_apply_storage_mode::heap ) || ( info.number_of_references() > 0 ) ) {
+ *     report( info.storage_size, info.storage_align );
+ * }
+ * @endcode
+ *
+ * All values except storage_mode are determined at compile time. Therefore, getting this information does not allocate,
+ * and it is available without DEFERRED_APPLY_DEBUG.
+ *
+ * @brief deferred_apply、あるいはdeferred_applying_argumentsが保持する関数と引数の配置情報
+ *
+ * storage_mode以外の値は、すべてコンパイル時に決定される。そのため、本情報の取得でメモリ確保は発生せず、
+ * DEFERRED_APPLY_DEBUGを定義しなくても使用できる。
+ */
+struct deferred_apply_introspection {
+	deferred_apply_storage_mode      storage_mode;          //!< 関数と引数を配置している領域
+	size_t                           storage_size;          //!< 関数と引数を保持している領域のサイズ[byte]
+	size_t                           storage_align;         //!< 関数と引数を保持している領域のアライメント[byte]
+	bool                             copy_constructible;    //!< 関数と引数がコピー可能かどうか
+	bool                             move_constructible;    //!< 関数と引数がムーブ可能かどうか
+	size_t                           number_of_arguments;   //!< 保持している引数の数。プレースホルダも含む
+	const deferred_argument_storage* p_argument_storage;    //!< 先頭から順に、各引数の保持方式を示すnumber_of_arguments個の配列
+
+	/**
+	 * @brief 保持方式がkindである引数の数
+	 */
+	size_t number_of_arguments_stored_as( deferred_argument_storage kind ) const
+	{
+		size_t ans = 0;
+		for ( size_t i = 0; i < number_of_arguments; i++ ) {
+			if ( p_argument_storage[i] == kind ) {
+				ans++;
+			}
+		}
+		return ans;
+	}
+
+	/**
+	 * @brief 左辺値参照として保持している引数の数。0でない場合は、ダングリング参照となる可能性がある
+	 */
+	size_t number_of_references( void ) const
+	{
+		return number_of_arguments_stored_as( deferred_argument_storage::reference );
+	}
+};
 
 namespace deferred_apply_internal {
 
@@ -48,69 +309,113 @@ struct my_index_sequence {
 };
 
 namespace internal {
-template <std::size_t I, std::size_t... Is>
-struct S : S<I - 1, I - 1, Is...> {
+template <typename S1, typename S2>
+struct concat_index_sequence;
+
+template <std::size_t... I1, std::size_t... I2>
+struct concat_index_sequence<my_index_sequence<I1...>, my_index_sequence<I2...>> {
+	using type = my_index_sequence<I1..., ( sizeof...( I1 ) + I2 )...>;
 };
 
-template <std::size_t... Is>
-struct S<0, Is...> {
-	my_index_sequence<Is...> f();
+// 半分ずつに分割して連結することで、再帰の深さとインスタンス化の数をNに対して対数オーダーに抑える
+template <std::size_t N>
+struct make_index_sequence_impl
+  : public concat_index_sequence<typename make_index_sequence_impl<N / 2>::type, typename make_index_sequence_impl<N - N / 2>::type> {
+};
+
+template <>
+struct make_index_sequence_impl<0> {
+	using type = my_index_sequence<>;
+};
+
+template <>
+struct make_index_sequence_impl<1> {
+	using type = my_index_sequence<0>;
 };
 }   // namespace internal
 
 template <std::size_t N>
-using my_make_index_sequence = decltype( internal::S<N> {}.f() );
+using my_make_index_sequence = typename internal::make_index_sequence_impl<N>::type;
 
 #endif
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 /**
- * @brief 引数を保持するためのtuple用の型を求めるメタ関数の実装クラス
+ * @brief Tがプレースホルダ_Nならば、Nを値とするメタ関数。そうでなければ0。
  */
-struct get_argument_store_type_impl {
-	// 配列型ではなく、かつ右辺値参照の場合、引数の値を保持する必要があるため、参照を外した型を返す。
-	template <typename T>
-	static auto check( T x ) -> typename std::enable_if<
-		std::is_rvalue_reference<T>::value && !std::is_pointer<typename std::decay<T>::type>::value,
-		typename std::remove_reference<T>::type>::type;
+template <typename T>
+struct is_placeholder : public std::integral_constant<size_t, 0> {
+};
 
-	// 配列型は、関数テンプレートと同じ推測を適用してた型に変換して返す。
-	template <typename T>
-	static auto check( T x ) -> typename std::enable_if<
-		std::is_pointer<typename std::decay<T>::type>::value,
-		typename std::decay<T>::type>::type;
+template <size_t N>
+struct is_placeholder<deferred_apply_placeholders::placeholder<N>> : public std::integral_constant<size_t, N> {
+};
+
+template <bool Cached, typename G, typename... Args>
+class lazy_argument;
+
+/**
+ * @brief Tが、deferred_lazy()あるいはdeferred_lazy_cached()で生成した遅延評価の引数かどうかを求めるメタ関数
+ */
+template <typename T>
+struct is_lazy_argument : public std::false_type {
+};
 
-	// 上記以外は、左辺値参照型となるため、そのまま型を返す。
-	template <typename T>
-	static auto check( ... ) -> T;
+template <bool Cached, typename G, typename... Args>
+struct is_lazy_argument<lazy_argument<Cached, G, Args...>> : public std::true_type {
 };
 
 /**
- * @brief 引数を保持するためのtuple用の型を求めるメタ関数
- *
- * @li Tが配列型ではなく、かつ左辺値参照の場合に、左辺値参照を型として返す。
- * @li Tが配列型ならば、型Tの要素型のポインタ型を返す（decayを適用する）
- * @li Tが上記以外なら右辺値参照となる。引数を保持する必要があるため、参照を外した型を返す。
+ * @brief 戻り値の型を求めるために、遅延評価の引数を評価結果の型に置き換えるメタ関数
  */
+template <typename T, bool IsLazy = is_lazy_argument<typename std::decay<T>::type>::value>
+struct lazy_substituted_type {
+	using type = T;
+};
+
 template <typename T>
-struct get_argument_store_type {
-	using type = decltype( get_argument_store_type_impl::check<T>( std::declval<T>() ) );
+struct lazy_substituted_type<T, true> {
+	using type = typename std::decay<T>::type::template get_result<false>::type;
+};
+
+template <bool...>
+struct bool_pack {
 };
 
 /**
- * @brief deferred_apply_internal::get_argument_store_type<>で保持した実引数を、関数に適用するための型を求めるメタ関数の実装
+ * @brief Ts...のいずれかの型がプレースホルダかどうかを求めるメタ関数
  *
+ * 引数の数に比例した再帰的なインスタンス化を避けるため、bool_packの比較で求める。
  */
-struct get_argument_apply_type_impl {
-	template <typename T, typename U>
-	static auto check( T x, U y ) -> typename std::enable_if<std::is_rvalue_reference<T>::value, typename std::add_rvalue_reference<U>::type>::type;
-
-	template <typename T, typename U>
-	static auto check( T x, U y ) -> typename std::enable_if<std::is_lvalue_reference<T>::value, typename std::add_lvalue_reference<U>::type>::type;
+template <typename... Ts>
+struct contains_placeholder
+  : public std::integral_constant<
+		bool,
+		!std::is_same<
+			bool_pack<true, ( is_placeholder<typename std::decay<Ts>::type>::value == 0 )...>,
+			bool_pack<( is_placeholder<typename std::decay<Ts>::type>::value == 0 )..., true>>::value> {
+};
 
-	// 上記以外は、そのまま型を返す
-	template <typename T, typename U>
-	static auto check( ... ) -> U;
+////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief 引数を保持するためのtuple用の型を求めるメタ関数
+ *
+ * @li Tがプレースホルダならば、参照を外した空のクラスを返す。
+ * @li Tが配列型ならば、型Tの要素型のポインタ型を返す（decayを適用する）。ポインタ型と関数型も同様。
+ * @li Tが上記以外で、右辺値参照の場合は、引数の値を保持する必要があるため、参照を外した型を返す。
+ * @li Tが上記以外で、左辺値参照の場合は、左辺値参照を型として返す。
+ *
+ * 引数毎にインスタンス化されるため、オーバーロード解決を使わずにstd::conditionalだけで求める。
+ */
+template <typename T, typename D = typename std::decay<T>::type>
+struct get_argument_store_type {
+	using type = typename std::conditional<
+		std::is_pointer<D>::value || ( is_placeholder<D>::value != 0 ),
+		D,
+		typename std::conditional<
+			std::is_rvalue_reference<T>::value,
+			typename std::remove_reference<T>::type,
+			T>::type>::type;
 };
 
 /**
@@ -125,9 +430,286 @@ struct get_argument_apply_type_impl {
  */
 template <typename T, typename U>
 struct get_argument_apply_type {
-	using type = decltype( get_argument_apply_type_impl::check<T, U>( std::declval<T>(), std::declval<U>() ) );
+	using type = typename std::conditional<
+		std::is_rvalue_reference<T>::value,
+		typename std::add_rvalue_reference<U>::type,
+		typename std::conditional<
+			std::is_lvalue_reference<T>::value,
+			typename std::add_lvalue_reference<U>::type,
+			U>::type>::type;
+};
+
+/**
+ * @brief deferred_apply_internal::get_argument_store_type<>で保持した実引数を、コピーして関数に適用するための型を求めるメタ関数
+ *
+ * Tが右辺値参照の場合、保持している値をムーブせずにコピーして渡すため、Uを返す。
+ * それ以外の場合は、get_argument_apply_type<T, U>::type と同じ型を返す。
+ *
+ * @tparam T もととなった引数の型
+ * @tparam U 引数を保持するための型
+ */
+template <typename T, typename U>
+struct get_argument_copy_type {
+	using type = typename std::conditional<
+		std::is_rvalue_reference<T>::value,
+		U,
+		typename get_argument_apply_type<T, U>::type>::type;
+};
+
+/**
+ * @brief 保持した実引数、あるいはプレースホルダに対応するapply()の引数を取り出すクラス
+ *
+ * @tparam T もととなった引数の型
+ * @tparam S 引数を保持するための型
+ */
+template <typename T,
+          typename S         = typename get_argument_store_type<T>::type,
+          bool IsPlaceholder = ( is_placeholder<S>::value != 0 ),
+          bool IsLazy        = is_lazy_argument<typename std::decay<S>::type>::value>
+struct bound_argument {
+	/**
+	 * @tparam Copy trueの場合、右辺値として保持している値をムーブせずにコピーして渡す
+	 * @tparam ExtraTuple apply()に渡された引数の参照のstd::tuple
+	 */
+	template <bool Copy, typename ExtraTuple>
+	struct result {
+		using type = typename std::conditional<
+			Copy,
+			typename get_argument_copy_type<T, S>::type,
+			typename get_argument_apply_type<T, S>::type>::type;
+	};
+
+	/**
+	 * @brief get()が例外を送出しないかどうか。値のコピーによる例外は、deferred_applying_argumentsで考慮する
+	 */
+	template <bool Copy>
+	struct is_nothrow_get : public std::true_type {
+	};
+
+	template <bool Copy, typename ExtraTuple>
+	static typename result<Copy, ExtraTuple>::type get( S& stored, ExtraTuple& )
+	{
+		return static_cast<typename result<Copy, ExtraTuple>::type>( stored );
+	}
+
+	/**
+	 * @brief 保持している値を、コピーもムーブもせずに左辺値として渡す場合の型
+	 */
+	template <typename ExtraTuple>
+	struct lvalue_result {
+		using type = typename std::add_lvalue_reference<S>::type;
+	};
+
+	template <typename ExtraTuple>
+	static typename lvalue_result<ExtraTuple>::type get_lvalue( S& stored, ExtraTuple& )
+	{
+		return stored;
+	}
 };
 
+template <typename T, typename S>
+struct bound_argument<T, S, true, false> {
+	template <bool Copy, typename ExtraTuple>
+	struct result {
+		static_assert( is_placeholder<S>::value <= std::tuple_size<ExtraTuple>::value, "placeholder index exceeds the number of arguments given to apply()" );
+		using type = typename std::tuple_element<is_placeholder<S>::value - 1, ExtraTuple>::type&&;
+	};
+
+	template <bool Copy>
+	struct is_nothrow_get : public std::true_type {
+	};
+
+	template <bool Copy, typename ExtraTuple>
+	static typename result<Copy, ExtraTuple>::type get( S&, ExtraTuple& extra )
+	{
+		return static_cast<typename result<Copy, ExtraTuple>::type>( std::get<is_placeholder<S>::value - 1>( extra ) );
+	}
+
+	template <typename ExtraTuple>
+	struct lvalue_result : public result<false, ExtraTuple> {
+	};
+
+	template <typename ExtraTuple>
+	static typename lvalue_result<ExtraTuple>::type get_lvalue( S& stored, ExtraTuple& extra )
+	{
+		return get<false>( stored, extra );
+	}
+};
+
+/**
+ * @brief 遅延評価の引数を、適用時に評価して取り出す
+ */
+template <typename T, typename S>
+struct bound_argument<T, S, false, true> {
+	using lazy_t = typename std::decay<S>::type;
+
+	template <bool Copy, typename ExtraTuple>
+	struct result {
+		using type = typename lazy_t::template get_result<Copy>::type;
+	};
+
+	template <bool Copy>
+	struct is_nothrow_get : public std::integral_constant<bool, lazy_t::template is_nothrow_get<Copy>::value> {
+	};
+
+	template <bool Copy, typename ExtraTuple>
+	static typename result<Copy, ExtraTuple>::type get( S& stored, ExtraTuple& )
+	{
+		return stored.template get<Copy>();
+	}
+
+	// 左辺値として渡す場合も、繰り返し評価できるように、引数をコピーして評価する
+	template <typename ExtraTuple>
+	struct lvalue_result : public result<true, ExtraTuple> {
+	};
+
+	template <typename ExtraTuple>
+	static typename lvalue_result<ExtraTuple>::type get_lvalue( S& stored, ExtraTuple& )
+	{
+		return stored.template get<true>();
+	}
+};
+
+/**
+ * @brief deferred_applying_arguments<OrigArgs...>::apply( f, extra... )の戻り値の型を求めるメタ関数
+ *
+ * @tparam Copy trueの場合、右辺値として保持している値をコピーして渡す
+ * @tparam ExtraTuple apply()に渡された引数の参照のstd::tuple
+ * @tparam TrailingSeq 保持している引数の後ろに追加するExtraTupleの要素のインデックスシーケンス
+ */
+template <bool Copy, typename F, typename OrigArgList, typename ExtraTuple, typename TrailingSeq>
+struct applying_result;
+
+template <bool Copy, typename F, typename... OrigArgs, typename ExtraTuple, size_t... Js>
+struct applying_result<Copy, F, std::tuple<OrigArgs...>, ExtraTuple, my_index_sequence<Js...>> {
+	using type = typename std::result_of<F(
+		typename bound_argument<OrigArgs>::template result<Copy, ExtraTuple>::type...,
+		typename std::tuple_element<Js, ExtraTuple>::type... )>::type;
+};
+
+/**
+ * @brief deferred_applying_arguments<OrigArgs...>::apply_lvalue( f, extra... )の戻り値の型を求めるメタ関数
+ *
+ * テンプレートパラメータは、Copyを除きapplying_resultと同じ。
+ */
+template <typename F, typename OrigArgList, typename ExtraTuple, typename TrailingSeq>
+struct applying_lvalue_result;
+
+template <typename F, typename... OrigArgs, typename ExtraTuple, size_t... Js>
+struct applying_lvalue_result<F, std::tuple<OrigArgs...>, ExtraTuple, my_index_sequence<Js...>> {
+	using type = typename std::result_of<F(
+		typename bound_argument<OrigArgs>::template lvalue_result<ExtraTuple>::type...,
+		typename std::tuple_element<Js, ExtraTuple>::type... )>::type;
+};
+
+/**
+ * @brief deferred_applying_arguments<OrigArgs...>::apply( f, extra... )が例外を送出しないかどうかを求めるメタ関数
+ *
+ * テンプレートパラメータは、applying_resultと同じ。
+ */
+template <bool Copy, typename F, typename OrigArgList, typename ExtraTuple, typename TrailingSeq>
+struct is_nothrow_applying;
+
+template <bool Copy, typename F, typename... OrigArgs, typename ExtraTuple, size_t... Js>
+struct is_nothrow_applying<Copy, F, std::tuple<OrigArgs...>, ExtraTuple, my_index_sequence<Js...>>
+  : public std::integral_constant<
+		bool,
+		noexcept( std::declval<F&>()(
+			std::declval<typename bound_argument<OrigArgs>::template result<Copy, ExtraTuple>::type>()...,
+			std::declval<typename std::tuple_element<Js, ExtraTuple>::type>()... ) ) &&
+			std::is_same<
+				bool_pack<true, bound_argument<OrigArgs>::template is_nothrow_get<Copy>::value...>,
+				bool_pack<bound_argument<OrigArgs>::template is_nothrow_get<Copy>::value..., true>>::value> {
+};
+
+/**
+ * @brief Fの引数リストのうち、プレースホルダ_Nに対応する引数の型を求めるメタ関数
+ *
+ * @tparam N プレースホルダの番号
+ * @tparam ParamList Fの引数の型のstd::tuple
+ * @tparam ArgList 保持する引数の型のstd::tuple
+ */
+template <size_t N, typename ParamList, typename ArgList>
+struct placeholder_param {
+	// 対応する引数がない場合は、typeを定義しない
+};
+
+template <typename T>
+struct type_identity {
+	using type = T;
+};
+
+template <size_t N, typename P0, typename... Ps, typename A0, typename... As>
+struct placeholder_param<N, std::tuple<P0, Ps...>, std::tuple<A0, As...>>
+  : public std::conditional<
+		is_placeholder<typename std::decay<A0>::type>::value == N,
+		type_identity<P0>,
+		placeholder_param<N, std::tuple<Ps...>, std::tuple<As...>>>::type {
+};
+
+/**
+ * @brief Ts...に含まれるプレースホルダの最大の番号を求めるメタ関数
+ */
+template <typename... Ts>
+struct max_placeholder : public std::integral_constant<size_t, 0> {
+};
+
+template <typename T, typename... Ts>
+struct max_placeholder<T, Ts...> : public std::integral_constant<
+									   size_t,
+									   ( is_placeholder<typename std::decay<T>::type>::value > max_placeholder<Ts...>::value )
+										   ? is_placeholder<typename std::decay<T>::type>::value
+										   : max_placeholder<Ts...>::value> {
+};
+
+/**
+ * @brief 関数型 R(Params...) の関数に、プレースホルダを含む引数Args...を保持した場合の、apply()のシグネチャを求めるメタ関数
+ *
+ * _1から_Nまでの各プレースホルダに対応するParamsの型を、apply()の引数の型とする。
+ */
+template <typename Sig, typename IndexSeq, typename... Args>
+struct placeholder_signature_impl;
+
+template <typename R, typename... Params, size_t... Is, typename... Args>
+struct placeholder_signature_impl<R( Params... ), my_index_sequence<Is...>, Args...> {
+	using type = R( typename placeholder_param<Is + 1, std::tuple<Params...>, std::tuple<Args...>>::type... );
+};
+
+template <typename Sig, typename... Args>
+struct placeholder_signature
+  : public placeholder_signature_impl<Sig, my_make_index_sequence<max_placeholder<Args...>::value>, Args...> {
+};
+
+/**
+ * @brief 引数の型Tを、get_argument_store_type<T>で保持する場合の保持方式を求めるメタ関数
+ */
+template <typename T, typename D = typename std::decay<T>::type>
+struct get_argument_storage
+  : public std::integral_constant<
+		deferred_argument_storage,
+		( is_placeholder<D>::value != 0 )
+			? deferred_argument_storage::placeholder
+			: ( is_lazy_argument<D>::value
+					? deferred_argument_storage::lazy
+					: ( std::is_pointer<D>::value
+							? deferred_argument_storage::pointer
+							: ( std::is_lvalue_reference<T>::value
+									? deferred_argument_storage::reference
+									: deferred_argument_storage::owned_value ) ) )> {
+};
+
+/**
+ * @brief 引数の型Ts...の保持方式の配列
+ */
+template <typename... Ts>
+struct argument_storage_table {
+	// 引数がない場合に要素数0の配列とならないよう、末尾に番兵を置く
+	static constexpr deferred_argument_storage value[sizeof...( Ts ) + 1] = { get_argument_storage<Ts>::value..., deferred_argument_storage::placeholder };
+};
+
+template <typename... Ts>
+constexpr deferred_argument_storage argument_storage_table<Ts...>::value[sizeof...( Ts ) + 1];
+
 }   // namespace deferred_apply_internal
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -147,6 +729,7 @@ struct get_argument_apply_type {
  * Whether reapplication of apply() is possible depends on how the arguments are passed or on the properties of f. @n
  * For example, if a is passed by rvalue reference, the value held in deferred_apply may be invalidated by f due to the first application of apply(). @n
  * Therefore, it is undefined whether the second apply() application is as intended.
+ * Use enable_repeatable_apply() and apply_final() to apply it repeatedly.
  *
  * @warning
  * Since it is intended for temporary retention, priority is given to efficiency, and lvalue referenced instances are retained as lvalue reference types and are not copied. @n
@@ -175,6 +758,7 @@ struct get_argument_apply_type {
  * apply()の再適用が可能かどうかは、引数をどのように渡したか、あるいはfの特性に依存する。 @n
  * 例えば、aが右辺値参照で引き渡された場合、1回目のapply()の適用によって、deferred_apply内で保持していた値が、fによって無効値となっている可能性がある。 @n
  * そのため、2回目のapply()適用が意図通りとなるかどうかは未定義となる。
+ * 繰り返し適用する場合は、enable_repeatable_apply()とapply_final()を使用すること。
  *
  * @warning
  * 一時的な保持を目的としているため、効率を優先し、左辺値参照されたインスタンスは左辺値参照型を保持する方式で、コピーしない。 @n
@@ -191,9 +775,29 @@ struct get_argument_apply_type {
  */
 template <typename... OrigArgs>
 class deferred_applying_arguments {
-	using tuple_args_t = std::tuple<typename deferred_apply_internal::get_argument_store_type<OrigArgs>::type...>;
+	using tuple_args_t      = std::tuple<typename deferred_apply_internal::get_argument_store_type<OrigArgs>::type...>;
+	using index_seq_t       = deferred_apply_internal::my_make_index_sequence<sizeof...( OrigArgs )>;
+
+	// プレースホルダを含まない場合は、apply()に渡された引数をすべて末尾に追加する
+	template <typename... Extra>
+	using trailing_seq_t = deferred_apply_internal::my_make_index_sequence<
+		deferred_apply_internal::contains_placeholder<OrigArgs...>::value ? 0 : sizeof...( Extra )>;
+
+	template <bool Copy, typename F, typename... Extra>
+	using applying_result = deferred_apply_internal::applying_result<Copy, F, std::tuple<OrigArgs...>, std::tuple<Extra&&...>, trailing_seq_t<Extra...>>;
+
+	template <bool Copy, typename F, typename... Extra>
+	using is_nothrow_applying = std::integral_constant<
+		bool,
+		deferred_apply_internal::is_nothrow_applying<Copy, F, std::tuple<OrigArgs...>, std::tuple<Extra&&...>, trailing_seq_t<Extra...>>::value &&
+			( !Copy || std::is_nothrow_copy_constructible<tuple_args_t>::value )>;
 
 public:
+	/**
+	 * @brief 引数を保持しているstd::tupleの型
+	 */
+	using stored_tuple_type = tuple_args_t;
+
 	deferred_applying_arguments( void )
 	  : values_()
 	{
@@ -233,79 +837,522 @@ public:
 	{
 	}
 
-	template <typename F>
-#if __cpp_decltype_auto >= 201304
-	decltype( auto ) apply( F&& f )
+	/**
+	 * @brief 保持している引数と、末尾に追加する引数extra...をfに適用する
+	 *
+	 * f(保持している引数..., extra...) を呼び出す。
+	 * 保持している引数にプレースホルダ_Nが含まれる場合は、末尾には追加せず、_Nの位置にextra...のN番目の引数を適用する。
+	 * 右辺値として保持している値は、ムーブして渡す。
+	 * fの呼び出しが例外を送出しない場合は、noexceptとなる。
+	 */
+	template <typename F, typename... Extra>
+#if __cpp_decltype_auto >= 201304
+	decltype( auto ) apply( F&& f, Extra&&... extra ) noexcept( is_nothrow_applying<false, F, Extra...>::value )
+#else
+	auto apply( F&& f, Extra&&... extra ) noexcept( is_nothrow_applying<false, F, Extra...>::value ) -> typename applying_result<false, F, Extra...>::type
+#endif
+	{
+		return apply_impl<false>( std::forward<F>( f ), index_seq_t(), trailing_seq_t<Extra...>(), std::tuple<Extra&&...>( std::forward<Extra>( extra )... ) );
+	}
+
+	/**
+	 * @brief apply()と同じく引数を適用するが、右辺値として保持している値はムーブせずに、コピーして渡す
+	 *
+	 * 保持している値は変更されないため、fが引数をムーブしても、繰り返し適用することができる。
+	 * 保持している値がコピーできない場合は、コンパイルエラーとなる。
+	 */
+	template <typename F, typename... Extra>
+#if __cpp_decltype_auto >= 201304
+	decltype( auto ) apply_copy( F&& f, Extra&&... extra ) noexcept( is_nothrow_applying<true, F, Extra...>::value )
+#else
+	auto apply_copy( F&& f, Extra&&... extra ) noexcept( is_nothrow_applying<true, F, Extra...>::value ) -> typename applying_result<true, F, Extra...>::type
+#endif
+	{
+		return apply_impl<true>( std::forward<F>( f ), index_seq_t(), trailing_seq_t<Extra...>(), std::tuple<Extra&&...>( std::forward<Extra>( extra )... ) );
+	}
+
+	/**
+	 * @brief apply()と同じく引数を適用するが、右辺値として保持している値も、コピーもムーブもせずに左辺値として渡す
+	 *
+	 * 引数を値として受け取らないfであれば、繰り返し適用しても保持している値のコピーが発生しない。
+	 * fが右辺値参照で受け取る引数がある場合は、コンパイルエラーとなる。
+	 */
+	template <typename F, typename... Extra>
+#if __cpp_decltype_auto >= 201304
+	decltype( auto ) apply_lvalue( F&& f, Extra&&... extra )
+#else
+	auto apply_lvalue( F&& f, Extra&&... extra ) -> typename deferred_apply_internal::applying_lvalue_result<F, std::tuple<OrigArgs...>, std::tuple<Extra&&...>, trailing_seq_t<Extra...>>::type
+#endif
+	{
+		return apply_lvalue_impl( std::forward<F>( f ), index_seq_t(), trailing_seq_t<Extra...>(), std::tuple<Extra&&...>( std::forward<Extra>( extra )... ) );
+	}
+
+	/**
+	 * @brief 保持している引数を参照する
+	 *
+	 * 要素毎のハッシュ値の計算や比較など、保持している値そのものを扱う場合に使用する。
+	 */
+	const stored_tuple_type& stored_values( void ) const noexcept
+	{
+		return values_;
+	}
+
+	/**
+	 * @brief 保持している引数の数。プレースホルダも含む
+	 */
+	static constexpr size_t number_of_arguments = sizeof...( OrigArgs );
+
+	/**
+	 * @brief I番目の引数の保持方式を求めるメタ関数
+	 */
+	template <size_t I>
+	struct argument_storage
+	  : public deferred_apply_internal::get_argument_storage<typename std::tuple_element<I, std::tuple<OrigArgs...>>::type> {
+	};
+
+	/**
+	 * @brief 保持している引数のレイアウト情報を返す
+	 *
+	 * storage_modeは、常にdeferred_apply_storage_mode::inline_bufferとなる。
+	 */
+	static constexpr deferred_apply_introspection introspect( void )
+	{
+		return deferred_apply_introspection {
+			deferred_apply_storage_mode::inline_buffer,
+			sizeof( tuple_args_t ),
+			alignof( tuple_args_t ),
+			std::is_copy_constructible<tuple_args_t>::value,
+			std::is_move_constructible<tuple_args_t>::value,
+			sizeof...( OrigArgs ),
+			deferred_apply_internal::argument_storage_table<OrigArgs...>::value };
+	}
+
+#ifdef DEFERRED_APPLY_DEBUG
+	void debug_type_info( void )
+	{
+		printf( "Called constructor of deferred_applying_arguments\n" );
+		printf( "\tthis class: %s\n", deferred_apply_internal::demangle( typeid( *this ).name() ) );
+		printf( "\tvalues_: %s\n", deferred_apply_internal::demangle( typeid( values_ ).name() ) );
+		printf( "\tvalues_ is copy constructible ?: %s\n", std::is_copy_constructible<tuple_args_t>::value ? "true" : "false" );
+	}
+
+	template <typename F>
+	void debug_apply_type_info( F&& f )
+	{
+		printf( "f: %s\n", deferred_apply_internal::demangle( typeid( f ).name() ) );
+		printf( "apply_impl: %s\n", deferred_apply_internal::demangle( typeid( decltype( apply( std::forward<F>( f ) ) ) ).name() ) );
+	}
+#endif
+
+private:
+	// 保持している引数(プレースホルダの場合はextra_tupleの対応する要素)の後ろに、extra_tupleのJs...番目の要素を追加して適用する
+	template <bool Copy, typename F, size_t... Is, size_t... Js, typename ExtraTuple>
+#if __cpp_decltype_auto >= 201304
+	decltype( auto ) apply_impl( F&& f, deferred_apply_internal::my_index_sequence<Is...>, deferred_apply_internal::my_index_sequence<Js...>, ExtraTuple&& extra_tuple )
+#else
+	auto apply_impl( F&& f, deferred_apply_internal::my_index_sequence<Is...>, deferred_apply_internal::my_index_sequence<Js...>, ExtraTuple&& extra_tuple )
+		-> typename deferred_apply_internal::applying_result<Copy, F, std::tuple<OrigArgs...>, typename std::remove_reference<ExtraTuple>::type, deferred_apply_internal::my_index_sequence<Js...>>::type
+#endif
+	{
+		using extra_tuple_t = typename std::remove_reference<ExtraTuple>::type;
+		return f( deferred_apply_internal::bound_argument<OrigArgs>::template get<Copy>( std::get<Is>( values_ ), extra_tuple )...,
+		          static_cast<typename std::tuple_element<Js, extra_tuple_t>::type>( std::get<Js>( extra_tuple ) )... );
+	}
+
+	template <typename F, size_t... Is, size_t... Js, typename ExtraTuple>
+#if __cpp_decltype_auto >= 201304
+	decltype( auto ) apply_lvalue_impl( F&& f, deferred_apply_internal::my_index_sequence<Is...>, deferred_apply_internal::my_index_sequence<Js...>, ExtraTuple&& extra_tuple )
+#else
+	auto apply_lvalue_impl( F&& f, deferred_apply_internal::my_index_sequence<Is...>, deferred_apply_internal::my_index_sequence<Js...>, ExtraTuple&& extra_tuple )
+		-> typename deferred_apply_internal::applying_lvalue_result<F, std::tuple<OrigArgs...>, typename std::remove_reference<ExtraTuple>::type, deferred_apply_internal::my_index_sequence<Js...>>::type
+#endif
+	{
+		using extra_tuple_t = typename std::remove_reference<ExtraTuple>::type;
+		return f( deferred_apply_internal::bound_argument<OrigArgs>::get_lvalue( std::get<Is>( values_ ), extra_tuple )...,
+		          static_cast<typename std::tuple_element<Js, extra_tuple_t>::type>( std::get<Js>( extra_tuple ) )... );
+	}
+
+	tuple_args_t values_;
+};
+
+template <typename... OrigArgs>
+constexpr size_t deferred_applying_arguments<OrigArgs...>::number_of_arguments;
+
+template <class... Args>
+auto make_deferred_applying_arguments( Args&&... args ) -> deferred_applying_arguments<Args&&...>
+{
+	return deferred_applying_arguments<Args&&...>( std::forward<Args>( args )... );
+}
+
+/**
+ * @brief 引数をすべて値として保持するdeferred_applying_argumentsを生成するヘルパ関数
+ *
+ * make_deferred_applying_arguments()とは異なり、左辺値の引数も参照ではなくコピーして保持する。
+ * そのため、生成したスコープの外や他のスレッドに持ち出しても、引数がダングリング参照とはならない。
+ * 保持した値は、apply()の適用時に右辺値として関数に渡される。
+ *
+ * @warning
+ * 配列型と関数型は、make_deferred_applying_arguments()と同様にポインタとして保持する。
+ * ポインタが指す先はコピーされないため、文字列リテラルなどの静的な領域以外を指すポインタはダングリングとなる可能性がある。
+ *
+ * @return deferred_applying_arguments<std::decay<Args>::type&&...>のインスタンス
+ */
+template <class... Args>
+auto make_deferred_applying_values( Args&&... args ) -> deferred_applying_arguments<typename std::decay<Args>::type&&...>
+{
+	return deferred_applying_arguments<typename std::decay<Args>::type&&...>( std::forward<Args>( args )... );
+}
+
+namespace deferred_apply_internal {
+
+/**
+ * @brief 遅延評価した値を保持する領域。std::optionalの代わり
+ *
+ * @tparam V 保持する値の型
+ */
+template <typename V, bool IsCopyConstructible = std::is_copy_constructible<V>::value>
+class lazy_cache {
+public:
+	lazy_cache( void )
+	  : has_value_( false )
+	{
+	}
+	lazy_cache( const lazy_cache& orig )
+	  : has_value_( false )
+	{
+		if ( orig.has_value_ ) {
+			emplace( orig.value() );
+		}
+	}
+	lazy_cache( lazy_cache&& orig )
+	  : has_value_( false )
+	{
+		if ( orig.has_value_ ) {
+			emplace( std::move( orig.value() ) );
+		}
+	}
+	~lazy_cache()
+	{
+		if ( has_value_ ) {
+			value().~V();
+		}
+	}
+
+	lazy_cache& operator=( const lazy_cache& ) = delete;
+	lazy_cache& operator=( lazy_cache&& )      = delete;
+
+	template <typename X>
+	void emplace( X&& x )
+	{
+		new ( &buff_ ) V( std::forward<X>( x ) );
+		has_value_ = true;
+	}
+
+	bool has_value( void ) const
+	{
+		return has_value_;
+	}
+
+	V& value( void )
+	{
+		return *reinterpret_cast<V*>( &buff_ );
+	}
+	const V& value( void ) const
+	{
+		return *reinterpret_cast<const V*>( &buff_ );
+	}
+
+private:
+	typename std::aligned_storage<sizeof( V ), alignof( V )>::type buff_;
+	bool                                                           has_value_;
+};
+
+// コピーできない値の場合は、保持する引数と同様にstd::is_copy_constructibleがfalseとなるように、コピーコンストラクタを削除する
+template <typename V>
+class lazy_cache<V, false> : public lazy_cache<V, true> {
+public:
+	lazy_cache( void )                         = default;
+	lazy_cache( const lazy_cache& )            = delete;
+	lazy_cache( lazy_cache&& )                 = default;
+	lazy_cache& operator=( const lazy_cache& ) = delete;
+	lazy_cache& operator=( lazy_cache&& )      = delete;
+};
+
+/**
+ * @brief 適用の都度、g(args...)を評価して引数とする遅延評価の引数
+ */
+template <typename G, typename... Args>
+class lazy_argument<false, G, Args...> {
+	using argkeeper_t = deferred_applying_arguments<Args...>;
+
+public:
+	using result_type = decltype( std::declval<argkeeper_t&>().apply( std::declval<G&>() ) );
+
+	template <bool Copy>
+	struct get_result {
+		using type = result_type;
+	};
+
+	template <bool Copy, typename Dummy = void>
+	struct is_nothrow_get : public std::integral_constant<bool, noexcept( std::declval<argkeeper_t&>().apply( std::declval<G&>() ) )> {
+	};
+	template <typename Dummy>
+	struct is_nothrow_get<true, Dummy> : public std::integral_constant<bool, noexcept( std::declval<argkeeper_t&>().apply_copy( std::declval<G&>() ) )> {
+	};
+
+	template <typename XG,
+	          typename... XArgs,
+	          typename std::enable_if<!std::is_same<typename std::decay<XG>::type, lazy_argument>::value>::type* = nullptr>
+	explicit lazy_argument( XG&& g, XArgs&&... args )
+	  : g_( std::forward<XG>( g ) )
+	  , args_( std::forward<XArgs>( args )... )
+	{
+	}
+
+	/**
+	 * @brief g(args...)を評価する
+	 *
+	 * @tparam Copy trueの場合は、繰り返し評価できるように、argsをコピーして渡す。falseの場合は、右辺値として保持しているargsをムーブして渡す。
+	 */
+	template <bool Copy>
+	result_type get( void )
+	{
+		return evaluate( std::integral_constant<bool, Copy>() );
+	}
+
+private:
+	result_type evaluate( std::true_type )
+	{
+		return args_.apply_copy( g_ );
+	}
+	result_type evaluate( std::false_type )
+	{
+		return args_.apply( g_ );
+	}
+
+	G           g_;
+	argkeeper_t args_;
+};
+
+/**
+ * @brief 最初の適用時にg(args...)を評価し、その結果を保持して以降の適用でも使用する遅延評価の引数
+ */
+template <typename G, typename... Args>
+class lazy_argument<true, G, Args...> {
+	using argkeeper_t = deferred_applying_arguments<Args...>;
+	using evaluated_t = decltype( std::declval<argkeeper_t&>().apply( std::declval<G&>() ) );
+
+public:
+	using value_type = typename std::decay<evaluated_t>::type;
+
+	/**
+	 * @brief 評価した値の取り出し方。Copyがfalseの場合は、保持している値と同様にムーブして渡す
+	 */
+	template <bool Copy>
+	struct get_result {
+		using type = typename std::conditional<Copy, value_type, value_type&&>::type;
+	};
+
+	template <bool Copy>
+	struct is_nothrow_get : public std::integral_constant<
+								bool,
+								noexcept( std::declval<argkeeper_t&>().apply( std::declval<G&>() ) ) &&
+									std::is_nothrow_constructible<value_type, evaluated_t>::value &&
+									( !Copy || std::is_nothrow_copy_constructible<value_type>::value )> {
+	};
+
+	template <typename XG,
+	          typename... XArgs,
+	          typename std::enable_if<!std::is_same<typename std::decay<XG>::type, lazy_argument>::value>::type* = nullptr>
+	explicit lazy_argument( XG&& g, XArgs&&... args )
+	  : g_( std::forward<XG>( g ) )
+	  , args_( std::forward<XArgs>( args )... )
+	  , cache_()
+	{
+	}
+
+	/**
+	 * @brief 最初の呼び出しでg(args...)を評価し、評価済みの値を返す
+	 */
+	template <bool Copy>
+	typename get_result<Copy>::type get( void )
+	{
+		if ( !cache_.has_value() ) {
+			cache_.emplace( args_.apply( g_ ) );
+		}
+		return static_cast<typename get_result<Copy>::type>( cache_.value() );
+	}
+
+	bool is_evaluated( void ) const
+	{
+		return cache_.has_value();
+	}
+
+private:
+	G                      g_;
+	argkeeper_t            args_;
+	lazy_cache<value_type> cache_;
+};
+
+}   // namespace deferred_apply_internal
+
+/**
+ * @brief Creates an argument that is evaluated as g(args...) only when apply() actually runs
+ *
+ * Example of use:
+ * @code {.cpp}
+ * auto da = make_deferred_apply( write_log, level, deferred_lazy( format_message, std::move( record ) ) );
+ * // format_message() is not called if da is dropped without apply()
+ * da.apply();   // write_log( level, format_message( record ) )
+ * @endcode
+ *
+ * g(args...) is evaluated at each apply(). Use deferred_lazy_cached() to evaluate it only once.
+ * g and args are held in the same way as make_deferred_applying_arguments(), so lvalue args are held as lvalue references.
+ *
+ * @brief apply()を実際に実行するときにだけ、g(args...)として評価される引数を生成する
+ *
+ * g(args...)は、apply()の都度評価される。一度だけ評価する場合は、deferred_lazy_cached()を使用すること。
+ * gとargsは、make_deferred_applying_arguments()と同じ方式で保持されるため、左辺値のargsは左辺値参照として保持される。
+ */
+template <typename G, typename... Args>
+auto deferred_lazy( G&& g, Args&&... args ) -> deferred_apply_internal::lazy_argument<false, typename std::decay<G>::type, Args&&...>
+{
+	return deferred_apply_internal::lazy_argument<false, typename std::decay<G>::type, Args&&...>( std::forward<G>( g ), std::forward<Args>( args )... );
+}
+
+/**
+ * @brief 最初のapply()の実行時に一度だけg(args...)として評価し、その結果を保持する引数を生成する
+ *
+ * 評価した値は、保持している値と同じく、apply()ではムーブして、繰り返し適用可能なモードではコピーして渡される。
+ */
+template <typename G, typename... Args>
+auto deferred_lazy_cached( G&& g, Args&&... args ) -> deferred_apply_internal::lazy_argument<true, typename std::decay<G>::type, Args&&...>
+{
+	return deferred_apply_internal::lazy_argument<true, typename std::decay<G>::type, Args&&...>( std::forward<G>( g ), std::forward<Args>( args )... );
+}
+
+namespace deferred_apply_internal {
+
+////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @brief deferred_applyのテンプレートパラメータRを、関数型のシグネチャに変換するメタ関数
+ *
+ * Rが関数型 R2(Extra...) の場合はそのまま、そうでない場合は R() とする。
+ */
+template <typename R>
+struct to_signature {
+	using type                       = R();
+	using result_type                = R;
+	static constexpr bool is_noexcept = false;
+};
+
+template <typename R, typename... Extra>
+struct to_signature<R( Extra... )> {
+	using type                       = R( Extra... );
+	using result_type                = R;
+	static constexpr bool is_noexcept = false;
+};
+
+#if __cpp_noexcept_function_type >= 201510
+// C++17以降は、noexceptが関数型の一部となるため、noexceptなシグネチャを指定できる
+template <typename R, typename... Extra>
+struct to_signature<R( Extra... ) noexcept> {
+	using type                       = R( Extra... ) noexcept;
+	using result_type                = R;
+	static constexpr bool is_noexcept = true;
+};
+#endif
+
+#if __cplusplus >= 201703L
+/**
+ * @brief 変換演算子の戻り値から直接構築させるためのクラス。std::optional::emplace()に渡して、関数の戻り値をムーブせずに構築する
+ */
+template <typename Invoker>
+struct emplacing_converter {
+	operator std::invoke_result_t<Invoker&>()
+	{
+		return invoker_();
+	}
+
+	Invoker& invoker_;
+};
+#endif
+
+template <typename Sig>
+class deferred_apply_base;
+
+#if __cpp_noexcept_function_type >= 201510
+template <typename R, typename... Extra, bool NoExcept>
+class deferred_apply_base<R( Extra... ) noexcept( NoExcept )> {
 #else
-	auto apply( F&& f ) -> typename std::result_of<F( OrigArgs... )>::type
+template <typename R, typename... Extra>
+class deferred_apply_base<R( Extra... )> {
+	static constexpr bool NoExcept = false;
+
 #endif
+public:
+	virtual ~deferred_apply_base()                                                                                    = default;
+	virtual R                                    apply_func( Extra... extra ) noexcept( NoExcept )                    = 0;
+	virtual R                                    apply_func_copy( Extra... extra )                                    = 0;
+	virtual void                                 apply_func_into( void* p_slot, Extra... extra ) noexcept( NoExcept ) = 0;
+	virtual void                                 apply_func_copy_into( void* p_slot, Extra... extra )                 = 0;
+	virtual deferred_apply_base*                 placement_new_copy( void* ptr )                                      = 0;
+	virtual deferred_apply_base*                 placement_new_move( void* ptr )                                      = 0;
+	virtual std::unique_ptr<deferred_apply_base> make_copy_clone( void )                                              = 0;
+	virtual deferred_apply_introspection         introspect( void ) const                                             = 0;
+
+	// 内部バッファに収まらない場合の領域は、set_deferred_apply_heap_allocator()で設定したアロケータから確保する
+	static void* operator new( size_t size )
 	{
-		return apply_impl( std::forward<F>( f ), deferred_apply_internal::my_make_index_sequence<std::tuple_size<tuple_args_t>::value>() );
+		return heap_allocate( size );
 	}
-
-#ifdef DEFERRED_APPLY_DEBUG
-	void debug_type_info( void )
+	static void operator delete( void* p, size_t size ) noexcept
 	{
-		printf( "Called constructor of deferred_applying_arguments\n" );
-		printf( "\tthis class: %s\n", deferred_apply_internal::demangle( typeid( *this ).name() ) );
-		printf( "\tvalues_: %s\n", deferred_apply_internal::demangle( typeid( values_ ).name() ) );
-		printf( "\tvalues_ is copy constructible ?: %s\n", std::is_copy_constructible<tuple_args_t>::value ? "true" : "false" );
+		heap_deallocate( p, size );
 	}
-
-	template <typename F>
-	void debug_apply_type_info( F&& f )
+	static void* operator new( size_t, void* p ) noexcept
 	{
-		printf( "f: %s\n", deferred_apply_internal::demangle( typeid( f ).name() ) );
-		printf( "apply_impl: %s\n", deferred_apply_internal::demangle( typeid( decltype( apply_impl( std::forward<F>( f ), deferred_apply_internal::my_make_index_sequence<std::tuple_size<tuple_args_t>::value>() ) ) ).name() ) );
+		return p;
 	}
-#endif
-
-private:
-	template <typename F, size_t... Is>
-#if __cpp_decltype_auto >= 201304
-	decltype( auto ) apply_impl( F&& f, deferred_apply_internal::my_index_sequence<Is...> )
-#else
-	auto apply_impl( F&& f, deferred_apply_internal::my_index_sequence<Is...> ) -> typename std::result_of<F( OrigArgs... )>::type
-#endif
+	static void operator delete( void*, void* ) noexcept
 	{
-		return f( static_cast<
-				  typename deferred_apply_internal::get_argument_apply_type<
-					  OrigArgs,
-					  typename deferred_apply_internal::get_argument_store_type<OrigArgs>::type>::type>(
-			std::get<Is>( values_ ) )... );
 	}
-
-	tuple_args_t values_;
+#if __cpp_aligned_new >= 201606
+	// std::max_align_tを超えるアライメントの場合は、アロケータを使用しない
+	static void* operator new( size_t size, std::align_val_t al )
+	{
+		return ::operator new( size, al );
+	}
+	static void operator delete( void* p, size_t, std::align_val_t al ) noexcept
+	{
+		::operator delete( p, al );
+	}
+#endif
 };
 
-template <class... Args>
-auto make_deferred_applying_arguments( Args&&... args ) -> deferred_applying_arguments<Args&&...>
-{
-	return deferred_applying_arguments<Args&&...>( std::forward<Args>( args )... );
-}
-
-namespace deferred_apply_internal {
-
-////////////////////////////////////////////////////////////////////////////////////////////
-template <typename R>
-class deferred_apply_base {
-public:
-	virtual ~deferred_apply_base()                                               = default;
-	virtual R                                    apply_func( void )              = 0;
-	virtual deferred_apply_base*                 placement_new_copy( void* ptr ) = 0;
-	virtual deferred_apply_base*                 placement_new_move( void* ptr ) = 0;
-	virtual std::unique_ptr<deferred_apply_base> make_copy_clone( void )         = 0;
-};
+template <typename Sig, typename F, typename... OrigArgs>
+class deferred_apply_container;
 
 /**
  * @brief 引数と関数を保持するためのクラス
  *
  * @tparam R Fの戻り値の型
+ * @tparam Extra apply_func()の呼び出し時に、保持している引数の後ろに追加して適用する引数の型
+ * @tparam NoExcept apply_func()をnoexceptとするかどうか。C++17以降で、シグネチャにnoexceptを指定した場合にtrue
  * @tparam F 関数、あるいは関数オブジェクトの型
  * @tparam OrigArgs Fに適用する引数の型
  */
-template <typename R, typename F, typename... OrigArgs>
-class deferred_apply_container : public deferred_apply_base<R> {
+#if __cpp_noexcept_function_type >= 201510
+template <typename R, typename... Extra, bool NoExcept, typename F, typename... OrigArgs>
+class deferred_apply_container<R( Extra... ) noexcept( NoExcept ), F, OrigArgs...> : public deferred_apply_base<R( Extra... ) noexcept( NoExcept )> {
+	using base_t = deferred_apply_base<R( Extra... ) noexcept( NoExcept )>;
+#else
+template <typename R, typename... Extra, typename F, typename... OrigArgs>
+class deferred_apply_container<R( Extra... ), F, OrigArgs...> : public deferred_apply_base<R( Extra... )> {
+	using base_t                   = deferred_apply_base<R( Extra... )>;
+	static constexpr bool NoExcept = false;
+#endif
+
 public:
 	using funct_t                            = F;
 	using argkeeper_t                        = deferred_applying_arguments<OrigArgs...>;
@@ -321,23 +1368,53 @@ public:
 	{
 	}
 
-	R apply_func( void ) override
+	R apply_func( Extra... extra ) noexcept( NoExcept ) override
+	{
+		static_assert( !NoExcept || noexcept( std::declval<argkeeper_t&>().apply( std::declval<funct_t&>(), std::declval<Extra>()... ) ),
+		               "f should be noexcept to be held by deferred_apply with noexcept signature" );
+		return arguments_keeper_.apply( functor_, std::forward<Extra>( extra )... );
+	}
+	R apply_func_copy( Extra... extra ) override
+	{
+		return apply_func_copy_impl( std::forward<Extra>( extra )... );
+	}
+	/**
+	 * @brief 保持している値を左辺値として渡して適用する。仮想関数ではないため、型が分かっている呼び出し元からだけ使用できる
+	 */
+	R apply_func_lvalue( Extra... extra )
+	{
+		return arguments_keeper_.apply_lvalue( functor_, std::forward<Extra>( extra )... );
+	}
+	void apply_func_into( void* p_slot, Extra... extra ) noexcept( NoExcept ) override
 	{
-		return arguments_keeper_.apply( functor_ );
+		apply_func_into_impl( p_slot, std::integral_constant<bool, std::is_object<R>::value>(), std::forward<Extra>( extra )... );
+	}
+	void apply_func_copy_into( void* p_slot, Extra... extra ) override
+	{
+		apply_func_copy_into_impl( p_slot, std::integral_constant<bool, std::is_object<R>::value>(), std::forward<Extra>( extra )... );
 	}
 
-	deferred_apply_base<R>* placement_new_copy( void* ptr ) override
+	base_t* placement_new_copy( void* ptr ) override
 	{
 		return placement_new_copy_impl( ptr );
 	}
-	deferred_apply_base<R>* placement_new_move( void* ptr ) override
+	base_t* placement_new_move( void* ptr ) override
 	{
 		return placement_new_move_impl( ptr );
 	}
-	std::unique_ptr<deferred_apply_base<R>> make_copy_clone( void ) override
+	std::unique_ptr<base_t> make_copy_clone( void ) override
 	{
 		return make_copy_clone_impl();
 	}
+	deferred_apply_introspection introspect( void ) const override
+	{
+		deferred_apply_introspection ans = argkeeper_t::introspect();
+		ans.storage_size                 = sizeof( deferred_apply_container );
+		ans.storage_align                = alignof( deferred_apply_container );
+		ans.copy_constructible           = copy_constructible;
+		ans.move_constructible           = move_constructible;
+		return ans;
+	}
 
 #ifdef DEFERRED_APPLY_DEBUG
 	void debug_type_info( void )
@@ -377,42 +1454,72 @@ private:
 	};
 
 	template <bool IsCopyConstractable = copy_constructible, typename std::enable_if<IsCopyConstractable>::type* = nullptr>
-	std::unique_ptr<deferred_apply_base<R>> make_copy_clone_impl( void )
+	std::unique_ptr<base_t> make_copy_clone_impl( void )
 	{
 #if __cpp_lib_make_unique >= 201304
 		return std::make_unique<deferred_apply_container>( *this );
 #else
-		return std::unique_ptr<deferred_apply_base<R>>( new deferred_apply_container( *this ) );
+		return std::unique_ptr<base_t>( new deferred_apply_container( *this ) );
 #endif
 	}
 	template <bool IsCopyConstractable = copy_constructible, typename std::enable_if<!IsCopyConstractable>::type* = nullptr>
-	std::unique_ptr<deferred_apply_base<R>> make_copy_clone_impl( void )
+	std::unique_ptr<base_t> make_copy_clone_impl( void )
 	{
-		throw( bad_copy_consturct() );
+		raise_error<bad_copy_consturct>();
 		return nullptr;
 	}
 
+	template <bool IsArgsCopyConstractable = std::is_copy_constructible<argkeeper_t>::value, typename std::enable_if<IsArgsCopyConstractable>::type* = nullptr>
+	R apply_func_copy_impl( Extra... extra )
+	{
+		return arguments_keeper_.apply_copy( functor_, std::forward<Extra>( extra )... );
+	}
+	template <bool IsArgsCopyConstractable = std::is_copy_constructible<argkeeper_t>::value, typename std::enable_if<!IsArgsCopyConstractable>::type* = nullptr>
+	R apply_func_copy_impl( Extra... )
+	{
+		raise_error<bad_copy_consturct>();
+	}
+
+	// 戻り値の型がオブジェクト型の場合は、fの戻り値をp_slotに直接構築する
+	void apply_func_into_impl( void* p_slot, std::true_type, Extra... extra ) noexcept( NoExcept )
+	{
+		::new ( p_slot ) R( deferred_apply_container::apply_func( std::forward<Extra>( extra )... ) );
+	}
+	// voidや参照型の場合は、構築する値がないため、適用だけを行う
+	void apply_func_into_impl( void*, std::false_type, Extra... extra ) noexcept( NoExcept )
+	{
+		deferred_apply_container::apply_func( std::forward<Extra>( extra )... );
+	}
+	void apply_func_copy_into_impl( void* p_slot, std::true_type, Extra... extra )
+	{
+		::new ( p_slot ) R( apply_func_copy_impl( std::forward<Extra>( extra )... ) );
+	}
+	void apply_func_copy_into_impl( void*, std::false_type, Extra... extra )
+	{
+		apply_func_copy_impl( std::forward<Extra>( extra )... );
+	}
+
 	template <bool IsCopyConstractable = copy_constructible, typename std::enable_if<IsCopyConstractable>::type* = nullptr>
-	deferred_apply_base<R>* placement_new_copy_impl( void* ptr )
+	base_t* placement_new_copy_impl( void* ptr )
 	{
 		return new ( ptr ) deferred_apply_container( *this );
 	}
 	template <bool IsCopyConstractable = copy_constructible, typename std::enable_if<!IsCopyConstractable>::type* = nullptr>
-	deferred_apply_base<R>* placement_new_copy_impl( void* ptr )
+	base_t* placement_new_copy_impl( void* ptr )
 	{
-		throw( bad_copy_consturct() );
+		raise_error<bad_copy_consturct>();
 		return nullptr;
 	}
 
 	template <bool IsMoveConstractable = move_constructible, typename std::enable_if<IsMoveConstractable>::type* = nullptr>
-	deferred_apply_base<R>* placement_new_move_impl( void* ptr )
+	base_t* placement_new_move_impl( void* ptr )
 	{
 		return new ( ptr ) deferred_apply_container( std::move( *this ) );
 	}
 	template <bool IsMoveConstractable = move_constructible, typename std::enable_if<!IsMoveConstractable>::type* = nullptr>
-	deferred_apply_base<R>* placement_new_move_impl( void* ptr )
+	base_t* placement_new_move_impl( void* ptr )
 	{
-		throw( bad_move_consturct() );
+		raise_error<bad_move_consturct>();
 		return nullptr;
 	}
 
@@ -422,6 +1529,11 @@ private:
 
 }   // namespace deferred_apply_internal
 
+/**
+ * @brief deferred_applyが、関数と引数をヒープを使わずに配置するための内部バッファのデフォルトサイズ
+ */
+constexpr size_t deferred_apply_default_buffer_size = 128;
+
 /**
  * @brief Class intended to hold temporary arguments to defer execution of functions
  *
@@ -440,6 +1552,13 @@ private:
  *
  * Execution of f(a,b,...) is delayed until da.apply().
  *
+ * If R is a function type R2(Extra...), the arguments given to apply() are appended after the held arguments:
+ * @code {.cpp}
+ * deferred_apply<void( int )> on_complete( handler, context );
+ * // do something, then...
+ * on_complete.apply( status );   // handler( context, status )
+ * @endcode
+ *
  * Unlike deferred_applying_arguments<>, only the return type for apply() is a template argument.
  * Therefore, it becomes easy to use it as a member variable of a class.
  * On the other hand, we cannot change the dynamically applied function f.
@@ -456,7 +1575,7 @@ private:
  * Therefore, instances of this class and their copies should not be brought out of the generated scope. @n
  * Rvalues and rvalue reference types are moved in order not to lose their values, and retain their values within this class. @n
  *
- * @tparam R member function apply() return type
+ * @tparam R member function apply() return type, or function type R2(Extra...) that also specifies the trailing arguments of apply()
  *
  * @brief 関数の実行を延期するために、一時的引数を保持することを目的としたクラス
  *
@@ -475,6 +1594,8 @@ private:
  *
  * da.apply()まで、f(a,b,...) の実行が遅延される。
  *
+ * Rが関数型 R2(Extra...) の場合、apply()に渡した引数は、保持している引数の後ろに追加して適用される。
+ *
  * deferred_applying_arguments<>とは異なり、apply()のための戻り値の型だけがテンプレート引数となる。
  * そのため、クラスのメンバ変数として使用することも容易になる。
  * 一方で、動的に適用する関数fを変更することはできない。
@@ -483,6 +1604,7 @@ private:
  * apply()の再適用が可能かどうかは、引数をどのように渡したか、あるいはfの特性に依存する。 @n
  * 例えば、aが右辺値参照で引き渡された場合、1回目のapply()の適用によって、deferred_apply内で保持していた値が、fによって無効値となっている可能性がある。 @n
  * そのため、2回目のapply()適用が意図通りとなるかどうかは未定義となる。
+ * 繰り返し適用する場合は、enable_repeatable_apply()とapply_final()を使用すること。
  *
  * @warning
  * 一時的な保持を目的としているため、効率を優先し、左辺値参照されたインスタンスは左辺値参照型を保持する方式で、コピーしない。 @n
@@ -491,21 +1613,62 @@ private:
  * よって、本クラスのインスタンスやそのコピーを、生成したスコープの外に持ち出してはならない。 @n
  * 右辺値や右辺値参照型は、値を失わないためにムーブし、本クラス内で値を保持する。 @n
  *
- * @tparam R メンバ関数apply()の戻り値の型
+ * @tparam R メンバ関数apply()の戻り値の型。あるいは、apply()の末尾の引数の型も指定する関数型 R2(Extra...)
+ * @tparam BuffSize 関数と引数を内部バッファに配置するためのバッファサイズ
+ * @tparam AllowHeapFallback 内部バッファに収まらない場合にヒープを使用するかどうか。falseの場合、収まらない関数と引数はstatic_assertでコンパイルエラーとなる。
  */
-template <typename R>
+template <typename R, size_t BuffSize = deferred_apply_default_buffer_size, bool AllowHeapFallback = true>
 class deferred_apply {
-	constexpr static size_t buff_size = 128;
+	constexpr static size_t buff_size = BuffSize;
+	using sig_t                       = typename deferred_apply_internal::to_signature<R>::type;
 
 public:
+	using result_type = typename deferred_apply_internal::to_signature<R>::result_type;
+
+	/**
+	 * @brief apply()がnoexceptかどうか。C++17以降で、Rに R2(Extra...) noexcept を指定した場合にtrue
+	 */
+	static constexpr bool is_nothrow_apply = deferred_apply_internal::to_signature<R>::is_noexcept;
+
+	/**
+	 * @brief 繰り返し適用可能なモードで、最後の適用を終えた後に再び適用しようとした場合の例外
+	 */
+	class bad_apply_after_final : public std::logic_error {
+	public:
+		bad_apply_after_final( void )
+		  : std::logic_error( "deferred_apply is applied again after its final apply" )
+		{
+		}
+	};
+
+	/**
+	 * @brief 関数Fと引数Args...を保持するコンテナが、ヒープを使わずに内部バッファに配置されるかどうかを求めるメタ関数
+	 *
+	 * Example of use:
+	 * @code {.cpp}
+	 * static_assert( deferred_apply<void>::fits_inline<decltype( f ), int>::value, "f(int) should not allocate" );
+	 * @endcode
+	 *
+	 * @tparam F 関数、あるいは関数オブジェクトの型。make_deferred_apply()と同じく、左辺値の場合は参照型を指定する。
+	 * @tparam Args Fに適用する引数の型。make_deferred_apply()と同じく、左辺値の場合は参照型を指定する。
+	 */
+	template <typename F, typename... Args>
+	struct fits_inline : public std::integral_constant<
+							 bool,
+							 ( sizeof( deferred_apply_internal::deferred_apply_container<sig_t, F, Args&&...> ) <= buff_size ) &&
+								 ( alignof( deferred_apply_internal::deferred_apply_container<sig_t, F, Args&&...> ) <= alignof( std::max_align_t ) )> {
+	};
+
 	deferred_apply( void )
 	  : applying_count_( 0 )
+	  , repeatable_budget_( -1 )
 	  , up_cntner_( nullptr )
 	  , p_cntner_( nullptr )
 	{
 	}
 	deferred_apply( const deferred_apply& orig )
 	  : applying_count_( orig.applying_count_ )
+	  , repeatable_budget_( orig.repeatable_budget_ )
 	  , up_cntner_( nullptr )
 	  , p_cntner_( nullptr )
 	{
@@ -520,6 +1683,7 @@ public:
 	}
 	deferred_apply( deferred_apply&& orig )
 	  : applying_count_( orig.applying_count_ )
+	  , repeatable_budget_( orig.repeatable_budget_ )
 	  , up_cntner_( std::move( orig.up_cntner_ ) )
 	  , p_cntner_( nullptr )
 	{
@@ -536,69 +1700,22 @@ public:
 		orig.applying_count_ = 0;
 	}
 
-#if __cpp_if_constexpr >= 201606
 	template <typename F,
 	          typename... Args,
 	          typename std::enable_if<!std::is_same<typename std::remove_reference<F>::type, deferred_apply>::value>::type* = nullptr>
 	deferred_apply( F&& f, Args&&... args )
 	  : applying_count_( 0 )
+	  , repeatable_budget_( -1 )
 	  , up_cntner_( nullptr )
 	  , p_cntner_( nullptr )
 	{
-		using cur_container_t = deferred_apply_internal::deferred_apply_container<R, F, Args&&...>;
-
-		if constexpr ( buff_size < sizeof( cur_container_t ) ) {   // C++17から導入されたif constexpr構文。C++11とC++14はSFINEで実装
-			up_cntner_ = std::make_unique<cur_container_t>( std::forward<F>( f ), std::forward<Args>( args )... );
-			p_cntner_  = up_cntner_.get();
-		} else {
-			p_cntner_ = new ( placement_new_buffer ) cur_container_t( std::forward<F>( f ), std::forward<Args>( args )... );
-		}
-	}
-#else   // __cpp_if_constexpr
-	template <typename F,
-	          typename... Args,
-	          typename std::enable_if<!std::is_same<typename std::remove_reference<F>::type, deferred_apply>::value && ( buff_size < sizeof( deferred_apply_internal::deferred_apply_container<R, typename std::remove_reference<F>::type, Args...> ) )>::type* = nullptr>
-	deferred_apply( F&& f, Args&&... args )
-	  : applying_count_( 0 )
-	  , up_cntner_( nullptr )
-	  , p_cntner_( nullptr )
-	{
-		using cur_container_t = deferred_apply_internal::deferred_apply_container<R, F, Args&&...>;
-
-#if __cpp_lib_make_unique >= 201304
-		up_cntner_            = std::make_unique<cur_container_t>( std::forward<F>( f ), std::forward<Args>( args )... );
-#else
-		up_cntner_ = std::unique_ptr<cur_container_t>( new cur_container_t( std::forward<F>( f ), std::forward<Args>( args )... ) );
-#endif
-		p_cntner_             = up_cntner_.get();
-	}
-
-	template <typename F,
-	          typename... Args,
-	          typename std::enable_if<( !std::is_same<typename std::remove_reference<F>::type, deferred_apply>::value ) && ( buff_size >= sizeof( deferred_apply_internal::deferred_apply_container<R, typename std::remove_reference<F>::type, Args...> ) )>::type* = nullptr>
-	deferred_apply( F&& f, Args&&... args )
-	  : applying_count_( 0 )
-	  , up_cntner_( nullptr )
-	  , p_cntner_( nullptr )
-	{
-		using cur_container_t = deferred_apply_internal::deferred_apply_container<R, F, Args&&...>;
-
-		p_cntner_ = new ( placement_new_buffer ) cur_container_t( std::forward<F>( f ), std::forward<Args>( args )... );
+		construct_container( std::forward<F>( f ), std::forward<Args>( args )... );
 	}
-#endif   // __cpp_if_constexpr
 
 	deferred_apply& operator=( const deferred_apply& orig )
 	{
 		// discard this
-		if ( up_cntner_ != nullptr ) {
-			up_cntner_.reset();
-			p_cntner_ = nullptr;
-		} else if ( p_cntner_ != nullptr ) {
-			p_cntner_->~deferred_apply_base();
-			p_cntner_ = nullptr;
-		} else {
-			// this object is empty object. Therefore, nothing to do
-		}
+		discard_container();
 
 		// copy to this
 		if ( orig.up_cntner_ != nullptr ) {
@@ -609,22 +1726,15 @@ public:
 		} else {
 			// orig is empty object. Therefore, nothing to do
 		}
-		applying_count_ = orig.applying_count_;
+		applying_count_    = orig.applying_count_;
+		repeatable_budget_ = orig.repeatable_budget_;
 
 		return *this;
 	}
 	deferred_apply& operator=( deferred_apply&& orig )
 	{
 		// discard this
-		if ( up_cntner_ != nullptr ) {
-			up_cntner_.reset();
-			p_cntner_ = nullptr;
-		} else if ( p_cntner_ != nullptr ) {
-			p_cntner_->~deferred_apply_base();
-			p_cntner_ = nullptr;
-		} else {
-			// this object is empty object. Therefore, nothing to do
-		}
+		discard_container();
 
 		// move orig to this
 		if ( orig.up_cntner_ != nullptr ) {
@@ -639,6 +1749,7 @@ public:
 			// orig is empty object. Therefore, nothing to do
 		}
 		applying_count_      = orig.applying_count_;
+		repeatable_budget_   = orig.repeatable_budget_;
 		orig.applying_count_ = 0;
 
 		return *this;
@@ -652,10 +1763,102 @@ public:
 		p_cntner_->~deferred_apply_base();
 	}
 
-	R apply( void )
+	/**
+	 * @brief 保持している関数に、保持している引数を適用する
+	 *
+	 * Rが関数型 R2(Extra...) の場合は、extra...を保持している引数の後ろに追加して適用する。
+	 * enable_repeatable_apply()で繰り返し適用可能なモードとした場合は、右辺値として保持している値をコピーして渡す。
+	 * ただし、試行回数の上限を指定した場合、上限回目の適用ではapply_final()と同じくムーブして渡し、以降の適用は bad_apply_after_final 例外を送出する。
+	 *
+	 * Rにnoexceptなシグネチャを指定した場合は、noexceptとなる。
+	 * この場合、繰り返し適用可能なモードで値のコピーが例外を送出すると、std::terminate()が呼び出される。
+	 */
+	template <typename... XExtra>
+	result_type apply( XExtra&&... extra ) noexcept( is_nothrow_apply )
+	{
+		check_not_finished();
+		applying_count_++;
+		if ( ( repeatable_budget_ < 0 ) || ( ( repeatable_budget_ > 0 ) && ( applying_count_ >= repeatable_budget_ ) ) ) {
+			return p_cntner_->apply_func( std::forward<XExtra>( extra )... );
+		}
+		return p_cntner_->apply_func_copy( std::forward<XExtra>( extra )... );
+	}
+
+	/**
+	 * @brief 保持している関数に、右辺値として保持している値をムーブして引数を適用する
+	 *
+	 * 繰り返し適用可能なモードで、最後の適用に使用する。適用後に保持している値は、fによって無効値となっている可能性がある。
+	 * そのため、繰り返し適用可能なモードでは、以降のapply()やapply_final()は bad_apply_after_final 例外を送出する。
+	 */
+	template <typename... XExtra>
+	result_type apply_final( XExtra&&... extra ) noexcept( is_nothrow_apply )
+	{
+		check_not_finished();
+		applying_count_++;
+		if ( repeatable_budget_ >= 0 ) {
+			// 試行回数の上限を使い切った状態とし、以降の適用を拒否する
+			repeatable_budget_ = applying_count_;
+		}
+		return p_cntner_->apply_func( std::forward<XExtra>( extra )... );
+	}
+
+	/**
+	 * @brief apply()と同じく適用し、戻り値をp_slotが指す未初期化の領域に直接構築する
+	 *
+	 * 戻り値を一時オブジェクトとして受け取ってからムーブする必要がないため、大きな戻り値を確保済みの配列などに直接格納できる。
+	 * 構築した値の破棄は、呼び出し側で行うこと。
+	 * result_typeがオブジェクト型の場合にだけ使用できる。
+	 *
+	 * @param p_slot result_typeを構築する未初期化の領域へのポインタ
+	 */
+	template <typename T = result_type, typename... XExtra>
+	auto apply_into( T* p_slot, XExtra&&... extra ) noexcept( is_nothrow_apply )
+		-> typename std::enable_if<std::is_same<T, result_type>::value && std::is_object<T>::value>::type
 	{
+		check_not_finished();
 		applying_count_++;
-		return p_cntner_->apply_func();
+		if ( ( repeatable_budget_ < 0 ) || ( ( repeatable_budget_ > 0 ) && ( applying_count_ >= repeatable_budget_ ) ) ) {
+			p_cntner_->apply_func_into( p_slot, std::forward<XExtra>( extra )... );
+		} else {
+			p_cntner_->apply_func_copy_into( p_slot, std::forward<XExtra>( extra )... );
+		}
+	}
+
+#if __cplusplus >= 201703L
+	/**
+	 * @brief apply()と同じく適用し、戻り値をoptに直接構築する
+	 *
+	 * optが値を保持している場合は、適用前に破棄する。
+	 * C++17の保証されたコピー省略により、ムーブもコピーもできない戻り値の型でも使用できる。
+	 */
+	template <typename T = result_type, typename... XExtra>
+	auto apply_emplace( std::optional<T>& opt, XExtra&&... extra ) noexcept( is_nothrow_apply )
+		-> typename std::enable_if<std::is_same<T, result_type>::value && std::is_object<T>::value, T&>::type
+	{
+		auto invoker = [&]() -> result_type {
+			return apply( std::forward<XExtra>( extra )... );
+		};
+		return opt.emplace( deferred_apply_internal::emplacing_converter<decltype( invoker )> { invoker } );
+	}
+#endif
+
+	/**
+	 * @brief apply()を、繰り返し適用可能なモードにする
+	 *
+	 * 以降のapply()は、右辺値として保持している値をムーブせずにコピーして渡すため、fが引数をムーブしても再適用が可能となる。
+	 * 最後の適用にはapply_final()を使うことで、コピーを1回省略できる。
+	 * 保持している値がコピーできない場合、apply()は bad_copy_consturct 例外を送出する。
+	 *
+	 * @param max_attempts 試行回数の上限。0より大きい場合、max_attempts回目のapply()は自動的にムーブして渡し、以降のapply()は bad_apply_after_final 例外を送出する。0の場合は上限なし。
+	 */
+	void enable_repeatable_apply( int max_attempts = 0 )
+	{
+		repeatable_budget_ = ( max_attempts < 0 ) ? 0 : max_attempts;
+	}
+
+	bool is_repeatable_apply( void ) const
+	{
+		return repeatable_budget_ >= 0;
 	}
 
 	int number_of_times_applied( void ) const
@@ -668,13 +1871,147 @@ public:
 		return ( p_cntner_ != nullptr );
 	}
 
+	/**
+	 * @brief 保持している関数と引数のレイアウト情報を返す
+	 *
+	 * storage_sizeとstorage_alignは、関数と引数を保持するコンテナのサイズとアライメント。
+	 * 空のインスタンスの場合は、storage_modeがdeferred_apply_storage_mode::emptyとなり、その他の値は0となる。
+	 */
+	deferred_apply_introspection introspect( void ) const
+	{
+		if ( p_cntner_ == nullptr ) {
+			return deferred_apply_introspection { deferred_apply_storage_mode::empty, 0, 0, false, false, 0, nullptr };
+		}
+
+		deferred_apply_introspection ans = p_cntner_->introspect();
+		ans.storage_mode                 = ( up_cntner_ != nullptr ) ? deferred_apply_storage_mode::heap : deferred_apply_storage_mode::inline_buffer;
+		return ans;
+	}
+
+	/**
+	 * @brief 保持している関数と引数を破棄し、f(args...)を保持し直す
+	 *
+	 * 一時オブジェクトを経由せず、内部バッファに直接構築する。apply()の適用回数は0に戻る。
+	 *
+	 * @warning
+	 * 構築中に例外が発生した場合、本インスタンスは空となる。
+	 */
+	template <typename F, typename... Args>
+	void emplace( F&& f, Args&&... args )
+	{
+		discard_container();
+		applying_count_    = 0;
+		repeatable_budget_ = -1;
+		construct_container( std::forward<F>( f ), std::forward<Args>( args )... );
+	}
+
+	/**
+	 * @brief 保持している関数と引数を破棄し、空のインスタンスとする
+	 */
+	void reset( void )
+	{
+		discard_container();
+		applying_count_    = 0;
+		repeatable_budget_ = -1;
+	}
+
 private:
-	int                                                              applying_count_;
-	std::unique_ptr<deferred_apply_internal::deferred_apply_base<R>> up_cntner_;
-	deferred_apply_internal::deferred_apply_base<R>*                 p_cntner_;
-	char                                                             placement_new_buffer[buff_size];
+	/**
+	 * @brief 繰り返し適用可能なモードで、最後の適用を終えていれば bad_apply_after_final 例外を送出する
+	 *
+	 * 右辺値として保持している値は、最後の適用でムーブ済みのため、再び適用すると無効値を渡すことになる。
+	 */
+	void check_not_finished( void ) const
+	{
+		if ( ( repeatable_budget_ > 0 ) && ( applying_count_ >= repeatable_budget_ ) ) {
+			deferred_apply_internal::raise_error<bad_apply_after_final>();
+		}
+	}
+
+#if __cpp_if_constexpr >= 201606
+	template <typename F, typename... Args>
+	void construct_container( F&& f, Args&&... args )
+	{
+		using cur_container_t = deferred_apply_internal::deferred_apply_container<sig_t, F, Args&&...>;
+
+		if constexpr ( !fits_inline<F, Args...>::value ) {   // C++17から導入されたif constexpr構文。C++11とC++14はSFINEで実装
+			static_assert( AllowHeapFallback || fits_inline<F, Args...>::value, "function and arguments do not fit in the inline buffer of deferred_apply, and heap fallback is not allowed" );
+			up_cntner_ = std::make_unique<cur_container_t>( std::forward<F>( f ), std::forward<Args>( args )... );
+			p_cntner_  = up_cntner_.get();
+		} else {
+			p_cntner_ = new ( placement_new_buffer ) cur_container_t( std::forward<F>( f ), std::forward<Args>( args )... );
+		}
+	}
+#else   // __cpp_if_constexpr
+	template <typename F,
+	          typename... Args,
+	          typename std::enable_if<!fits_inline<F, Args...>::value>::type* = nullptr>
+	void construct_container( F&& f, Args&&... args )
+	{
+		using cur_container_t = deferred_apply_internal::deferred_apply_container<sig_t, F, Args&&...>;
+		static_assert( AllowHeapFallback || fits_inline<F, Args...>::value, "function and arguments do not fit in the inline buffer of deferred_apply, and heap fallback is not allowed" );
+
+#if __cpp_lib_make_unique >= 201304
+		up_cntner_            = std::make_unique<cur_container_t>( std::forward<F>( f ), std::forward<Args>( args )... );
+#else
+		up_cntner_ = std::unique_ptr<cur_container_t>( new cur_container_t( std::forward<F>( f ), std::forward<Args>( args )... ) );
+#endif
+		p_cntner_             = up_cntner_.get();
+	}
+
+	template <typename F,
+	          typename... Args,
+	          typename std::enable_if<fits_inline<F, Args...>::value>::type* = nullptr>
+	void construct_container( F&& f, Args&&... args )
+	{
+		using cur_container_t = deferred_apply_internal::deferred_apply_container<sig_t, F, Args&&...>;
+
+		p_cntner_ = new ( placement_new_buffer ) cur_container_t( std::forward<F>( f ), std::forward<Args>( args )... );
+	}
+#endif   // __cpp_if_constexpr
+
+	void discard_container( void )
+	{
+		if ( up_cntner_ != nullptr ) {
+			up_cntner_.reset();
+			p_cntner_ = nullptr;
+		} else if ( p_cntner_ != nullptr ) {
+			p_cntner_->~deferred_apply_base();
+			p_cntner_ = nullptr;
+		} else {
+			// this object is empty object. Therefore, nothing to do
+		}
+	}
+
+	int                                                                  applying_count_;
+	int                                                                  repeatable_budget_;   //!< 負の場合は、繰り返し適用可能なモードではない。0の場合は、試行回数の上限なし。
+	std::unique_ptr<deferred_apply_internal::deferred_apply_base<sig_t>> up_cntner_;
+	deferred_apply_internal::deferred_apply_base<sig_t>*                 p_cntner_;
+	alignas( std::max_align_t ) char                                     placement_new_buffer[buff_size];
 };
 
+template <typename R, size_t BuffSize, bool AllowHeapFallback>
+constexpr bool deferred_apply<R, BuffSize, AllowHeapFallback>::is_nothrow_apply;
+
+/**
+ * @brief Strict no-allocation variant of deferred_apply<R>
+ *
+ * Function and arguments are always placed in the inline buffer of N bytes.
+ * If they do not fit, construction fails with static_assert instead of allocating from the heap.
+ * Therefore, construction, copy and move of this class never allocate memory.
+ *
+ * @brief ヒープを一切使用しないdeferred_apply<R>
+ *
+ * 関数と引数は、常にNバイトの内部バッファに配置される。
+ * 収まらない場合は、ヒープを使用する代わりにstatic_assertでコンパイルエラーとなる。
+ * よって、本クラスの構築、コピー、ムーブでメモリ確保が発生しないことを、ビルド時に保証できる。
+ *
+ * @tparam R メンバ関数apply()の戻り値の型
+ * @tparam N 内部バッファのサイズ
+ */
+template <typename R, size_t N = deferred_apply_default_buffer_size>
+using inplace_deferred_apply = deferred_apply<R, N, false>;
+
 /**
  * @brief 関数の実行を延期するために、関数と引数を保持することを目的としたクラスのインスタンスを生成するヘルパ関数
  *
@@ -684,19 +2021,38 @@ private:
 template <typename F, typename... Args>
 auto make_deferred_apply( F&& f, Args&&... args )
 #if __cplusplus >= 201703L
-	-> deferred_apply<typename std::invoke_result<F, Args&&...>::type>
+	-> deferred_apply<typename std::invoke_result<F, typename deferred_apply_internal::lazy_substituted_type<Args&&>::type...>::type>
 #else
-	-> deferred_apply<typename std::result_of<F( Args&&... )>::type>
+	-> deferred_apply<typename std::result_of<F( typename deferred_apply_internal::lazy_substituted_type<Args&&>::type... )>::type>
 #endif
 {
 #if __cplusplus >= 201703L
-	using return_type = typename std::invoke_result<F, Args&&...>::type;
+	using return_type = typename std::invoke_result<F, typename deferred_apply_internal::lazy_substituted_type<Args&&>::type...>::type;
 #else
-	using return_type = typename std::result_of<F( Args && ... )>::type;
+	using return_type = typename std::result_of<F( typename deferred_apply_internal::lazy_substituted_type<Args&&>::type... )>::type;
 #endif
 	return deferred_apply<return_type>( std::forward<F>( f ), std::forward<Args>( args )... );
 }
 
+/**
+ * @brief 関数ポインタfと、プレースホルダを含む引数を保持するdeferred_applyのインスタンスを生成するヘルパ関数
+ *
+ * apply()の引数の型は、各プレースホルダの位置に対応するfの引数の型となる。
+ * 関数ポインタ以外の関数オブジェクトには、 make_deferred_apply_r<R( Extra... )>() を使用すること。
+ *
+ * @return deferred_apply<R( Extra... )>のインスタンス。Extra...は、_1から順に対応するfの引数の型。
+ */
+template <typename R,
+          typename... Params,
+          typename... Args,
+          typename std::enable_if<deferred_apply_internal::contains_placeholder<Args...>::value>::type* = nullptr>
+auto make_deferred_apply( R ( *f )( Params... ), Args&&... args )
+	-> deferred_apply<typename deferred_apply_internal::placeholder_signature<R( Params... ), Args...>::type>
+{
+	using signature_type = typename deferred_apply_internal::placeholder_signature<R( Params... ), Args...>::type;
+	return deferred_apply<signature_type>( std::move( f ), std::forward<Args>( args )... );
+}
+
 /**
  * @brief 関数の実行を延期するために、関数と引数を保持することを目的としたクラスのインスタンスを生成するヘルパ関数
  *
@@ -711,4 +2067,28 @@ deferred_apply<R> make_deferred_apply_r( F&& f, Args&&... args )
 	return deferred_apply<R>( std::forward<F>( f ), std::forward<Args>( args )... );
 }
 
+/**
+ * @brief ヒープを使用せずに、関数の実行を延期するために関数と引数を保持するクラスのインスタンスを生成するヘルパ関数
+ *
+ * 関数と引数がNバイトの内部バッファに収まらない場合は、static_assertでコンパイルエラーとなる。
+ *
+ * @return inplace_deferred_apply<R, N>のインスタンス。Rは、 std::invoke_result<F, Args&&...>::type 。
+ *
+ */
+template <size_t N = deferred_apply_default_buffer_size, typename F, typename... Args>
+auto make_inplace_deferred_apply( F&& f, Args&&... args )
+#if __cplusplus >= 201703L
+	-> inplace_deferred_apply<typename std::invoke_result<F, typename deferred_apply_internal::lazy_substituted_type<Args&&>::type...>::type, N>
+#else
+	-> inplace_deferred_apply<typename std::result_of<F( typename deferred_apply_internal::lazy_substituted_type<Args&&>::type... )>::type, N>
+#endif
+{
+#if __cplusplus >= 201703L
+	using return_type = typename std::invoke_result<F, typename deferred_apply_internal::lazy_substituted_type<Args&&>::type...>::type;
+#else
+	using return_type = typename std::result_of<F( typename deferred_apply_internal::lazy_substituted_type<Args&&>::type... )>::type;
+#endif
+	return inplace_deferred_apply<return_type, N>( std::forward<F>( f ), std::forward<Args>( args )... );
+}
+
 #endif
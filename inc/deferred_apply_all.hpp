@@ -0,0 +1,354 @@
+/**
+ * @file deferred_apply_all.hpp
+ * @author PFA03027@nifty.com
+ * @brief parallel application of a range of deferred_apply or deferred_applying_arguments
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023, PFA03027@nifty.com
+ *
+ */
+
+#ifndef DEFERRED_APPLY_ALL_HPP_
+#define DEFERRED_APPLY_ALL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "deferred_apply.hpp"
+#include "deferred_priority_executor.hpp"
+
+namespace deferred_apply_internal {
+
+/**
+ * @brief Tが、post( deferred_apply<void>&& )でタスクを投入できるエグゼキュータかどうかを求めるメタ関数
+ */
+template <typename T, typename = void>
+struct is_task_executor : public std::false_type {
+};
+
+template <typename T>
+struct is_task_executor<T, decltype( (void)std::declval<T&>().post( std::declval<deferred_apply<void>&&>() ) )> : public std::true_type {
+};
+
+/**
+ * @brief 要素のapply()を呼び出す
+ */
+struct element_applier {
+	template <typename E>
+	auto operator()( E& e ) const -> decltype( e.apply() )
+	{
+		return e.apply();
+	}
+};
+
+/**
+ * @brief 要素のapply( f )を呼び出す
+ */
+template <typename F>
+struct element_applier_with {
+	template <typename E>
+	auto operator()( E& e ) const -> decltype( e.apply( std::declval<F&>() ) )
+	{
+		return e.apply( *p_f_ );
+	}
+
+	F* p_f_;
+};
+
+/**
+ * @brief 結果を書き込まずに破棄することを表す、出力先の型
+ *
+ * deferred_apply<void>のように、戻り値のない要素の範囲を適用する場合に使用する。
+ */
+struct discard_output {
+};
+
+/**
+ * @brief apply_all()の1回の呼び出しで、ワーカースレッドと呼び出したスレッドが共有する状態
+ *
+ * 要素をgrain_size個毎のチャンクに分割し、各スレッドは未処理のチャンクを1つずつ取り出して処理する。
+ * 呼び出したスレッドが先にすべてのチャンクを処理し終えた場合でも、後から実行されるタスクが参照できるように、std::shared_ptrで共有する。
+ */
+template <typename RandomIt, typename OutIt, typename Applier>
+class apply_all_state {
+public:
+	apply_all_state( RandomIt first, OutIt out, Applier applier, size_t num_of_elements, size_t grain_size )
+	  : first_( first )
+	  , out_( out )
+	  , applier_( applier )
+	  , num_of_elements_( num_of_elements )
+	  , grain_size_( grain_size )
+	  , num_of_chunks_( ( num_of_elements + grain_size - 1 ) / grain_size )
+	  , next_chunk_( 0 )
+	  , num_of_done_( 0 )
+	  , mtx_()
+	  , cv_()
+#if DEFERRED_APPLY_HAS_EXCEPTIONS
+	  , p_exception_()
+#endif
+	{
+	}
+
+	size_t number_of_chunks( void ) const
+	{
+		return num_of_chunks_;
+	}
+
+	/**
+	 * @brief 未処理のチャンクがなくなるまで、チャンクを取り出して処理する
+	 */
+	void run_chunks( void )
+	{
+		while ( true ) {
+			size_t chunk_idx = next_chunk_.fetch_add( 1 );
+			if ( chunk_idx >= num_of_chunks_ ) return;
+
+			run_chunk( chunk_idx );
+			if ( ( num_of_done_.fetch_add( 1 ) + 1 ) == num_of_chunks_ ) {
+				std::lock_guard<std::mutex> lk( mtx_ );
+				cv_.notify_all();
+			}
+		}
+	}
+
+	/**
+	 * @brief すべてのチャンクの処理が終わるまで待つ
+	 *
+	 * 要素の適用で例外が送出された場合は、最初に送出された例外を再送出する。
+	 */
+	void wait( void )
+	{
+		std::unique_lock<std::mutex> lk( mtx_ );
+		cv_.wait( lk, [this]() {
+			return num_of_done_.load() == num_of_chunks_;
+		} );
+#if DEFERRED_APPLY_HAS_EXCEPTIONS
+		if ( p_exception_ ) {
+			std::rethrow_exception( p_exception_ );
+		}
+#endif
+	}
+
+private:
+	void run_chunk( size_t chunk_idx )
+	{
+		size_t begin_idx = chunk_idx * grain_size_;
+		size_t end_idx   = ( begin_idx + grain_size_ < num_of_elements_ ) ? begin_idx + grain_size_ : num_of_elements_;
+#if DEFERRED_APPLY_HAS_EXCEPTIONS
+		try {
+#endif
+			for ( size_t i = begin_idx; i < end_idx; i++ ) {
+				apply_to( out_, i );
+			}
+#if DEFERRED_APPLY_HAS_EXCEPTIONS
+		} catch ( ... ) {
+			// チャンクの残りの要素は適用しない。他のチャンクは処理を続け、wait()で最初の例外を再送出する
+			std::lock_guard<std::mutex> lk( mtx_ );
+			if ( !p_exception_ ) {
+				p_exception_ = std::current_exception();
+			}
+		}
+#endif
+	}
+
+	typename std::iterator_traits<RandomIt>::reference element( size_t idx )
+	{
+		return first_[static_cast<typename std::iterator_traits<RandomIt>::difference_type>( idx )];
+	}
+
+	template <typename O>
+	void apply_to( O& out, size_t idx )
+	{
+		out[static_cast<typename std::iterator_traits<O>::difference_type>( idx )] = applier_( element( idx ) );
+	}
+
+	void apply_to( discard_output&, size_t idx )
+	{
+		applier_( element( idx ) );
+	}
+
+	RandomIt                first_;
+	OutIt                   out_;
+	Applier                 applier_;
+	const size_t            num_of_elements_;
+	const size_t            grain_size_;
+	const size_t            num_of_chunks_;
+	std::atomic<size_t>     next_chunk_;    //!< 次に取り出すチャンクの番号
+	std::atomic<size_t>     num_of_done_;   //!< 処理を終えたチャンク数
+	std::mutex              mtx_;
+	std::condition_variable cv_;
+#if DEFERRED_APPLY_HAS_EXCEPTIONS
+	std::exception_ptr p_exception_;   //!< 最初に送出された例外
+#endif
+};
+
+inline size_t number_of_hardware_threads( void )
+{
+	size_t ans = std::thread::hardware_concurrency();
+	return ( ans == 0 ) ? 1 : ans;
+}
+
+template <typename Executor, typename RandomIt, typename OutIt, typename Applier>
+void apply_all_impl( Executor& ex, RandomIt first, RandomIt last, OutIt out, Applier applier, size_t grain_size )
+{
+	using state_t = apply_all_state<RandomIt, OutIt, Applier>;
+
+	size_t num_of_elements = static_cast<size_t>( std::distance( first, last ) );
+	if ( num_of_elements == 0 ) return;
+
+	size_t num_of_threads = number_of_hardware_threads();
+	if ( grain_size == 0 ) {
+		// 処理時間にばらつきがあっても負荷が偏らないように、スレッド数の4倍程度のチャンクに分割する
+		grain_size = ( num_of_elements + num_of_threads * 4 - 1 ) / ( num_of_threads * 4 );
+	}
+
+	std::shared_ptr<state_t> sp_state = std::make_shared<state_t>( first, out, applier, num_of_elements, grain_size );
+
+	// 呼び出したスレッドも1つのチャンクを処理するため、タスクはチャンク数より1つ少なくてよい
+	size_t num_of_tasks = sp_state->number_of_chunks() - 1;
+	if ( num_of_tasks > num_of_threads ) {
+		num_of_tasks = num_of_threads;
+	}
+	for ( size_t i = 0; i < num_of_tasks; i++ ) {
+		ex.post( deferred_apply<void>( [sp_state]() {
+			sp_state->run_chunks();
+		} ) );
+	}
+
+	// エグゼキュータのワーカースレッドから呼び出された場合でもデッドロックしないように、呼び出したスレッドもチャンクを処理する
+	sp_state->run_chunks();
+	sp_state->wait();
+}
+
+}   // namespace deferred_apply_internal
+
+/**
+ * @brief apply_all()で、エグゼキュータを指定しない場合に使用するスレッドプール
+ *
+ * ハードウェアスレッド数のワーカースレッドを持ち、最初の呼び出しで生成される。
+ */
+inline deferred_priority_executor<1>& default_apply_all_executor( void )
+{
+	static deferred_priority_executor<1> ex( deferred_apply_internal::number_of_hardware_threads() );
+	return ex;
+}
+
+/**
+ * @brief Applies each element of [first, last) in parallel on the executor ex, and writes the results to out
+ *
+ * Example of use:
+ * @code {.cpp}
+ * std::vector<deferred_apply<int>> jobs = ...;
+ * std::vector<int>                  results( jobs.size() );
+ * apply_all( jobs.begin(), jobs.end(), results.begin() );   // on the built-in thread pool
+ * @endcode
+ *
+ * The range is split into chunks of grain_size elements, and the worker threads and the calling thread take the chunks one by one.
+ * The result of first[i].apply() is written to out[i]. Therefore, out should be a random access iterator of a preallocated range.
+ * The calling thread also processes chunks, so calling apply_all() from a task of the same executor does not dead-lock.
+ *
+ * If an element throws an exception, the remaining elements of its chunk are not applied,
+ * and the first exception is rethrown after all the other chunks are processed.
+ *
+ * @brief [first, last)の各要素を、エグゼキュータexで並列に適用し、結果をoutに書き込む
+ *
+ * 範囲をgrain_size個毎のチャンクに分割し、ワーカースレッドと呼び出したスレッドがチャンクを1つずつ取り出して処理する。
+ * first[i].apply()の結果は、out[i]に書き込まれる。そのため、outは確保済みの領域のランダムアクセスイテレータであること。
+ * 呼び出したスレッドもチャンクを処理するため、同じエグゼキュータのタスクからapply_all()を呼び出してもデッドロックしない。
+ *
+ * 要素が例外を送出した場合、そのチャンクの残りの要素は適用されず、他のすべてのチャンクを処理した後に最初の例外を再送出する。
+ *
+ * @param ex post( deferred_apply<void>&& )でタスクを投入できるエグゼキュータ
+ * @param grain_size 1つのチャンクの要素数。0の場合は、ハードウェアスレッド数の4倍程度のチャンクとなるように決める
+ */
+template <typename Executor,
+          typename RandomIt,
+          typename OutIt,
+          typename std::enable_if<deferred_apply_internal::is_task_executor<Executor>::value && !std::is_integral<OutIt>::value>::type* = nullptr>
+void apply_all( Executor& ex, RandomIt first, RandomIt last, OutIt out, size_t grain_size = 0 )
+{
+	deferred_apply_internal::apply_all_impl( ex, first, last, out, deferred_apply_internal::element_applier(), grain_size );
+}
+
+/**
+ * @brief Applies each element of [first, last) in parallel on the executor ex, and discards the results
+ *
+ * Example of use:
+ * @code {.cpp}
+ * std::vector<deferred_apply<void>> jobs = ...;
+ * apply_all( ex, jobs.begin(), jobs.end() );
+ * @endcode
+ *
+ * This is used for a range of deferred_apply<void>, which has no result to write. Chunking and exceptions are handled in the same way as apply_all() with out.
+ *
+ * @brief [first, last)の各要素を、エグゼキュータexで並列に適用し、結果は破棄する
+ *
+ * 書き込む結果のない、deferred_apply<void>の範囲に使用する。チャンクへの分割と例外の扱いは、outを指定するapply_all()と同じである。
+ */
+template <typename Executor,
+          typename RandomIt,
+          typename std::enable_if<deferred_apply_internal::is_task_executor<Executor>::value>::type* = nullptr>
+void apply_all( Executor& ex, RandomIt first, RandomIt last, size_t grain_size = 0 )
+{
+	deferred_apply_internal::apply_all_impl( ex, first, last, deferred_apply_internal::discard_output(), deferred_apply_internal::element_applier(), grain_size );
+}
+
+/**
+ * @brief [first, last)のdeferred_applying_argumentsの各要素に、fを並列に適用し、結果をoutに書き込む
+ *
+ * first[i].apply( f )の結果を、out[i]に書き込む。fは、複数のスレッドから同時に呼び出される。
+ */
+template <typename Executor,
+          typename RandomIt,
+          typename OutIt,
+          typename F,
+          typename std::enable_if<deferred_apply_internal::is_task_executor<Executor>::value && !std::is_integral<typename std::decay<F>::type>::value>::type* = nullptr>
+void apply_all( Executor& ex, RandomIt first, RandomIt last, OutIt out, F&& f, size_t grain_size = 0 )
+{
+	using applier_t = deferred_apply_internal::element_applier_with<typename std::remove_reference<F>::type>;
+	deferred_apply_internal::apply_all_impl( ex, first, last, out, applier_t { &f }, grain_size );
+}
+
+/**
+ * @brief [first, last)の各要素を、default_apply_all_executor()で並列に適用し、結果をoutに書き込む
+ */
+template <typename RandomIt,
+          typename OutIt,
+          typename std::enable_if<!deferred_apply_internal::is_task_executor<RandomIt>::value && !std::is_integral<OutIt>::value>::type* = nullptr>
+void apply_all( RandomIt first, RandomIt last, OutIt out, size_t grain_size = 0 )
+{
+	apply_all( default_apply_all_executor(), first, last, out, grain_size );
+}
+
+/**
+ * @brief [first, last)の各要素を、default_apply_all_executor()で並列に適用し、結果は破棄する
+ */
+template <typename RandomIt,
+          typename std::enable_if<!deferred_apply_internal::is_task_executor<RandomIt>::value>::type* = nullptr>
+void apply_all( RandomIt first, RandomIt last, size_t grain_size = 0 )
+{
+	apply_all( default_apply_all_executor(), first, last, grain_size );
+}
+
+/**
+ * @brief [first, last)のdeferred_applying_argumentsの各要素に、default_apply_all_executor()でfを並列に適用し、結果をoutに書き込む
+ */
+template <typename RandomIt,
+          typename OutIt,
+          typename F,
+          typename std::enable_if<!deferred_apply_internal::is_task_executor<RandomIt>::value && !std::is_integral<typename std::decay<F>::type>::value>::type* = nullptr>
+void apply_all( RandomIt first, RandomIt last, OutIt out, F&& f, size_t grain_size = 0 )
+{
+	apply_all( default_apply_all_executor(), first, last, out, std::forward<F>( f ), grain_size );
+}
+
+#endif
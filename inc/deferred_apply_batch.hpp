@@ -0,0 +1,248 @@
+/**
+ * @file deferred_apply_batch.hpp
+ * @author PFA03027@nifty.com
+ * @brief batch of deferred calls that are grouped by their concrete container type and drained without virtual calls
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023, PFA03027@nifty.com
+ *
+ */
+
+#ifndef DEFERRED_APPLY_BATCH_HPP_
+#define DEFERRED_APPLY_BATCH_HPP_
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "deferred_apply.hpp"
+
+/**
+ * @brief deferred_apply_batch::drain()で、関数を呼び出す順序
+ */
+enum class batch_drain_order {
+	grouped_by_type,   //!< 同じ型の関数と引数の組をまとめて呼び出す。型毎の順序は、投入順を保つ
+	fifo,              //!< すべての関数を投入順に呼び出す
+};
+
+/**
+ * @brief Batch of deferred calls that are grouped by their concrete container type and drained without virtual calls
+ *
+ * Example of use:
+ * @code {.cpp}
+ * deferred_apply_batch batch;
+ * for ( auto& msg : received ) {
+ *     batch.push( dispatch_handler, msg.id(), msg.body() );
+ * }
+ * batch.drain();   // or batch.drain( batch_drain_order::fifo ) if the global order matters
+ * @endcode
+ *
+ * deferred_apply<void> calls a function through the vtable of the container that holds it,
+ * so draining a queue that has many different container types causes branch mispredictions and instruction cache misses.
+ * This class stores each call into the bucket of its concrete deferred_apply_container type when it is pushed.
+ * drain() calls the functions of each bucket in a tight loop with a non-virtual, inlinable call,
+ * so the number of virtual calls is the number of buckets instead of the number of calls.
+ *
+ * With batch_drain_order::fifo, the global push order is kept.
+ * In this case, one virtual call is needed for each run of consecutive calls of the same type.
+ *
+ * This class is not thread-safe.
+ *
+ * @brief 具体的なコンテナの型毎にまとめて保持し、仮想関数呼び出しなしに実行する、延期された関数呼び出しのバッチ
+ *
+ * deferred_apply<void>は、保持したコンテナの仮想関数テーブル経由で関数を呼び出すため、
+ * 多くの種類のコンテナが混在したキューを実行すると、分岐予測ミスや命令キャッシュミスが発生する。
+ * 本クラスは、投入時に具体的なdeferred_apply_containerの型毎のバケットに格納する。
+ * drain()は、バケット毎に、仮想関数を経由せずインライン展開可能な呼び出しで関数を連続して実行する。
+ * そのため、仮想関数呼び出しの回数は、関数呼び出しの数ではなくバケットの数となる。
+ *
+ * batch_drain_order::fifo を指定した場合は、全体の投入順を保つ。
+ * この場合は、同じ型が連続した区間毎に、1回の仮想関数呼び出しが必要となる。
+ *
+ * 本クラスは、スレッドセーフではない。
+ *
+ * @warning
+ * 引数はdeferred_apply<void>と同じ方式で保持されるため、左辺値の引数は左辺値参照として保持される。
+ */
+class deferred_apply_batch {
+public:
+	deferred_apply_batch( void )
+	  : buckets_()
+	  , buckets_tag_()
+	  , bucket_index_()
+	  , runs_()
+	  , size_( 0 )
+	{
+	}
+
+	deferred_apply_batch( const deferred_apply_batch& )            = delete;
+	deferred_apply_batch& operator=( const deferred_apply_batch& ) = delete;
+	deferred_apply_batch( deferred_apply_batch&& )                 = default;
+	deferred_apply_batch& operator=( deferred_apply_batch&& )      = default;
+
+	/**
+	 * @brief f(args...)の呼び出しを、バッチに追加する
+	 *
+	 * fの戻り値の型はvoidであること。
+	 */
+	template <typename F, typename... Args>
+	void push( F&& f, Args&&... args )
+	{
+		using cur_container_t = deferred_apply_internal::deferred_apply_container<void(), F, Args&&...>;
+
+		size_t                   bucket_idx = find_or_add_bucket<cur_container_t>();
+		bucket<cur_container_t>* p_bucket   = static_cast<bucket<cur_container_t>*>( buckets_[bucket_idx].get() );
+		p_bucket->items_.emplace_back( std::forward<F>( f ), std::forward<Args>( args )... );
+
+		if ( runs_.empty() || ( runs_.back().bucket_idx_ != bucket_idx ) ) {
+			runs_.emplace_back( bucket_idx );
+		}
+		runs_.back().count_++;
+		size_++;
+	}
+
+	/**
+	 * @brief 保持しているすべての関数を呼び出し、バッチを空にする
+	 *
+	 * 実行中に追加された関数は、次のdrain()で呼び出す。
+	 * 関数が例外を送出した場合、まだ呼び出していない関数は呼び出されずに破棄され、例外はそのまま送出される。
+	 *
+	 * @return 呼び出した関数の数
+	 */
+	size_t drain( batch_drain_order order = batch_drain_order::grouped_by_type )
+	{
+		// 実行中の追加が、実行中のバケットを変更しないように、保持内容を取り出してから実行する
+		deferred_apply_batch cur_batch( std::move( *this ) );
+		clear();
+
+		if ( order == batch_drain_order::fifo ) {
+			for ( auto& cur_run : cur_batch.runs_ ) {
+				cur_batch.buckets_[cur_run.bucket_idx_]->apply_front( cur_run.count_ );
+			}
+		} else {
+			for ( auto& up_bucket : cur_batch.buckets_ ) {
+				up_bucket->apply_front( up_bucket->size() );
+			}
+		}
+
+		return cur_batch.size_;
+	}
+
+	/**
+	 * @brief 保持しているすべての関数を、呼び出さずに破棄する
+	 */
+	void clear( void )
+	{
+		buckets_.clear();
+		buckets_tag_.clear();
+		bucket_index_.clear();
+		runs_.clear();
+		size_ = 0;
+	}
+
+	size_t size( void ) const
+	{
+		return size_;
+	}
+
+	bool empty( void ) const
+	{
+		return size_ == 0;
+	}
+
+	/**
+	 * @brief 保持している関数と引数の組の型の種類数
+	 */
+	size_t number_of_types( void ) const
+	{
+		return buckets_.size();
+	}
+
+private:
+	class bucket_base {
+	public:
+		virtual ~bucket_base()                   = default;
+		virtual void   apply_front( size_t num ) = 0;   //!< 先頭からnum個を呼び出して、取り除く
+		virtual size_t size( void ) const        = 0;
+	};
+
+	template <typename C>
+	class bucket : public bucket_base {
+	public:
+		void apply_front( size_t num ) override
+		{
+			for ( size_t i = 0; i < num; i++ ) {
+				// 型を限定した呼び出しにより、仮想関数テーブルを経由せずに直接呼び出す
+				items_.front().C::apply_func();
+				items_.pop_front();
+			}
+		}
+
+		size_t size( void ) const override
+		{
+			return items_.size();
+		}
+
+		// std::dequeは末尾への追加で既存要素を移動しないため、ムーブやコピーができないコンテナも保持できる
+		std::deque<C> items_;
+	};
+
+	/**
+	 * @brief 型C毎に一意なアドレスを得るためのタグ
+	 */
+	template <typename C>
+	struct type_tag {
+		static const char id;
+	};
+
+	template <typename C>
+	size_t find_or_add_bucket( void )
+	{
+		const void* p_tag = &type_tag<C>::id;
+
+		// 同じ型が連続して追加される場合は、索引を検索しない
+		if ( !runs_.empty() && ( buckets_tag_[runs_.back().bucket_idx_] == p_tag ) ) {
+			return runs_.back().bucket_idx_;
+		}
+
+		auto it = bucket_index_.find( p_tag );
+		if ( it != bucket_index_.end() ) {
+			return it->second;
+		}
+
+		buckets_.emplace_back( new bucket<C>() );
+		buckets_tag_.push_back( p_tag );
+		bucket_index_.emplace( p_tag, buckets_.size() - 1 );
+		return buckets_.size() - 1;
+	}
+
+	/**
+	 * @brief 同じバケットに連続して追加された区間
+	 */
+	struct run_t {
+		explicit run_t( size_t bucket_idx )
+		  : bucket_idx_( bucket_idx )
+		  , count_( 0 )
+		{
+		}
+
+		size_t bucket_idx_;
+		size_t count_;
+	};
+
+	std::vector<std::unique_ptr<bucket_base>> buckets_;        //!< 最初に追加された順のバケット
+	std::vector<const void*>                  buckets_tag_;    //!< buckets_の各バケットの型のタグ
+	std::unordered_map<const void*, size_t>   bucket_index_;   //!< 型のタグから、buckets_のインデックスへの索引
+	std::vector<run_t>                        runs_;           //!< 投入順を保つための、同じバケットが連続した区間の列
+	size_t                                    size_;
+};
+
+template <typename C>
+const char deferred_apply_batch::type_tag<C>::id = 0;
+
+#endif
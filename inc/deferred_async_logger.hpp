@@ -0,0 +1,491 @@
+/**
+ * @file deferred_async_logger.hpp
+ * @author PFA03027@nifty.com
+ * @brief low-latency asynchronous logger that defers formatting and I/O to a background thread
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023, PFA03027@nifty.com
+ *
+ */
+
+#ifndef DEFERRED_ASYNC_LOGGER_HPP_
+#define DEFERRED_ASYNC_LOGGER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "deferred_apply.hpp"
+
+namespace deferred_apply_internal {
+
+/**
+ * @brief 1つの生産者スレッドと1つの消費者スレッドの間で、要素を受け渡すためのリングバッファ
+ *
+ * 要素は、リングバッファ内の領域に直接構築される。
+ *
+ * @tparam T 要素の型
+ */
+template <typename T>
+class spsc_ring {
+public:
+	explicit spsc_ring( size_t capacity )
+	  : capacity_( round_up_pow2( capacity ) )
+	  , mask_( capacity_ - 1 )
+	  , up_slots_( new slot_t[capacity_] )
+	  , head_( 0 )
+	  , tail_( 0 )
+	  , head_cache_( 0 )
+	  , dropped_( 0 )
+	{
+	}
+
+	spsc_ring( const spsc_ring& )            = delete;
+	spsc_ring& operator=( const spsc_ring& ) = delete;
+
+	~spsc_ring()
+	{
+		size_t cur_head = head_.load( std::memory_order_relaxed );
+		size_t cur_tail = tail_.load( std::memory_order_relaxed );
+		for ( ; cur_head != cur_tail; cur_head++ ) {
+			slot_ptr( cur_head )->~T();
+		}
+	}
+
+	/**
+	 * @brief 生産者スレッドから呼び出し、要素をリングバッファ内に構築する
+	 *
+	 * @retval true 構築した
+	 * @retval false リングバッファに空きがないため、構築しなかった
+	 */
+	template <typename... XArgs>
+	bool try_emplace( XArgs&&... args )
+	{
+		size_t cur_tail = tail_.load( std::memory_order_relaxed );
+		if ( ( cur_tail - head_cache_ ) >= capacity_ ) {
+			head_cache_ = head_.load( std::memory_order_acquire );
+			if ( ( cur_tail - head_cache_ ) >= capacity_ ) {
+				dropped_.store( dropped_.load( std::memory_order_relaxed ) + 1, std::memory_order_relaxed );
+				return false;
+			}
+		}
+
+		new ( slot_ptr( cur_tail ) ) T( std::forward<XArgs>( args )... );
+		tail_.store( cur_tail + 1, std::memory_order_release );
+		return true;
+	}
+
+	/**
+	 * @brief 消費者スレッドから呼び出し、取り出し可能な要素すべてにfを適用してから破棄する
+	 *
+	 * @return 処理した要素数
+	 */
+	template <typename F>
+	size_t consume_all( F&& f )
+	{
+		size_t cur_head = head_.load( std::memory_order_relaxed );
+		size_t cur_tail = tail_.load( std::memory_order_acquire );
+		size_t ans      = cur_tail - cur_head;
+		for ( ; cur_head != cur_tail; cur_head++ ) {
+			T* p = slot_ptr( cur_head );
+			f( *p );
+			p->~T();
+			head_.store( cur_head + 1, std::memory_order_release );
+		}
+		return ans;
+	}
+
+	bool empty( void ) const
+	{
+		return head_.load( std::memory_order_acquire ) == tail_.load( std::memory_order_acquire );
+	}
+
+	size_t capacity( void ) const
+	{
+		return capacity_;
+	}
+
+	size_t dropped( void ) const
+	{
+		return dropped_.load( std::memory_order_relaxed );
+	}
+
+private:
+	using slot_t = typename std::aligned_storage<sizeof( T ), alignof( T )>::type;
+
+	static constexpr size_t cache_line_size = 64;
+
+	static size_t round_up_pow2( size_t x )
+	{
+		size_t ans = 1;
+		while ( ans < x ) {
+			ans <<= 1;
+		}
+		return ans;
+	}
+
+	T* slot_ptr( size_t idx )
+	{
+		return reinterpret_cast<T*>( &( up_slots_[idx & mask_] ) );
+	}
+
+	const size_t              capacity_;
+	const size_t              mask_;
+	std::unique_ptr<slot_t[]> up_slots_;
+
+	// 生産者と消費者が更新する変数が同じキャッシュラインに配置されないように、間にパディングを置く。
+	// C++17より前のnewは64バイトのアライメントを保証しないため、alignasではなくパディングで実現する。
+	char                pad1_[cache_line_size];
+	std::atomic<size_t> head_;   //!< 消費者が更新する
+	char                pad2_[cache_line_size];
+	std::atomic<size_t> tail_;         //!< 生産者が更新する
+	size_t              head_cache_;   //!< 生産者が最後に読み出したhead_の値
+	std::atomic<size_t> dropped_;      //!< 生産者が更新する、空きがないため破棄した要素数
+	char                pad3_[cache_line_size];
+};
+
+/**
+ * @brief printf系関数に渡せるように、c_str()を持つ引数をconst char*に変換する
+ */
+struct printf_arg_converter {
+	template <typename T>
+	static auto convert( T& t, int ) -> decltype( t.c_str() )
+	{
+		return t.c_str();
+	}
+
+	template <typename T>
+	static T& convert( T& t, long )
+	{
+		return t;
+	}
+};
+
+/**
+ * @brief 書式と引数を受け取り、出力先のFILEに書き込む関数オブジェクト
+ */
+class fprintf_writer {
+public:
+	explicit fprintf_writer( FILE* p_out )
+	  : p_out_( p_out )
+	{
+	}
+
+	template <typename... Args>
+	void operator()( const char* fmt, Args&&... args )
+	{
+		fprintf( p_out_, fmt, printf_arg_converter::convert( args, 0 )... );
+	}
+
+private:
+	FILE* p_out_;
+};
+
+}   // namespace deferred_apply_internal
+
+/**
+ * @brief Low-latency asynchronous logger that defers formatting and I/O to a background thread
+ *
+ * Example of use:
+ * @code {.cpp}
+ * deferred_async_logger<> logger( stderr );
+ * logger.log( "request %d: %s\n", id, std::string( "done" ) );
+ * @endcode
+ *
+ * The caller only captures the format string and the arguments into the per-thread SPSC ring as a deferred_apply record.
+ * The background thread formats them by fprintf() and writes them to the output FILE.
+ * No memory is allocated in log() for the record itself, and a record that does not fit in RecordBufferSize bytes is a compile error.
+ * When a thread exits, its ring is retired, and the background thread frees it after writing the remaining records.
+ *
+ * Unlike deferred_apply<R>, all arguments are captured by value, so they never become dangling references.
+ * Arguments that have member function c_str() (e.g. std::string) are passed to fprintf() as the return value of c_str().
+ *
+ * @warning
+ * Array and pointer arguments (e.g. char buffer on the stack) are captured as pointers, so the pointed data must be alive until it is written.
+ * String literals are always safe.
+ *
+ * @brief 書式化とI/Oをバックグラウンドスレッドで行う、低レイテンシの非同期ロガー
+ *
+ * 呼び出し元は、書式文字列と引数をdeferred_applyのレコードとして、スレッド毎のSPSCリングバッファに保存するだけである。
+ * バックグラウンドスレッドが、fprintf()による書式化と出力先FILEへの書き込みを行う。
+ * log()では、レコードのためのメモリ確保は発生しない。RecordBufferSizeバイトに収まらないレコードはコンパイルエラーとなる。
+ * スレッドの終了時に、そのスレッドのリングバッファは退役し、バックグラウンドスレッドが残りのレコードを出力してから解放する。
+ *
+ * deferred_apply<R>とは異なり、すべての引数を値としてキャプチャするため、ダングリング参照とはならない。
+ * メンバ関数c_str()を持つ引数(std::string等)は、c_str()の戻り値としてfprintf()に渡される。
+ *
+ * @warning
+ * 配列型やポインタ型の引数(スタック上のcharバッファ等)はポインタとしてキャプチャされるため、書き込まれるまで指す先が生存していなければならない。
+ * 文字列リテラルは常に安全である。
+ *
+ * @tparam RecordBufferSize 1レコードの書式文字列と引数を保持するバッファのサイズ
+ */
+template <size_t RecordBufferSize = deferred_apply_default_buffer_size>
+class deferred_async_logger {
+public:
+	using record_t = inplace_deferred_apply<void, RecordBufferSize>;
+
+	/**
+	 * @param p_out 出力先
+	 * @param ring_capacity スレッド毎のリングバッファに保持できるレコード数。2のべき乗に切り上げられる。
+	 * @param idle_wait 出力するレコードがない場合に、バックグラウンドスレッドが待機する時間
+	 */
+	explicit deferred_async_logger( FILE* p_out = stderr, size_t ring_capacity = 1024, std::chrono::microseconds idle_wait = std::chrono::microseconds( 100 ) )
+	  : logger_id_( next_logger_id().fetch_add( 1 ) )
+	  , p_out_( p_out )
+	  , ring_capacity_( ring_capacity )
+	  , idle_wait_( idle_wait )
+	  , rings_mtx_()
+	  , rings_()
+	  , rings_version_( 0 )
+	  , num_of_retired_dropped_( 0 )
+	  , consumer_rings_()
+	  , consumer_version_( 0 )
+	  , stop_mtx_()
+	  , stop_cv_()
+	  , stop_( false )
+	  , consumer_()
+	{
+		consumer_ = std::thread( &deferred_async_logger::consumer_loop, this );
+	}
+
+	deferred_async_logger( const deferred_async_logger& )            = delete;
+	deferred_async_logger& operator=( const deferred_async_logger& ) = delete;
+
+	/**
+	 * @brief 保存済みのレコードをすべて出力してから、バックグラウンドスレッドを終了する
+	 */
+	~deferred_async_logger()
+	{
+		{
+			std::lock_guard<std::mutex> lk( stop_mtx_ );
+			stop_ = true;
+		}
+		stop_cv_.notify_all();
+		consumer_.join();
+		fflush( p_out_ );
+	}
+
+	/**
+	 * @brief 書式fmtと引数argsをレコードとして保存する。書式化と出力は、バックグラウンドスレッドで行う。
+	 *
+	 * @param fmt 書式文字列。レコードが出力されるまで生存していること。通常は文字列リテラルを指定する。
+	 *
+	 * @retval true 保存した
+	 * @retval false 呼び出したスレッドのリングバッファに空きがないため、破棄した
+	 */
+	template <typename... Args>
+	bool log( const char* fmt, Args&&... args )
+	{
+		// 書式文字列と引数は、decayした型の一時オブジェクトとして渡すことで、参照ではなく値として保持させる
+		return get_ring()->try_emplace( deferred_apply_internal::fprintf_writer( p_out_ ), static_cast<const char*>( fmt ), typename std::decay<Args>::type( std::forward<Args>( args ) )... );
+	}
+
+	/**
+	 * @brief 保存済みのレコードがすべて出力されるまで待つ
+	 */
+	void flush( void )
+	{
+		while ( !all_rings_empty() ) {
+			std::this_thread::yield();
+		}
+		fflush( p_out_ );
+	}
+
+	/**
+	 * @brief リングバッファに空きがないため、破棄したレコード数
+	 */
+	size_t dropped( void ) const
+	{
+		std::lock_guard<std::mutex> lk( rings_mtx_ );
+		size_t                      ans = num_of_retired_dropped_;
+		for ( const auto& sp_ring : rings_ ) {
+			ans += sp_ring->ring_.dropped();
+		}
+		return ans;
+	}
+
+	/**
+	 * @brief 登録中のリングバッファ数。終了したスレッドのリングバッファは、残りのレコードの出力後に登録から外れる
+	 */
+	size_t number_of_rings( void ) const
+	{
+		std::lock_guard<std::mutex> lk( rings_mtx_ );
+		return rings_.size();
+	}
+
+private:
+	using ring_t = deferred_apply_internal::spsc_ring<record_t>;
+
+	/**
+	 * @brief 1つの生産者スレッドのリングバッファ
+	 *
+	 * ロガーと生産者スレッドのどちらが先に終了しても解放できるように、両者がstd::shared_ptrで所有する。
+	 */
+	struct ring_entry {
+		explicit ring_entry( size_t capacity )
+		  : ring_( capacity )
+		  , is_retired_( false )
+		{
+		}
+
+		ring_t            ring_;
+		std::atomic<bool> is_retired_;   //!< 生産者スレッドが終了し、以降はレコードが追加されないかどうか
+	};
+
+	struct tls_entry {
+		uint64_t                    logger_id_;
+		std::shared_ptr<ring_entry> sp_ring_;
+	};
+
+	/**
+	 * @brief スレッド毎の、ロガー毎のリングバッファの一覧。スレッドの終了時に、すべてのリングバッファを退役させる
+	 */
+	struct tls_rings {
+		~tls_rings()
+		{
+			for ( auto& e : entries_ ) {
+				e.sp_ring_->is_retired_.store( true, std::memory_order_release );
+			}
+		}
+
+		std::vector<tls_entry> entries_;
+	};
+
+	static std::atomic<uint64_t>& next_logger_id( void )
+	{
+		static std::atomic<uint64_t> id( 0 );
+		return id;
+	}
+
+	/**
+	 * @brief 呼び出したスレッド専用のリングバッファを取得する。初回のみ、リングバッファを生成して登録する。
+	 */
+	ring_t* get_ring( void )
+	{
+		static thread_local tls_rings tls;
+
+		// ロガーIDは再利用されないため、破棄されたロガーのエントリが誤って一致することはない
+		for ( const auto& e : tls.entries_ ) {
+			if ( e.logger_id_ == logger_id_ ) return &( e.sp_ring_->ring_ );
+		}
+
+		// 破棄されたロガーのリングバッファは、本スレッドだけが所有しているため、ここで解放する
+		for ( size_t i = 0; i < tls.entries_.size(); ) {
+			if ( tls.entries_[i].sp_ring_.use_count() == 1 ) {
+				tls.entries_[i] = std::move( tls.entries_.back() );
+				tls.entries_.pop_back();
+			} else {
+				i++;
+			}
+		}
+
+		std::shared_ptr<ring_entry> sp_ring = std::make_shared<ring_entry>( ring_capacity_ );
+		{
+			std::lock_guard<std::mutex> lk( rings_mtx_ );
+			rings_.push_back( sp_ring );
+			rings_version_.fetch_add( 1, std::memory_order_release );
+		}
+		tls.entries_.push_back( tls_entry { logger_id_, sp_ring } );
+		return &( sp_ring->ring_ );
+	}
+
+	bool all_rings_empty( void ) const
+	{
+		std::lock_guard<std::mutex> lk( rings_mtx_ );
+		for ( const auto& sp_ring : rings_ ) {
+			if ( !sp_ring->ring_.empty() ) return false;
+		}
+		return true;
+	}
+
+	size_t consume_once( void )
+	{
+		// リングバッファが追加、あるいは解放された場合のみ、ロックを取得して消費者スレッド用の一覧を更新する
+		size_t cur_version = rings_version_.load( std::memory_order_acquire );
+		if ( consumer_version_ != cur_version ) {
+			std::lock_guard<std::mutex> lk( rings_mtx_ );
+			consumer_rings_.clear();
+			for ( const auto& sp_ring : rings_ ) {
+				consumer_rings_.push_back( sp_ring.get() );
+			}
+			consumer_version_ = rings_version_.load( std::memory_order_relaxed );
+		}
+
+		size_t ans         = 0;
+		bool   has_retired = false;
+		for ( auto p_ring : consumer_rings_ ) {
+			// 退役を確認してから消費することで、退役前に追加されたレコードをすべて出力する
+			if ( p_ring->is_retired_.load( std::memory_order_acquire ) ) {
+				has_retired = true;
+			}
+			ans += p_ring->ring_.consume_all( []( record_t& rec ) { rec.apply(); } );
+		}
+		if ( has_retired ) {
+			release_retired_rings();
+		}
+		return ans;
+	}
+
+	/**
+	 * @brief 退役し、空になったリングバッファを登録から外す。消費者スレッドから呼び出す
+	 */
+	void release_retired_rings( void )
+	{
+		std::lock_guard<std::mutex> lk( rings_mtx_ );
+		for ( size_t i = 0; i < rings_.size(); ) {
+			ring_entry& cur = *rings_[i];
+			if ( cur.is_retired_.load( std::memory_order_acquire ) && cur.ring_.empty() ) {
+				num_of_retired_dropped_ += cur.ring_.dropped();
+				rings_[i] = std::move( rings_.back() );
+				rings_.pop_back();
+			} else {
+				i++;
+			}
+		}
+		rings_version_.fetch_add( 1, std::memory_order_release );
+	}
+
+	void consumer_loop( void )
+	{
+		while ( true ) {
+			if ( consume_once() > 0 ) continue;
+
+			std::unique_lock<std::mutex> lk( stop_mtx_ );
+			if ( stop_ ) break;
+			stop_cv_.wait_for( lk, idle_wait_ );
+		}
+
+		// 終了前に、残っているレコードをすべて出力する
+		while ( consume_once() > 0 ) {
+		}
+	}
+
+	const uint64_t                       logger_id_;
+	FILE* const                          p_out_;
+	const size_t                         ring_capacity_;
+	const std::chrono::microseconds      idle_wait_;
+	mutable std::mutex                       rings_mtx_;
+	std::vector<std::shared_ptr<ring_entry>> rings_;
+	std::atomic<size_t>                      rings_version_;            //!< rings_を変更する毎に増やす
+	size_t                                   num_of_retired_dropped_;   //!< 解放したリングバッファで、破棄したレコード数
+	std::vector<ring_entry*>                 consumer_rings_;           //!< 消費者スレッドのみが参照する、rings_の複製
+	size_t                                   consumer_version_;         //!< consumer_rings_を複製した時点のrings_version_
+	std::mutex                               stop_mtx_;
+	std::condition_variable                  stop_cv_;
+	bool                                     stop_;
+	std::thread                              consumer_;
+};
+
+#endif
@@ -0,0 +1,337 @@
+/**
+ * @file deferred_coalescing_queue.hpp
+ * @author PFA03027@nifty.com
+ * @brief FIFO queue of deferred_apply<void> that replaces a pending task of the same key
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023, PFA03027@nifty.com
+ *
+ */
+
+#ifndef DEFERRED_COALESCING_QUEUE_HPP_
+#define DEFERRED_COALESCING_QUEUE_HPP_
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include "deferred_apply.hpp"
+
+/**
+ * @brief FIFO queue of deferred_apply<void> that replaces a superseded pending task of the same key
+ *
+ * Example of use:
+ * @code {.cpp}
+ * deferred_coalescing_queue<int> q;
+ * q.push( object_id, recompute, object_id, latest_input1 );
+ * q.push( object_id, recompute, object_id, latest_input2 );   // replaces the pending one
+ * q.run_all();                                               // recompute() is called only once with latest_input2
+ * @endcode
+ *
+ * If a task of the same key is pending, push() replaces it in place and keeps its FIFO position.
+ * The new function and arguments are constructed directly in the storage of the pending task by deferred_apply::emplace(),
+ * so the inline buffer is reused without allocation as long as they fit in it.
+ *
+ * push(), try_pop(), run_one() and run_all() are thread-safe. Tasks are executed without holding the lock.
+ *
+ * @brief 同じキーの実行待ちタスクを置き換える、deferred_apply<void>のFIFOキュー
+ *
+ * 同じキーのタスクが実行待ちとなっている場合、push()はそのタスクをFIFO上の位置を保ったまま置き換える。
+ * 新しい関数と引数は、deferred_apply::emplace()により実行待ちタスクの領域に直接構築されるため、
+ * 内部バッファに収まる限り、メモリ確保なしに内部バッファが再利用される。
+ *
+ * push(), try_pop(), run_one(), run_all()はスレッドセーフである。タスクはロックを保持せずに実行される。
+ *
+ * @warning
+ * 引数はdeferred_apply<void>と同じ方式で保持されるため、左辺値の引数は左辺値参照として保持される。
+ *
+ * @tparam Key キーの型
+ * @tparam Hash キーのハッシュ関数
+ * @tparam KeyEqual キーの比較関数
+ */
+template <typename Key, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class deferred_coalescing_queue {
+public:
+	deferred_coalescing_queue( void )
+	  : mtx_()
+	  , nodes_()
+	  , index_()
+	  , head_( npos )
+	  , tail_( npos )
+	  , free_head_( npos )
+	  , num_of_coalesced_( 0 )
+	{
+	}
+
+	deferred_coalescing_queue( const deferred_coalescing_queue& )            = delete;
+	deferred_coalescing_queue& operator=( const deferred_coalescing_queue& ) = delete;
+
+	/**
+	 * @brief キーkeyのタスクとして、f(args...)を投入する
+	 *
+	 * fの戻り値の型はvoidであること。
+	 * 関数や引数の構築が例外を送出した場合、キーkeyの実行待ちタスクはなくなる。置き換え前のタスクは、構築の前に破棄済みのため。
+	 *
+	 * @retval true 新たに末尾に追加した
+	 * @retval false 同じキーの実行待ちタスクを置き換えた
+	 */
+	template <typename F,
+	          typename... Args,
+	          typename std::enable_if<!std::is_same<typename std::decay<F>::type, deferred_apply<void>>::value>::type* = nullptr>
+	bool push( const Key& key, F&& f, Args&&... args )
+	{
+		std::lock_guard<std::mutex> lk( mtx_ );
+
+		auto it = index_.find( key );
+		if ( it != index_.end() ) {
+			size_t idx = it->second;
+#if DEFERRED_APPLY_HAS_EXCEPTIONS
+			try {
+#endif
+				nodes_[idx].task_.emplace( std::forward<F>( f ), std::forward<Args>( args )... );
+#if DEFERRED_APPLY_HAS_EXCEPTIONS
+			} catch ( ... ) {
+				// 空のタスクを実行待ちとして残さないように、ノードごと取り除く
+				index_.erase( it );
+				unlink( idx );
+				release_node( idx );
+				throw;
+			}
+#endif
+			num_of_coalesced_++;
+			return false;
+		}
+
+		size_t idx = allocate_node( key );
+#if DEFERRED_APPLY_HAS_EXCEPTIONS
+		try {
+#endif
+			nodes_[idx].task_.emplace( std::forward<F>( f ), std::forward<Args>( args )... );
+			index_.emplace( key, idx );
+#if DEFERRED_APPLY_HAS_EXCEPTIONS
+		} catch ( ... ) {
+			release_node( idx );
+			throw;
+		}
+#endif
+		link_tail( idx );
+		return true;
+	}
+
+	/**
+	 * @brief キーkeyのタスクとして、taskを投入する
+	 *
+	 * @retval true 新たに末尾に追加した
+	 * @retval false 同じキーの実行待ちタスクを置き換えた
+	 */
+	bool push( const Key& key, deferred_apply<void>&& task )
+	{
+		std::lock_guard<std::mutex> lk( mtx_ );
+
+		auto it = index_.find( key );
+		if ( it != index_.end() ) {
+			nodes_[it->second].task_ = std::move( task );
+			num_of_coalesced_++;
+			return false;
+		}
+
+		size_t idx = allocate_node( key );
+#if DEFERRED_APPLY_HAS_EXCEPTIONS
+		try {
+#endif
+			index_.emplace( key, idx );
+#if DEFERRED_APPLY_HAS_EXCEPTIONS
+		} catch ( ... ) {
+			release_node( idx );
+			throw;
+		}
+#endif
+		nodes_[idx].task_ = std::move( task );
+		link_tail( idx );
+		return true;
+	}
+
+	/**
+	 * @brief 先頭のタスクを取り出す
+	 *
+	 * @retval true 取り出した
+	 * @retval false キューが空
+	 */
+	bool try_pop( deferred_apply<void>& task )
+	{
+		std::lock_guard<std::mutex> lk( mtx_ );
+		if ( head_ == npos ) return false;
+
+		size_t idx = head_;
+		task       = std::move( nodes_[idx].task_ );
+		unlink( idx );
+		index_.erase( nodes_[idx].key_ );
+		release_node( idx );
+		return true;
+	}
+
+	/**
+	 * @brief キーkeyの実行待ちタスクを、実行せずに破棄する
+	 *
+	 * @retval true 破棄した
+	 * @retval false キーkeyの実行待ちタスクはない
+	 */
+	bool erase( const Key& key )
+	{
+		std::lock_guard<std::mutex> lk( mtx_ );
+
+		auto it = index_.find( key );
+		if ( it == index_.end() ) return false;
+
+		size_t idx = it->second;
+		index_.erase( it );
+		unlink( idx );
+		release_node( idx );
+		return true;
+	}
+
+	/**
+	 * @brief 先頭のタスクを取り出して実行する
+	 *
+	 * @retval true 実行した
+	 * @retval false キューが空
+	 */
+	bool run_one( void )
+	{
+		deferred_apply<void> task;
+		if ( !try_pop( task ) ) return false;
+		task.apply();
+		return true;
+	}
+
+	/**
+	 * @brief 呼び出した時点で実行待ちのタスクを、すべて実行する
+	 *
+	 * 実行中に投入されたタスクは、次の呼び出しで実行する。
+	 *
+	 * @return 実行したタスク数
+	 */
+	size_t run_all( void )
+	{
+		size_t num = size();
+		size_t ans = 0;
+		for ( ; ans < num; ans++ ) {
+			if ( !run_one() ) break;
+		}
+		return ans;
+	}
+
+	bool contains( const Key& key ) const
+	{
+		std::lock_guard<std::mutex> lk( mtx_ );
+		return index_.find( key ) != index_.end();
+	}
+
+	size_t size( void ) const
+	{
+		std::lock_guard<std::mutex> lk( mtx_ );
+		return index_.size();
+	}
+
+	bool empty( void ) const
+	{
+		return size() == 0;
+	}
+
+	/**
+	 * @brief 実行待ちタスクを置き換えた回数。すなわち、実行を省略できたタスク数
+	 */
+	size_t number_of_coalesced( void ) const
+	{
+		std::lock_guard<std::mutex> lk( mtx_ );
+		return num_of_coalesced_;
+	}
+
+private:
+	static constexpr size_t npos = static_cast<size_t>( -1 );
+
+	struct node {
+		explicit node( const Key& key )
+		  : key_( key )
+		  , task_()
+		  , prev_( npos )
+		  , next_( npos )
+		{
+		}
+
+		Key                  key_;
+		deferred_apply<void> task_;
+		size_t               prev_;
+		size_t               next_;
+	};
+
+	size_t allocate_node( const Key& key )
+	{
+		if ( free_head_ == npos ) {
+			// std::dequeは末尾への追加で既存要素を移動しないため、保持しているタスクのムーブやコピーが発生しない
+			nodes_.emplace_back( key );
+			return nodes_.size() - 1;
+		}
+
+		// キーのコピーが例外を送出しても空きリストが壊れないように、コピーしてから空きリストから外す
+		size_t idx       = free_head_;
+		nodes_[idx].key_ = key;
+		free_head_       = nodes_[idx].next_;
+		return idx;
+	}
+
+	void release_node( size_t idx )
+	{
+		nodes_[idx].task_.reset();
+		nodes_[idx].prev_ = npos;
+		nodes_[idx].next_ = free_head_;
+		free_head_        = idx;
+	}
+
+	void link_tail( size_t idx )
+	{
+		nodes_[idx].prev_ = tail_;
+		nodes_[idx].next_ = npos;
+		if ( tail_ != npos ) {
+			nodes_[tail_].next_ = idx;
+		} else {
+			head_ = idx;
+		}
+		tail_ = idx;
+	}
+
+	void unlink( size_t idx )
+	{
+		node& cur_node = nodes_[idx];
+		if ( cur_node.prev_ != npos ) {
+			nodes_[cur_node.prev_].next_ = cur_node.next_;
+		} else {
+			head_ = cur_node.next_;
+		}
+		if ( cur_node.next_ != npos ) {
+			nodes_[cur_node.next_].prev_ = cur_node.prev_;
+		} else {
+			tail_ = cur_node.prev_;
+		}
+		cur_node.prev_ = npos;
+		cur_node.next_ = npos;
+	}
+
+	mutable std::mutex                             mtx_;
+	std::deque<node>                               nodes_;
+	std::unordered_map<Key, size_t, Hash, KeyEqual> index_;   //!< キーから、実行待ちタスクのノードへの索引
+	size_t                                         head_;
+	size_t                                         tail_;
+	size_t                                         free_head_;
+	size_t                                         num_of_coalesced_;
+};
+
+template <typename Key, typename Hash, typename KeyEqual>
+constexpr size_t deferred_coalescing_queue<Key, Hash, KeyEqual>::npos;
+
+#endif
@@ -0,0 +1,413 @@
+/**
+ * @file deferred_epoch_reclaimer.hpp
+ * @author PFA03027@nifty.com
+ * @brief epoch based reclamation that applies retired deferred_apply<void> cleanups after all readers have left the epoch
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023, PFA03027@nifty.com
+ *
+ */
+
+#ifndef DEFERRED_EPOCH_RECLAIMER_HPP_
+#define DEFERRED_EPOCH_RECLAIMER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "deferred_apply.hpp"
+
+/**
+ * @brief Epoch based reclamation that applies retired deferred_apply<void> cleanups after all readers have left the epoch
+ *
+ * Example of use:
+ * @code {.cpp}
+ * deferred_epoch_reclaimer reclaimer;
+ *
+ * // reader thread
+ * deferred_epoch_reclaimer::reader rd( reclaimer );   // once per thread
+ * {
+ *     deferred_epoch_reclaimer::guard g( rd );
+ *     const table* p = p_current_table.load( std::memory_order_acquire );
+ *     lookup( p, key );
+ * }
+ *
+ * // writer thread
+ * table* p_old = p_current_table.exchange( p_new_table );
+ * reclaimer.retire( std::default_delete<table>(), p_old );   // deleted after every reader has left
+ * @endcode
+ *
+ * A reader announces the global epoch when it enters a critical section, and clears it when it exits.
+ * Both are a store to the slot owned by the reader and need no lock and no read-modify-write operation.
+ * retire() records the cleanup together with the global epoch at that time.
+ * collect() advances the global epoch if every active reader has announced the current epoch,
+ * and applies the cleanups that were retired before the oldest epoch announced by the active readers.
+ *
+ * If config::use_background_thread is true, a background thread calls collect() and applies the cleanups.
+ * Therefore, the destruction of large objects does not occur on the thread that calls retire().
+ * Otherwise, retire() calls collect() when the number of pending cleanups reaches config::collect_threshold.
+ *
+ * @brief すべてのリーダーがエポックを抜けた後に、リタイアしたdeferred_apply<void>の後始末を適用するエポックベースの回収機構
+ *
+ * リーダーはクリティカルセクションに入るときにグローバルエポックを公開し、出るときに公開を取り消す。
+ * いずれもリーダーが占有するスロットへのストアであり、ロックやread-modify-write操作を必要としない。
+ * retire()は、後始末をその時点のグローバルエポックと共に記録する。
+ * collect()は、すべての活動中のリーダーが現在のエポックを公開していれば、グローバルエポックを進め、
+ * 活動中のリーダーが公開している最も古いエポックより前にリタイアした後始末を適用する。
+ *
+ * config::use_background_thread がtrueの場合は、バックグラウンドスレッドがcollect()を呼び出し、後始末を適用する。
+ * そのため、大きなオブジェクトの破棄が、retire()を呼び出したスレッドで発生しない。
+ * falseの場合は、実行待ちの後始末の数が config::collect_threshold に達したときに、retire()がcollect()を呼び出す。
+ *
+ * @warning
+ * 書き込み側は、リーダーから到達できないようにオブジェクトを切り離してからretire()を呼び出すこと。 @n
+ * リーダーは、guardの生存期間外で取得したポインタを使用してはならない。 @n
+ * 後始末は例外を送出してはならない。 @n
+ * 本クラスの破棄時には、すべてのreaderが破棄済みであること。実行待ちの後始末は、破棄時にすべて適用される。
+ */
+class deferred_epoch_reclaimer {
+	struct reader_slot;
+
+public:
+	/**
+	 * @brief 同時に登録できるリーダー数を超えた場合の例外
+	 */
+	class too_many_readers : public std::runtime_error {
+	public:
+		too_many_readers( void )
+		  : std::runtime_error( "number of readers of deferred_epoch_reclaimer exceeds config::max_readers" )
+		{
+		}
+	};
+
+	/**
+	 * @brief 回収機構の動作設定
+	 */
+	struct config {
+		config( void )
+		  : max_readers( 128 )
+		  , collect_threshold( 64 )
+		  , use_background_thread( false )
+		  , background_interval( std::chrono::milliseconds( 1 ) )
+		{
+		}
+
+		size_t                    max_readers;             //!< 同時に登録できるリーダー数
+		size_t                    collect_threshold;       //!< collect()を行う、実行待ちの後始末の数
+		bool                      use_background_thread;   //!< バックグラウンドスレッドで後始末を適用するかどうか
+		std::chrono::microseconds background_interval;     //!< バックグラウンドスレッドがcollect()を行う間隔
+	};
+
+	class reader;
+
+	/**
+	 * @brief リーダーのクリティカルセクションを表すRAIIクラス
+	 */
+	class guard {
+	public:
+		explicit guard( reader& rd )
+		  : rd_( rd )
+		{
+			rd_.enter();
+		}
+
+		~guard()
+		{
+			rd_.exit();
+		}
+
+		guard( const guard& )            = delete;
+		guard& operator=( const guard& ) = delete;
+
+	private:
+		reader& rd_;
+	};
+
+	/**
+	 * @brief リーダーとして登録したスレッドのハンドル
+	 *
+	 * スレッド毎に1つ構築し、そのスレッドからだけ使用すること。
+	 * 登録済みのリーダー数が config::max_readers に達している場合は、 too_many_readers 例外を送出する。
+	 */
+	class reader {
+	public:
+		explicit reader( deferred_epoch_reclaimer& owner )
+		  : owner_( owner )
+		  , p_slot_( owner.acquire_slot() )
+		{
+		}
+
+		~reader()
+		{
+			owner_.release_slot( p_slot_ );
+		}
+
+		reader( const reader& )            = delete;
+		reader& operator=( const reader& ) = delete;
+
+		/**
+		 * @brief クリティカルセクションに入る。入れ子にできる
+		 */
+		void enter( void )
+		{
+			if ( p_slot_->depth_++ != 0 ) return;
+
+			p_slot_->epoch_.store( owner_.global_epoch_.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+			// 公開したエポックが、以降の共有データの読み出しより先に、collect()から見えるようにする
+			std::atomic_thread_fence( std::memory_order_seq_cst );
+		}
+
+		/**
+		 * @brief クリティカルセクションから出る
+		 */
+		void exit( void )
+		{
+			if ( --p_slot_->depth_ != 0 ) return;
+
+			p_slot_->epoch_.store( inactive_epoch, std::memory_order_release );
+		}
+
+	private:
+		deferred_epoch_reclaimer& owner_;
+		reader_slot*              p_slot_;
+	};
+
+	explicit deferred_epoch_reclaimer( const config& cfg = config() )
+	  : cfg_( cfg )
+	  , global_epoch_( 0 )
+	  , up_slots_( new reader_slot[( cfg.max_readers == 0 ) ? 1 : cfg.max_readers] )
+	  , num_of_slots_( ( cfg.max_readers == 0 ) ? 1 : cfg.max_readers )
+	  , mtx_()
+	  , cv_()
+	  , retired_()
+	  , stop_( false )
+	  , background_thread_()
+	{
+		if ( cfg_.use_background_thread ) {
+			background_thread_ = std::thread( &deferred_epoch_reclaimer::background_loop, this );
+		}
+	}
+
+	deferred_epoch_reclaimer( const deferred_epoch_reclaimer& )            = delete;
+	deferred_epoch_reclaimer& operator=( const deferred_epoch_reclaimer& ) = delete;
+
+	/**
+	 * @brief バックグラウンドスレッドを終了し、実行待ちのすべての後始末を適用する
+	 */
+	~deferred_epoch_reclaimer()
+	{
+		if ( background_thread_.joinable() ) {
+			{
+				std::lock_guard<std::mutex> lk( mtx_ );
+				stop_ = true;
+			}
+			cv_.notify_all();
+			background_thread_.join();
+		}
+
+		// すべてのリーダーが破棄済みのため、エポックによらず適用できる
+		while ( !retired_.empty() ) {
+			retired_.front().cleanup_.apply();
+			retired_.pop_front();
+		}
+	}
+
+	/**
+	 * @brief f(args...)を実行する後始末をリタイアする
+	 *
+	 * fの戻り値の型はvoidであること。
+	 */
+	template <typename F,
+	          typename... Args,
+	          typename std::enable_if<!std::is_same<typename std::decay<F>::type, deferred_apply<void>>::value>::type* = nullptr>
+	void retire( F&& f, Args&&... args )
+	{
+		retire( deferred_apply<void>( std::forward<F>( f ), std::forward<Args>( args )... ) );
+	}
+
+	/**
+	 * @brief 後始末cleanupをリタイアする
+	 *
+	 * cleanupは、現時点で活動中のすべてのリーダーがクリティカルセクションを出た後に適用される。
+	 */
+	void retire( deferred_apply<void>&& cleanup )
+	{
+		size_t num_of_retired;
+		{
+			std::lock_guard<std::mutex> lk( mtx_ );
+			retired_.emplace_back( global_epoch_.load(), std::move( cleanup ) );
+			num_of_retired = retired_.size();
+		}
+
+		if ( num_of_retired < cfg_.collect_threshold ) return;
+		if ( cfg_.use_background_thread ) {
+			cv_.notify_one();
+		} else {
+			collect();
+		}
+	}
+
+	/**
+	 * @brief 可能であればグローバルエポックを進め、適用可能となった後始末を呼び出したスレッドで適用する
+	 *
+	 * @return 適用した後始末の数
+	 */
+	size_t collect( void )
+	{
+		std::deque<retired_cleanup> ready;
+		{
+			std::lock_guard<std::mutex> lk( mtx_ );
+			take_ready( ready );
+		}
+
+		for ( auto& r : ready ) {
+			r.cleanup_.apply();
+		}
+		return ready.size();
+	}
+
+	/**
+	 * @brief 実行待ちの後始末の数
+	 */
+	size_t number_of_pending( void ) const
+	{
+		std::lock_guard<std::mutex> lk( mtx_ );
+		return retired_.size();
+	}
+
+	uint64_t current_epoch( void ) const
+	{
+		return global_epoch_.load();
+	}
+
+private:
+	static constexpr uint64_t inactive_epoch = std::numeric_limits<uint64_t>::max();
+
+	struct reader_slot {
+		reader_slot( void )
+		  : in_use_( false )
+		  , epoch_( inactive_epoch )
+		  , depth_( 0 )
+		{
+		}
+
+		std::atomic<bool>     in_use_;   //!< readerが使用中かどうか
+		std::atomic<uint64_t> epoch_;    //!< 公開しているエポック。クリティカルセクション外の場合は inactive_epoch
+		size_t                depth_;    //!< クリティカルセクションの入れ子の深さ。所有するスレッドだけが参照する
+	};
+
+	struct retired_cleanup {
+		retired_cleanup( uint64_t epoch, deferred_apply<void>&& cleanup )
+		  : epoch_( epoch )
+		  , cleanup_( std::move( cleanup ) )
+		{
+		}
+
+		uint64_t             epoch_;   //!< リタイアした時点のグローバルエポック
+		deferred_apply<void> cleanup_;
+	};
+
+	reader_slot* acquire_slot( void )
+	{
+		for ( size_t i = 0; i < num_of_slots_; i++ ) {
+			bool expected = false;
+			if ( up_slots_[i].in_use_.compare_exchange_strong( expected, true ) ) {
+				return &up_slots_[i];
+			}
+		}
+		deferred_apply_internal::raise_error<too_many_readers>();
+	}
+
+	void release_slot( reader_slot* p_slot )
+	{
+		p_slot->epoch_.store( inactive_epoch );
+		p_slot->depth_ = 0;
+		p_slot->in_use_.store( false );
+	}
+
+	/**
+	 * @brief 活動中のリーダーがすべて現在のエポックを公開していれば、グローバルエポックを進める
+	 */
+	void try_advance( void )
+	{
+		std::atomic_thread_fence( std::memory_order_seq_cst );
+		uint64_t cur_epoch = global_epoch_.load();
+		for ( size_t i = 0; i < num_of_slots_; i++ ) {
+			uint64_t e = up_slots_[i].epoch_.load( std::memory_order_acquire );
+			if ( ( e != inactive_epoch ) && ( e != cur_epoch ) ) return;
+		}
+		global_epoch_.compare_exchange_strong( cur_epoch, cur_epoch + 1 );
+	}
+
+	/**
+	 * @brief 活動中のリーダーが公開している最も古いエポック。活動中のリーダーがいない場合は、グローバルエポック
+	 */
+	uint64_t oldest_active_epoch( void ) const
+	{
+		std::atomic_thread_fence( std::memory_order_seq_cst );
+		uint64_t ans = global_epoch_.load();
+		for ( size_t i = 0; i < num_of_slots_; i++ ) {
+			uint64_t e = up_slots_[i].epoch_.load( std::memory_order_acquire );
+			if ( e < ans ) ans = e;
+		}
+		return ans;
+	}
+
+	/**
+	 * @brief 適用可能となった後始末をreadyに取り出す。ロックを保持して呼び出すこと
+	 *
+	 * retired_は、リタイアした時点のエポックの昇順に並んでいる。
+	 */
+	void take_ready( std::deque<retired_cleanup>& ready )
+	{
+		if ( retired_.empty() ) return;
+
+		try_advance();
+		uint64_t oldest_epoch = oldest_active_epoch();
+		while ( !retired_.empty() && ( retired_.front().epoch_ < oldest_epoch ) ) {
+			ready.emplace_back( std::move( retired_.front() ) );
+			retired_.pop_front();
+		}
+	}
+
+	void background_loop( void )
+	{
+		std::unique_lock<std::mutex> lk( mtx_ );
+		while ( !stop_ ) {
+			cv_.wait_for( lk, cfg_.background_interval, [this]() {
+				return stop_ || ( retired_.size() >= cfg_.collect_threshold );
+			} );
+
+			std::deque<retired_cleanup> ready;
+			take_ready( ready );
+			lk.unlock();
+			for ( auto& r : ready ) {
+				r.cleanup_.apply();
+			}
+			lk.lock();
+		}
+	}
+
+	const config                   cfg_;
+	std::atomic<uint64_t>          global_epoch_;
+	std::unique_ptr<reader_slot[]> up_slots_;
+	const size_t                   num_of_slots_;
+	mutable std::mutex             mtx_;
+	std::condition_variable        cv_;
+	std::deque<retired_cleanup>    retired_;   //!< 実行待ちの後始末
+	bool                           stop_;
+	std::thread                    background_thread_;
+};
+
+#endif
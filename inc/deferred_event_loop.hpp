@@ -0,0 +1,476 @@
+/**
+ * @file deferred_event_loop.hpp
+ * @author PFA03027@nifty.com
+ * @brief single-threaded event loop on epoll that executes deferred_apply<void> tasks posted from other threads
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023, PFA03027@nifty.com
+ *
+ */
+
+#ifndef DEFERRED_EVENT_LOOP_HPP_
+#define DEFERRED_EVENT_LOOP_HPP_
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <system_error>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "deferred_apply.hpp"
+
+/**
+ * @brief Single-threaded event loop on epoll that executes deferred_apply<void> tasks posted from other threads
+ *
+ * Example of use:
+ * @code {.cpp}
+ * deferred_event_loop loop;
+ * loop.add_fd( sock_fd, EPOLLIN, on_readable, &session );   // on_readable( &session, ready_events )
+ * std::thread io_thread( [&loop]() { loop.run(); } );
+ *
+ * loop.post( send_reply, &session, std::move( reply ) );     // from any thread
+ * loop.stop();
+ * io_thread.join();
+ * @endcode
+ *
+ * The tasks posted by post() are linked to a lock-free multi-producer single-consumer queue, and the loop thread is woken up through one eventfd registered in the epoll set.
+ * Only the post() that finds no pending wakeup writes to the eventfd, so a burst of posts costs one system call and one wakeup.
+ * The loop thread blocks in epoll_wait() until a task is posted or a registered file descriptor becomes ready, so a cross-thread handoff has no polling latency.
+ *
+ * A callback registered by add_fd() is applied repeatedly with the ready events of epoll appended as the last argument.
+ *
+ * post() and stop() are thread-safe. add_fd(), modify_fd() and remove_fd() should be called from the loop thread, or while the loop is not running.
+ * From another thread, post() a task that calls them.
+ *
+ * @brief 他のスレッドから投入されたdeferred_apply<void>のタスクを実行する、epollによるシングルスレッドのイベントループ
+ *
+ * post()で投入したタスクはロックフリーのmulti-producer single-consumerキューに連結し、epollに登録した1つのeventfdでループのスレッドを起床させる。
+ * 起床の通知が未処理でない場合のpost()だけがeventfdに書き込むため、連続した投入はシステムコール1回と起床1回にまとめられる。
+ * ループのスレッドは、タスクが投入されるか、登録したファイルディスクリプタが準備完了となるまでepoll_wait()で待機するため、スレッド間の受け渡しにポーリングによる遅延は発生しない。
+ *
+ * add_fd()で登録したコールバックは、epollの準備完了イベントを最後の引数として追加し、繰り返し適用される。
+ *
+ * post()とstop()はスレッドセーフである。add_fd(), modify_fd(), remove_fd()は、ループのスレッドから呼び出すか、ループの実行中でないときに呼び出すこと。
+ * 他のスレッドからは、それらを呼び出すタスクをpost()すること。
+ *
+ * @warning
+ * 引数はdeferred_apply<void>と同じ方式で保持されるため、左辺値の引数は左辺値参照として保持される。 @n
+ * タスクとコールバックが送出した例外は、run()/run_once()の呼び出し元に送出される。 @n
+ * Linux専用である。
+ */
+class deferred_event_loop {
+public:
+	/**
+	 * @brief イベントループの動作設定
+	 */
+	struct config {
+		config( void )
+		  : max_events( 64 )
+		  , max_batch( 256 )
+		{
+		}
+
+		int    max_events;   //!< 1回のepoll_wait()で受け取るイベント数の上限
+		size_t max_batch;    //!< 1回のrun_once()で実行するタスク数の上限。投入されたタスクがファイルディスクリプタのイベントを待たせないようにする
+	};
+
+	explicit deferred_event_loop( const config& cfg = config() )
+	  : cfg_( cfg )
+	  , epoll_fd_( -1 )
+	  , event_fd_( -1 )
+	  , p_tail_( new node() )
+	  , head_( p_tail_ )
+	  , is_wakeup_pending_( false )
+	  , stop_( false )
+	  , fd_entries_()
+	  , removed_entries_()
+	  , next_generation_( 1 )
+	  , events_()
+	{
+		if ( cfg_.max_events <= 0 ) cfg_.max_events = 1;
+		if ( cfg_.max_batch == 0 ) cfg_.max_batch = 1;
+		events_.resize( static_cast<size_t>( cfg_.max_events ) );
+
+		epoll_fd_ = ::epoll_create1( EPOLL_CLOEXEC );
+		if ( epoll_fd_ < 0 ) close_and_throw( "epoll_create1" );
+		event_fd_ = ::eventfd( 0, EFD_CLOEXEC | EFD_NONBLOCK );
+		if ( event_fd_ < 0 ) close_and_throw( "eventfd" );
+
+		struct epoll_event ev = {};
+		ev.events             = EPOLLIN;
+		ev.data.u64           = wakeup_key;
+		if ( ::epoll_ctl( epoll_fd_, EPOLL_CTL_ADD, event_fd_, &ev ) != 0 ) close_and_throw( "epoll_ctl" );
+	}
+
+	deferred_event_loop( const deferred_event_loop& )            = delete;
+	deferred_event_loop& operator=( const deferred_event_loop& ) = delete;
+
+	/**
+	 * @brief 実行されていないタスクは、適用せずに破棄する。登録したファイルディスクリプタはクローズしない
+	 */
+	~deferred_event_loop()
+	{
+		close_fds();
+
+		node* p_cur = p_tail_;
+		while ( p_cur != nullptr ) {
+			node* p_next = p_cur->next_.load( std::memory_order_relaxed );
+			delete p_cur;
+			p_cur = p_next;
+		}
+	}
+
+	/**
+	 * @brief ループのスレッドでf(args...)を実行するタスクを投入する
+	 *
+	 * fの戻り値の型はvoidであること。
+	 */
+	template <typename F,
+	          typename... Args,
+	          typename std::enable_if<!std::is_same<typename std::decay<F>::type, deferred_apply<void>>::value>::type* = nullptr>
+	void post( F&& f, Args&&... args )
+	{
+		post( deferred_apply<void>( std::forward<F>( f ), std::forward<Args>( args )... ) );
+	}
+
+	/**
+	 * @brief ループのスレッドでtaskを実行するように投入する
+	 *
+	 * ループのスレッドからの投入は、同じrun_once()の中で実行されるため、eventfdに書き込まない。
+	 */
+	void post( deferred_apply<void>&& task )
+	{
+		node* p_node = new node( std::move( task ) );
+		node* p_prev = head_.exchange( p_node, std::memory_order_acq_rel );
+		p_prev->next_.store( p_node, std::memory_order_release );
+
+		if ( running_in_this_thread() ) return;
+		if ( is_wakeup_pending_.exchange( true, std::memory_order_acq_rel ) ) return;   // 起床の通知は未処理のため、まとめて処理される
+		notify();
+	}
+
+	/**
+	 * @brief ファイルディスクリプタfdを、eventsのイベントで監視するように登録する
+	 *
+	 * fdが準備完了となる毎に、f(args..., ready_events)を呼び出す。ready_eventsは、uint32_tのepollのイベントである。
+	 * fdのクローズは、呼び出し側で行うこと。クローズする前にremove_fd()で登録を解除すること。
+	 *
+	 * @exception std::system_error epoll_ctl()が失敗した場合。fdが登録済みの場合を含む。
+	 */
+	template <typename F, typename... Args>
+	void add_fd( int fd, uint32_t events, F&& f, Args&&... args )
+	{
+		add_fd( fd, events, deferred_apply<void( uint32_t )>( std::forward<F>( f ), std::forward<Args>( args )... ) );
+	}
+
+	/**
+	 * @brief ファイルディスクリプタfdを、eventsのイベントで監視するように登録する
+	 *
+	 * fdが準備完了となる毎に、callback.apply( ready_events )を呼び出す。
+	 */
+	void add_fd( int fd, uint32_t events, deferred_apply<void( uint32_t )>&& callback )
+	{
+		std::unique_ptr<fd_entry> up_entry( new fd_entry( next_generation_++, std::move( callback ) ) );
+		up_entry->callback_.enable_repeatable_apply();
+
+		struct epoll_event ev = {};
+		ev.events             = events;
+		ev.data.u64           = make_key( fd, up_entry->generation_ );
+		if ( ::epoll_ctl( epoll_fd_, EPOLL_CTL_ADD, fd, &ev ) != 0 ) throw_system_error( "epoll_ctl" );
+
+		fd_entries_[fd] = std::move( up_entry );
+	}
+
+	/**
+	 * @brief 登録済みのファイルディスクリプタfdで監視するイベントを、eventsに変更する
+	 *
+	 * @exception std::system_error fdが登録されていない場合、あるいはepoll_ctl()が失敗した場合
+	 */
+	void modify_fd( int fd, uint32_t events )
+	{
+		auto it = fd_entries_.find( fd );
+		if ( it == fd_entries_.end() ) {
+			throw std::system_error( ENOENT, std::generic_category(), "modify_fd" );
+		}
+
+		struct epoll_event ev = {};
+		ev.events             = events;
+		ev.data.u64           = make_key( fd, it->second->generation_ );
+		if ( ::epoll_ctl( epoll_fd_, EPOLL_CTL_MOD, fd, &ev ) != 0 ) throw_system_error( "epoll_ctl" );
+	}
+
+	/**
+	 * @brief ファイルディスクリプタfdの登録を解除する
+	 *
+	 * fdのコールバックの中からも呼び出すことができる。
+	 * 同じepoll_wait()で受け取った、fdの残りのイベントは破棄する。
+	 *
+	 * @retval true 登録を解除した
+	 * @retval false fdは登録されていない
+	 */
+	bool remove_fd( int fd )
+	{
+		auto it = fd_entries_.find( fd );
+		if ( it == fd_entries_.end() ) return false;
+
+		::epoll_ctl( epoll_fd_, EPOLL_CTL_DEL, fd, nullptr );   // fdがクローズ済みの場合は、既にepollから削除されている
+
+		if ( running_in_this_thread() ) {
+			// 実行中のコールバックを破棄しないように、run_once()の終わりまで破棄を延期する
+			removed_entries_.push_back( std::move( it->second ) );
+		}
+		fd_entries_.erase( it );
+		return true;
+	}
+
+	/**
+	 * @brief stop()が呼び出されるまで、イベントを待ってタスクとコールバックを実行する
+	 *
+	 * run()から戻った後に投入されたタスクは、次のrun()/run_once()で実行される。
+	 */
+	void run( void )
+	{
+		while ( !stop_.load( std::memory_order_acquire ) ) {
+			run_once( -1 );
+		}
+		stop_.store( false, std::memory_order_release );
+	}
+
+	/**
+	 * @brief 1回だけイベントを待ち、準備完了のファイルディスクリプタのコールバックと、投入されたタスクを実行する
+	 *
+	 * 実行待ちのタスクがある場合は、イベントを待たない。
+	 *
+	 * @param timeout_ms イベントを待つ時間の上限[ms]。-1の場合は、イベントが発生するまで待つ。
+	 * @return 実行したタスクとコールバックの数
+	 */
+	size_t run_once( int timeout_ms = 0 )
+	{
+		const deferred_event_loop*& p_current = current();
+		const deferred_event_loop*  p_prev    = p_current;
+		p_current                             = this;
+		current_scope scope( p_current, p_prev );
+
+		if ( has_pending_tasks() ) {
+			timeout_ms = 0;
+		}
+
+		size_t ans    = 0;
+		int    num_ev = ::epoll_wait( epoll_fd_, events_.data(), cfg_.max_events, timeout_ms );
+		if ( num_ev < 0 ) {
+			if ( errno != EINTR ) throw_system_error( "epoll_wait" );
+			num_ev = 0;
+		}
+
+		for ( int i = 0; i < num_ev; i++ ) {
+			uint64_t key          = events_[i].data.u64;   // x86_64ではepoll_eventがパックされているため、参照せずにコピーする
+			uint32_t ready_events = events_[i].events;
+			if ( key == wakeup_key ) {
+				consume_wakeup();
+				continue;
+			}
+
+			auto it = fd_entries_.find( static_cast<int>( key & 0xFFFFFFFFu ) );
+			if ( it == fd_entries_.end() ) continue;
+			if ( it->second->generation_ != static_cast<uint32_t>( key >> 32 ) ) continue;   // 解除後に、同じ番号で再登録された
+
+			it->second->callback_.apply( ready_events );
+			ans++;
+		}
+		removed_entries_.clear();
+
+		for ( size_t i = 0; i < cfg_.max_batch; i++ ) {
+			if ( !has_pending_tasks() ) break;
+
+			deferred_apply<void> task = pop();
+			task.apply();
+			ans++;
+		}
+
+		return ans;
+	}
+
+	/**
+	 * @brief run()を終了させる。スレッドセーフ
+	 *
+	 * 実行中のrun_once()が完了した後に、run()から戻る。
+	 */
+	void stop( void )
+	{
+		stop_.store( true, std::memory_order_release );
+		if ( running_in_this_thread() ) return;
+		notify();
+	}
+
+	/**
+	 * @brief 呼び出したスレッドで、本イベントループを実行中かどうか
+	 */
+	bool running_in_this_thread( void ) const
+	{
+		return current() == this;
+	}
+
+	/**
+	 * @brief 登録されているファイルディスクリプタの数
+	 */
+	size_t number_of_fds( void ) const
+	{
+		return fd_entries_.size();
+	}
+
+private:
+	struct node {
+		node( void )
+		  : next_( nullptr )
+		  , task_()
+		{
+		}
+		explicit node( deferred_apply<void>&& task )
+		  : next_( nullptr )
+		  , task_( std::move( task ) )
+		{
+		}
+
+		std::atomic<node*>   next_;
+		deferred_apply<void> task_;
+	};
+
+	struct fd_entry {
+		fd_entry( uint32_t generation, deferred_apply<void( uint32_t )>&& callback )
+		  : generation_( generation )
+		  , callback_( std::move( callback ) )
+		{
+		}
+
+		uint32_t                         generation_;   //!< 解除済みの登録のイベントを区別するための世代番号
+		deferred_apply<void( uint32_t )> callback_;
+	};
+
+	/**
+	 * @brief run_once()を抜けるときに、実行中のイベントループを元に戻す
+	 */
+	class current_scope {
+	public:
+		current_scope( const deferred_event_loop*& p_current, const deferred_event_loop* p_prev )
+		  : p_current_( p_current )
+		  , p_prev_( p_prev )
+		{
+		}
+		~current_scope()
+		{
+			p_current_ = p_prev_;
+		}
+
+	private:
+		const deferred_event_loop*& p_current_;
+		const deferred_event_loop*  p_prev_;
+	};
+
+	//! eventfdのイベントを示すキー。ファイルディスクリプタの世代番号は1から始まるため、重複しない
+	static constexpr uint64_t wakeup_key = 0;
+
+	static uint64_t make_key( int fd, uint32_t generation )
+	{
+		return ( static_cast<uint64_t>( generation ) << 32 ) | static_cast<uint32_t>( fd );
+	}
+
+	/**
+	 * @brief 呼び出したスレッドで実行中のイベントループ
+	 */
+	static const deferred_event_loop*& current( void )
+	{
+		static thread_local const deferred_event_loop* p_current = nullptr;
+		return p_current;
+	}
+
+	void notify( void )
+	{
+		uint64_t one = 1;
+		while ( ::write( event_fd_, &one, sizeof( one ) ) < 0 ) {
+			if ( errno != EINTR ) break;   // EAGAINはカウンタが飽和している場合で、起床は通知済みである
+		}
+	}
+
+	/**
+	 * @brief 起床の通知を処理済みとする
+	 *
+	 * フラグを戻してから実行待ちのタスクを取り出すため、以降のpost()は再び通知する。
+	 * フラグをRMWで戻すことで、フラグを立てたpost()が連結したタスクが見えることを保証する。
+	 */
+	void consume_wakeup( void )
+	{
+		uint64_t counter;
+		while ( ::read( event_fd_, &counter, sizeof( counter ) ) < 0 ) {
+			if ( errno != EINTR ) break;
+		}
+		is_wakeup_pending_.exchange( false, std::memory_order_acq_rel );
+	}
+
+	bool has_pending_tasks( void ) const
+	{
+		return p_tail_->next_.load( std::memory_order_acquire ) != nullptr;
+	}
+
+	/**
+	 * @brief 先頭のタスクを取り出す。has_pending_tasks()で、タスクが存在することを確認してから呼び出すこと
+	 *
+	 * 取り出したノードは、次のダミーノードとなる。
+	 */
+	deferred_apply<void> pop( void )
+	{
+		node* p_next = p_tail_->next_.load( std::memory_order_acquire );
+
+		deferred_apply<void> ans( std::move( p_next->task_ ) );
+		delete p_tail_;
+		p_tail_ = p_next;
+		return ans;
+	}
+
+	void close_fds( void )
+	{
+		if ( event_fd_ >= 0 ) ::close( event_fd_ );
+		if ( epoll_fd_ >= 0 ) ::close( epoll_fd_ );
+		event_fd_ = -1;
+		epoll_fd_ = -1;
+	}
+
+	static void throw_system_error( const char* what )
+	{
+		throw std::system_error( errno, std::generic_category(), what );
+	}
+
+	/**
+	 * @brief 構築中の失敗で、確保済みの資源を解放してから例外を送出する
+	 */
+	void close_and_throw( const char* what )
+	{
+		int err = errno;
+		close_fds();
+		delete p_tail_;
+		throw std::system_error( err, std::generic_category(), what );
+	}
+
+	config                                             cfg_;
+	int                                                epoll_fd_;
+	int                                                event_fd_;
+	node*                                              p_tail_;              //!< 先頭のダミーノード。ループのスレッドだけが参照する
+	std::atomic<node*>                                 head_;                //!< 最後に連結したノード。post()するスレッドが更新する
+	std::atomic<bool>                                  is_wakeup_pending_;   //!< eventfdに書き込んだ起床の通知が、未処理かどうか
+	std::atomic<bool>                                  stop_;
+	std::unordered_map<int, std::unique_ptr<fd_entry>> fd_entries_;
+	std::vector<std::unique_ptr<fd_entry>>             removed_entries_;     //!< 登録を解除し、run_once()の終わりに破棄するエントリ
+	uint32_t                                           next_generation_;
+	std::vector<struct epoll_event>                    events_;
+};
+
+#endif
@@ -0,0 +1,566 @@
+/**
+ * @file deferred_journal.hpp
+ * @author PFA03027@nifty.com
+ * @brief durable journal of deferred calls on a memory-mapped file, and its replay
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023, PFA03027@nifty.com
+ *
+ */
+
+#ifndef DEFERRED_JOURNAL_HPP_
+#define DEFERRED_JOURNAL_HPP_
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <tuple>
+#include <type_traits>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <utility>
+
+#include "deferred_apply.hpp"
+
+namespace deferred_apply_internal {
+
+/**
+ * @brief 引数の型をすべて詰めて配置した場合のバイト数を求めるメタ関数
+ */
+template <typename... Args>
+struct packed_size;
+
+template <>
+struct packed_size<> : public std::integral_constant<size_t, 0> {
+};
+
+template <typename Head, typename... Tails>
+struct packed_size<Head, Tails...> : public std::integral_constant<size_t, sizeof( Head ) + packed_size<Tails...>::value> {
+};
+
+/**
+ * @brief 引数の型がすべてトリビアルコピー可能かどうかを求めるメタ関数
+ */
+template <typename... Args>
+struct all_trivially_copyable;
+
+template <>
+struct all_trivially_copyable<> : public std::true_type {
+};
+
+template <typename Head, typename... Tails>
+struct all_trivially_copyable<Head, Tails...> : public std::integral_constant<bool, std::is_trivially_copyable<Head>::value && all_trivially_copyable<Tails...>::value> {
+};
+
+inline void pack_values( unsigned char* )
+{
+}
+
+/**
+ * @brief 引数の値を、アライメントを考慮せずに詰めてpにコピーする
+ */
+template <typename Head, typename... Tails>
+inline void pack_values( unsigned char* p, const Head& head, const Tails&... tails )
+{
+	memcpy( p, &head, sizeof( Head ) );
+	pack_values( p + sizeof( Head ), tails... );
+}
+
+/**
+ * @brief pack_values()で詰めた値を、std::tupleとして取り出す
+ */
+template <typename... Args>
+class packed_values_reader {
+public:
+	using tuple_t = std::tuple<Args...>;
+
+	static tuple_t read( const unsigned char* p )
+	{
+		tuple_t ans;
+		read_impl<0>( p, ans );
+		return ans;
+	}
+
+private:
+	template <size_t I, typename std::enable_if<( I < sizeof...( Args ) )>::type* = nullptr>
+	static void read_impl( const unsigned char* p, tuple_t& t )
+	{
+		using cur_t = typename std::tuple_element<I, tuple_t>::type;
+		memcpy( &std::get<I>( t ), p, sizeof( cur_t ) );
+		read_impl<I + 1>( p + sizeof( cur_t ), t );
+	}
+
+	template <size_t I, typename std::enable_if<( I >= sizeof...( Args ) )>::type* = nullptr>
+	static void read_impl( const unsigned char*, tuple_t& )
+	{
+	}
+};
+
+/**
+ * @brief ジャーナルに登録した関数を、保存された引数から再生するためのインタフェース
+ */
+class journal_handler_base {
+public:
+	virtual ~journal_handler_base()                                                   = default;
+	virtual size_t               payload_size( void ) const                           = 0;
+	virtual std::type_index      signature( void ) const                              = 0;
+	virtual deferred_apply<void> make_deferred_call( const unsigned char* p_payload ) = 0;
+};
+
+template <typename F, typename... Args>
+class journal_handler : public journal_handler_base {
+public:
+	template <typename XF>
+	explicit journal_handler( XF&& f )
+	  : functor_( std::forward<XF>( f ) )
+	{
+	}
+
+	size_t payload_size( void ) const override
+	{
+		return packed_size<Args...>::value;
+	}
+
+	std::type_index signature( void ) const override
+	{
+		return std::type_index( typeid( std::tuple<Args...> ) );
+	}
+
+	deferred_apply<void> make_deferred_call( const unsigned char* p_payload ) override
+	{
+		return make_deferred_call_impl( packed_values_reader<Args...>::read( p_payload ), my_make_index_sequence<sizeof...( Args )>() );
+	}
+
+	/**
+	 * @brief 登録した関数を呼び出す。戻り値は破棄する。
+	 */
+	void operator()( Args... args )
+	{
+		functor_( std::move( args )... );
+	}
+
+private:
+	template <size_t... Is>
+	deferred_apply<void> make_deferred_call_impl( std::tuple<Args...>&& t, my_index_sequence<Is...> )
+	{
+		// 引数は右辺値として渡すことで、deferred_apply<void>内に値として保持させる。
+		// 関数は、戻り値を破棄するために本インスタンスへの参照として保持させる。
+		return deferred_apply<void>( *this, std::get<Is>( std::move( t ) )... );
+	}
+
+	F functor_;
+};
+
+}   // namespace deferred_apply_internal
+
+/**
+ * @brief Durable journal that appends deferred calls to a memory-mapped file and replays them
+ *
+ * Example of use:
+ * @code {.cpp}
+ * deferred_journal jr( "commands.journal" );
+ * jr.register_function( 1, &set_value );      // void set_value( int key, double value );
+ * jr.replay();                                 // re-apply the calls that were appended before the restart
+ * jr.append( 1, 10, 3.14 );                    // record set_value( 10, 3.14 )
+ * jr.sync();                                   // make the appended records durable
+ * @endcode
+ *
+ * A record is (registered function id, packed argument values), and it is written directly into the mapped region.
+ * Therefore, append() needs neither an extra serialization buffer nor a system call.
+ * Records become durable by sync(), or automatically every sync_every appends.
+ * A record torn by a crash is detected by its checksum and sequence number, and the replay stops there.
+ *
+ * @warning
+ * The argument types of a function must be trivially copyable. Pointers are recorded as is, so they are meaningless after a restart.
+ * This class is not thread-safe.
+ *
+ * @brief 遅延実行する関数呼び出しを、メモリマップしたファイルに追記し、再起動後に再生するためのジャーナル
+ *
+ * レコードは(登録した関数のID、詰めて配置した引数の値)で、マップした領域に直接書き込まれる。
+ * そのため、append()では、シリアライズのための追加のバッファもシステムコールも必要ない。
+ * レコードはsync()で、あるいはsync_every回のappend()毎に自動的に永続化される。
+ * クラッシュにより書き込みが途中となったレコードは、チェックサムとシーケンス番号により検出され、再生はそこで終了する。
+ *
+ * @warning
+ * 関数の引数の型は、トリビアルコピー可能であること。ポインタはそのまま記録されるため、再起動後には意味を持たない。
+ * 本クラスはスレッドセーフではない。
+ */
+class deferred_journal {
+public:
+	/**
+	 * @param path ジャーナルファイルのパス。存在しない場合は作成する。
+	 * @param initial_capacity ファイルを新規作成した場合の初期サイズ。不足した場合は拡張する。
+	 * @param sync_every 自動でsync()を行うappend()の回数。0の場合は自動では行わない。
+	 */
+	explicit deferred_journal( const char* path, size_t initial_capacity = 1024 * 1024, size_t sync_every = 0 )
+	  : fd_( -1 )
+	  , p_map_( nullptr )
+	  , map_size_( 0 )
+	  , write_off_( file_header_size )
+	  , synced_off_( file_header_size )
+	  , next_seq_( 0 )
+	  , num_of_records_( 0 )
+	  , sync_every_( sync_every )
+	  , appended_since_sync_( 0 )
+	  , handlers_()
+	{
+		fd_ = ::open( path, O_RDWR | O_CREAT, 0644 );
+		if ( fd_ < 0 ) throw_system_error( "open" );
+
+		struct stat st;
+		if ( ::fstat( fd_, &st ) != 0 ) close_and_throw( "fstat" );
+
+		size_t file_size = static_cast<size_t>( st.st_size );
+		if ( file_size < file_header_size ) {
+			if ( initial_capacity < min_capacity ) initial_capacity = min_capacity;
+			file_size = round_up( initial_capacity, page_size() );
+			if ( ::ftruncate( fd_, static_cast<off_t>( file_size ) ) != 0 ) close_and_throw( "ftruncate" );
+		}
+		void* p = ::mmap( nullptr, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0 );
+		if ( p == MAP_FAILED ) close_and_throw( "mmap" );
+		p_map_    = static_cast<unsigned char*>( p );
+		map_size_ = file_size;
+
+		file_header* p_fh = reinterpret_cast<file_header*>( p_map_ );
+		if ( memcmp( p_fh->magic_, file_magic(), sizeof( p_fh->magic_ ) ) != 0 ) {
+			memcpy( p_fh->magic_, file_magic(), sizeof( p_fh->magic_ ) );
+			p_fh->base_seq_ = 0;
+		}
+		recover();
+	}
+
+	deferred_journal( const deferred_journal& )            = delete;
+	deferred_journal& operator=( const deferred_journal& ) = delete;
+
+	~deferred_journal()
+	{
+		if ( p_map_ != nullptr ) {
+			::msync( p_map_, map_size_, MS_SYNC );
+			::munmap( p_map_, map_size_ );
+		}
+		if ( fd_ >= 0 ) {
+			::close( fd_ );
+		}
+	}
+
+	/**
+	 * @brief 関数ポインタfを、IDに対応する関数として登録する
+	 */
+	template <typename R, typename... Args>
+	void register_function( uint32_t function_id, R ( *f )( Args... ) )
+	{
+		register_handler<R ( * )( Args... ), typename std::decay<Args>::type...>( function_id, f );
+	}
+
+	/**
+	 * @brief 引数の型がArgs...となる関数オブジェクトfを、IDに対応する関数として登録する
+	 *
+	 * 同じIDが登録済みの場合は置き換える。
+	 *
+	 * Example of use:
+	 * @code {.cpp}
+	 * jr.register_function_as<int, double>( 2, [&state]( int key, double value ) { state.set( key, value ); } );
+	 * @endcode
+	 */
+	template <typename... Args, typename F>
+	void register_function_as( uint32_t function_id, F&& f )
+	{
+		register_handler<typename std::decay<F>::type, Args...>( function_id, std::forward<F>( f ) );
+	}
+
+	/**
+	 * @brief IDに対応する関数の呼び出しを、レコードとして追記する
+	 *
+	 * @exception std::invalid_argument IDが未登録、あるいは登録した関数の引数の型と一致しない場合
+	 */
+	template <typename... Args>
+	void append( uint32_t function_id, const Args&... args )
+	{
+		static_assert( deferred_apply_internal::all_trivially_copyable<Args...>::value, "argument types of journaled function should be trivially copyable" );
+
+		auto it = handlers_.find( function_id );
+		if ( it == handlers_.end() ) {
+			throw std::invalid_argument( "function id is not registered to deferred_journal" );
+		}
+		if ( it->second->signature() != std::type_index( typeid( std::tuple<Args...> ) ) ) {
+			throw std::invalid_argument( "argument types do not match the function registered to deferred_journal" );
+		}
+
+		constexpr size_t payload_size = deferred_apply_internal::packed_size<Args...>::value;
+		size_t           record_size  = round_up( sizeof( record_header ) + payload_size, record_alignment );
+		reserve( record_size );
+
+		// 引数の値を、マップした領域に直接書き込む
+		unsigned char* p_rec     = p_map_ + write_off_;
+		unsigned char* p_payload = p_rec + sizeof( record_header );
+		deferred_apply_internal::pack_values( p_payload, args... );
+
+		record_header rh;
+		rh.magic_        = record_magic;
+		rh.function_id_  = function_id;
+		rh.payload_size_ = static_cast<uint32_t>( payload_size );
+		rh.seq_          = next_seq_;
+		rh.checksum_     = calc_checksum( rh, p_payload );
+		memcpy( p_rec, &rh, sizeof( rh ) );
+
+		write_off_ += record_size;
+		next_seq_++;
+		num_of_records_++;
+		terminate_records();
+
+		appended_since_sync_++;
+		if ( ( sync_every_ > 0 ) && ( appended_since_sync_ >= sync_every_ ) ) {
+			sync();
+		}
+	}
+
+	/**
+	 * @brief 前回のsync()以降に追記したレコードを、msync()でファイルに書き出す
+	 */
+	void sync( void )
+	{
+		appended_since_sync_ = 0;
+		if ( synced_off_ >= write_off_ ) return;
+
+		size_t begin = synced_off_ - ( synced_off_ % page_size() );
+		size_t end   = write_off_ + sizeof( record_header );   // 終端マーカーも含める
+		if ( end > map_size_ ) end = map_size_;
+		if ( ::msync( p_map_ + begin, end - begin, MS_SYNC ) != 0 ) throw_system_error( "msync" );
+
+		if ( begin > 0 ) {
+			// ファイルヘッダのbase_seq_の変更も書き出す
+			if ( ::msync( p_map_, file_header_size, MS_SYNC ) != 0 ) throw_system_error( "msync" );
+		}
+		synced_off_ = write_off_;
+	}
+
+	/**
+	 * @brief 保存されているレコードから、deferred_apply<void>を再構築してsinkに渡す
+	 *
+	 * @param sink deferred_apply<void>&&を引数とする関数オブジェクト
+	 *
+	 * @return 再構築したレコード数
+	 *
+	 * @exception std::invalid_argument レコードの関数IDが未登録、あるいは引数のサイズが一致しない場合
+	 */
+	template <typename Sink>
+	size_t replay( Sink&& sink )
+	{
+		size_t ans = 0;
+		size_t off = file_header_size;
+		while ( off < write_off_ ) {
+			record_header rh;
+			memcpy( &rh, p_map_ + off, sizeof( rh ) );
+
+			auto it = handlers_.find( rh.function_id_ );
+			if ( it == handlers_.end() ) {
+				throw std::invalid_argument( "function id in deferred_journal is not registered" );
+			}
+			if ( it->second->payload_size() != rh.payload_size_ ) {
+				throw std::invalid_argument( "argument size in deferred_journal does not match the registered function" );
+			}
+
+			sink( it->second->make_deferred_call( p_map_ + off + sizeof( record_header ) ) );
+			ans++;
+			off += round_up( sizeof( record_header ) + rh.payload_size_, record_alignment );
+		}
+		return ans;
+	}
+
+	/**
+	 * @brief 保存されているレコードの関数呼び出しを、記録した順にすべて実行する
+	 *
+	 * @return 実行したレコード数
+	 */
+	size_t replay( void )
+	{
+		return replay( []( deferred_apply<void>&& da ) { da.apply(); } );
+	}
+
+	/**
+	 * @brief 保存されているレコードをすべて破棄する。スナップショットを保存した後などに使用する。
+	 */
+	void reset( void )
+	{
+		file_header* p_fh = reinterpret_cast<file_header*>( p_map_ );
+		p_fh->base_seq_   = next_seq_;
+		write_off_        = file_header_size;
+		synced_off_       = file_header_size;
+		num_of_records_   = 0;
+		terminate_records();
+		if ( ::msync( p_map_, page_size(), MS_SYNC ) != 0 ) throw_system_error( "msync" );
+	}
+
+	size_t number_of_records( void ) const
+	{
+		return num_of_records_;
+	}
+
+	/**
+	 * @brief レコードが使用しているバイト数。ファイルヘッダを含む。
+	 */
+	size_t used_bytes( void ) const
+	{
+		return write_off_;
+	}
+
+private:
+	struct file_header {
+		char     magic_[8];
+		uint64_t base_seq_;   //!< 最初のレコードのシーケンス番号
+	};
+
+	struct record_header {
+		uint32_t magic_;
+		uint32_t function_id_;
+		uint32_t payload_size_;
+		uint32_t checksum_;
+		uint64_t seq_;
+	};
+
+	static constexpr uint32_t record_magic     = 0x4A52434Eu;
+	static constexpr size_t   file_header_size = 64;
+	static constexpr size_t   record_alignment = 8;
+	static constexpr size_t   min_capacity     = 4096;
+
+	static const char* file_magic( void )
+	{
+		return "DAJRNL01";
+	}
+
+	static size_t page_size( void )
+	{
+		static const size_t ps = static_cast<size_t>( ::sysconf( _SC_PAGESIZE ) );
+		return ps;
+	}
+
+	static size_t round_up( size_t x, size_t align )
+	{
+		return ( ( x + align - 1 ) / align ) * align;
+	}
+
+	template <typename F, typename... Args, typename XF>
+	void register_handler( uint32_t function_id, XF&& f )
+	{
+		static_assert( deferred_apply_internal::all_trivially_copyable<Args...>::value, "argument types of journaled function should be trivially copyable" );
+
+		handlers_[function_id] = std::unique_ptr<deferred_apply_internal::journal_handler_base>(
+			new deferred_apply_internal::journal_handler<F, Args...>( std::forward<XF>( f ) ) );
+	}
+
+	static void throw_system_error( const char* what )
+	{
+		throw std::system_error( errno, std::generic_category(), what );
+	}
+
+	void close_and_throw( const char* what )
+	{
+		int err = errno;
+		::close( fd_ );
+		fd_ = -1;
+		throw std::system_error( err, std::generic_category(), what );
+	}
+
+	/**
+	 * @brief FNV-1aによるチェックサム
+	 */
+	static uint32_t calc_checksum( const record_header& rh, const unsigned char* p_payload )
+	{
+		uint32_t h      = 2166136261u;
+		auto     update = [&h]( const unsigned char* p, size_t n ) {
+			for ( size_t i = 0; i < n; i++ ) {
+				h ^= p[i];
+				h *= 16777619u;
+			}
+		};
+		update( reinterpret_cast<const unsigned char*>( &rh.function_id_ ), sizeof( rh.function_id_ ) );
+		update( reinterpret_cast<const unsigned char*>( &rh.payload_size_ ), sizeof( rh.payload_size_ ) );
+		update( reinterpret_cast<const unsigned char*>( &rh.seq_ ), sizeof( rh.seq_ ) );
+		update( p_payload, rh.payload_size_ );
+		return h;
+	}
+
+	/**
+	 * @brief 正しいレコードが連続している範囲を求め、追記位置とする
+	 */
+	void recover( void )
+	{
+		const file_header* p_fh = reinterpret_cast<const file_header*>( p_map_ );
+		next_seq_               = p_fh->base_seq_;
+		write_off_              = file_header_size;
+		num_of_records_         = 0;
+
+		while ( write_off_ + sizeof( record_header ) <= map_size_ ) {
+			record_header rh;
+			memcpy( &rh, p_map_ + write_off_, sizeof( rh ) );
+			if ( rh.magic_ != record_magic ) break;
+			if ( rh.seq_ != next_seq_ ) break;
+			size_t record_size = round_up( sizeof( record_header ) + rh.payload_size_, record_alignment );
+			if ( write_off_ + record_size > map_size_ ) break;
+			if ( rh.checksum_ != calc_checksum( rh, p_map_ + write_off_ + sizeof( record_header ) ) ) break;
+
+			write_off_ += record_size;
+			next_seq_++;
+			num_of_records_++;
+		}
+		synced_off_ = write_off_;
+		terminate_records();
+	}
+
+	/**
+	 * @brief 追記位置に、レコードの終端を示すためにmagicが0のヘッダを書き込む
+	 */
+	void terminate_records( void )
+	{
+		if ( write_off_ + sizeof( record_header ) > map_size_ ) return;
+		memset( p_map_ + write_off_, 0, sizeof( record_header ) );
+	}
+
+	/**
+	 * @brief record_sizeバイトのレコードと終端マーカーを追記できるように、必要に応じてファイルを拡張する
+	 */
+	void reserve( size_t record_size )
+	{
+		size_t required = write_off_ + record_size + sizeof( record_header );
+		if ( required <= map_size_ ) return;
+
+		size_t new_size = map_size_ * 2;
+		if ( new_size < required ) new_size = round_up( required, page_size() );
+
+		if ( ::ftruncate( fd_, static_cast<off_t>( new_size ) ) != 0 ) throw_system_error( "ftruncate" );
+		// 書き込み済みのページはページキャッシュに残るため、msync()前にアンマップしても失われない
+		if ( ::munmap( p_map_, map_size_ ) != 0 ) throw_system_error( "munmap" );
+		p_map_ = nullptr;
+
+		void* p = ::mmap( nullptr, new_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0 );
+		if ( p == MAP_FAILED ) throw_system_error( "mmap" );
+		p_map_    = static_cast<unsigned char*>( p );
+		map_size_ = new_size;
+	}
+
+	using handler_map_t = std::unordered_map<uint32_t, std::unique_ptr<deferred_apply_internal::journal_handler_base>>;
+
+	int            fd_;
+	unsigned char* p_map_;
+	size_t         map_size_;
+	size_t         write_off_;    //!< 次のレコードを書き込む位置
+	size_t         synced_off_;   //!< msync()済みの位置
+	uint64_t       next_seq_;
+	size_t         num_of_records_;
+	size_t         sync_every_;
+	size_t         appended_since_sync_;
+	handler_map_t  handlers_;
+};
+
+#endif
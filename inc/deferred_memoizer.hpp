@@ -0,0 +1,364 @@
+/**
+ * @file deferred_memoizer.hpp
+ * @author PFA03027@nifty.com
+ * @brief memoizing wrapper that serves the result of a function from a bounded concurrent cache keyed by deferred_applying_arguments
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023, PFA03027@nifty.com
+ *
+ */
+
+#ifndef DEFERRED_MEMOIZER_HPP_
+#define DEFERRED_MEMOIZER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+#include "deferred_apply.hpp"
+
+namespace deferred_apply_internal {
+
+inline size_t hash_combine( size_t seed, size_t h )
+{
+	return seed ^ ( h + static_cast<size_t>( 0x9e3779b9UL ) + ( seed << 6 ) + ( seed >> 2 ) );
+}
+
+template <typename Tuple, size_t I = 0, bool IsEnd = ( I == std::tuple_size<Tuple>::value )>
+struct tuple_hash_impl {
+	static size_t calc( const Tuple& t, size_t seed )
+	{
+		using element_t = typename std::decay<typename std::tuple_element<I, Tuple>::type>::type;
+		return tuple_hash_impl<Tuple, I + 1>::calc( t, hash_combine( seed, std::hash<element_t>()( std::get<I>( t ) ) ) );
+	}
+};
+
+template <typename Tuple, size_t I>
+struct tuple_hash_impl<Tuple, I, true> {
+	static size_t calc( const Tuple&, size_t seed )
+	{
+		return seed;
+	}
+};
+
+/**
+ * @brief std::tupleの要素に、参照型が含まれないかどうかを求めるメタ関数
+ */
+template <typename Tuple>
+struct tuple_holds_no_reference;
+
+template <typename... Ts>
+struct tuple_holds_no_reference<std::tuple<Ts...>>
+  : public std::is_same<bool_pack<true, !std::is_reference<Ts>::value...>, bool_pack<!std::is_reference<Ts>::value..., true>> {
+};
+
+}   // namespace deferred_apply_internal
+
+/**
+ * @brief std::tupleの要素毎のstd::hashを合成したハッシュ関数
+ *
+ * @tparam Tuple std::tupleの型
+ */
+template <typename Tuple>
+struct deferred_tuple_hash {
+	size_t operator()( const Tuple& t ) const
+	{
+		return deferred_apply_internal::tuple_hash_impl<Tuple>::calc( t, 0 );
+	}
+};
+
+/**
+ * @brief キャッシュから追い出すエントリの選び方
+ */
+enum class memoize_eviction_policy {
+	lru,    //!< 最も長く参照されていないエントリを追い出す
+	fifo,   //!< 最も古く登録されたエントリを追い出す。ヒット時にエントリの順序を更新しない
+};
+
+/**
+ * @brief Memoizing wrapper that serves the result of f from a bounded concurrent cache keyed by deferred_applying_arguments
+ *
+ * Example of use:
+ * @code {.cpp}
+ * auto lookup = []( int id, std::string field ) { return query_database( id, field ); };
+ * deferred_memoizer<decltype( lookup ), deferred_applying_arguments<int&&, std::string&&>> memo( lookup );
+ * auto r1 = memo( 42, std::string( "name" ) );                                          // calls lookup()
+ * auto r2 = memo.apply( make_deferred_applying_values( 42, std::string( "name" ) ) );   // served from the cache
+ * @endcode
+ *
+ * The key is the tuple of the values held by deferred_applying_arguments. It is hashed element by element with std::hash,
+ * and compared element by element with KeyEqual.
+ * The cache is split into shards selected by the hash value, and each shard has its own lock and LRU list.
+ * Therefore, lookups of different keys rarely contend with each other.
+ * The number of entries, the number of shards, the eviction policy and the maximum age of an entry are configurable by config.
+ *
+ * f is called without holding the lock. If the same key misses on several threads at the same time, f may be called more than once for that key.
+ * If f throws an exception, nothing is cached and the exception is propagated.
+ *
+ * @brief deferred_applying_argumentsをキーとする、上限付きの並行キャッシュからfの結果を返すメモ化ラッパー
+ *
+ * キーは、deferred_applying_argumentsが保持している値のタプルである。要素毎にstd::hashでハッシュ値を計算し、要素毎にKeyEqualで比較する。
+ * キャッシュはハッシュ値で選択するシャードに分割され、各シャードはそれぞれロックとLRUリストを持つ。
+ * そのため、異なるキーの検索が競合することは少ない。
+ * エントリ数、シャード数、追い出し方式、エントリの最大保持時間は、configで設定できる。
+ *
+ * fはロックを保持せずに呼び出す。同じキーが複数のスレッドで同時にキャッシュミスした場合、そのキーに対してfが複数回呼び出されることがある。
+ * fが例外を送出した場合は、キャッシュせずに例外をそのまま送出する。
+ *
+ * @warning
+ * キーはキャッシュ内に保持されるため、Argumentsは値を保持するdeferred_applying_argumentsであること。
+ * 左辺値参照を保持する場合は、コンパイルエラーとなる。 @n
+ * fは複数のスレッドから同時に呼び出される可能性がある。
+ *
+ * @tparam F メモ化する関数の型
+ * @tparam Arguments キーとなる引数を保持するdeferred_applying_argumentsの型
+ * @tparam KeyHash 保持している値のタプルのハッシュ関数
+ * @tparam KeyEqual 保持している値のタプルの比較関数
+ */
+template <typename F,
+          typename Arguments,
+          typename KeyHash  = deferred_tuple_hash<typename Arguments::stored_tuple_type>,
+          typename KeyEqual = std::equal_to<typename Arguments::stored_tuple_type>>
+class deferred_memoizer {
+public:
+	using arguments_type = Arguments;
+	using key_type       = typename Arguments::stored_tuple_type;
+	using result_type    = typename std::decay<decltype( std::declval<Arguments&>().apply( std::declval<F&>() ) )>::type;
+	using clock_type     = std::chrono::steady_clock;
+
+	static_assert( deferred_apply_internal::tuple_holds_no_reference<key_type>::value, "Arguments should hold values, not references" );
+	static_assert( std::is_copy_constructible<key_type>::value, "arguments should be copy constructible to be stored as a key" );
+	static_assert( std::is_copy_constructible<result_type>::value, "result of F should be copy constructible to be cached" );
+
+	/**
+	 * @brief キャッシュの動作設定
+	 */
+	struct config {
+		config( void )
+		  : capacity( 1024 )
+		  , number_of_shards( 8 )
+		  , policy( memoize_eviction_policy::lru )
+		  , max_age( clock_type::duration::zero() )
+		{
+		}
+
+		size_t                  capacity;           //!< 保持するエントリ数の上限。各シャードに均等に割り当てる
+		size_t                  number_of_shards;   //!< シャード数
+		memoize_eviction_policy policy;             //!< 上限を超えた場合に追い出すエントリの選び方
+		clock_type::duration    max_age;            //!< エントリの最大保持時間。0の場合は時間では追い出さない
+	};
+
+	explicit deferred_memoizer( F f, const config& cfg = config() )
+	  : f_( std::move( f ) )
+	  , cfg_( cfg )
+	  , key_hash_()
+	  , num_of_shards_( ( cfg.number_of_shards == 0 ) ? 1 : cfg.number_of_shards )
+	  , capacity_per_shard_( ( cfg.capacity + num_of_shards_ - 1 ) / num_of_shards_ )
+	  , up_shards_( new shard[num_of_shards_] )
+	  , num_of_hits_( 0 )
+	  , num_of_misses_( 0 )
+	{
+		if ( capacity_per_shard_ == 0 ) {
+			capacity_per_shard_ = 1;
+		}
+	}
+
+	deferred_memoizer( const deferred_memoizer& )            = delete;
+	deferred_memoizer& operator=( const deferred_memoizer& ) = delete;
+
+	/**
+	 * @brief argsが保持している値と等しいキーの結果がキャッシュにあればそれを返し、なければargsをfに適用した結果をキャッシュして返す
+	 *
+	 * キャッシュヒットの場合は、argsのコピーを行わない。
+	 */
+	result_type apply( const arguments_type& args )
+	{
+		const key_type& key       = args.stored_values();
+		size_t          h         = key_hash_( key );
+		shard&          cur_shard = up_shards_[select_shard( h )];
+
+		{
+			std::lock_guard<std::mutex> lk( cur_shard.mtx_ );
+			entry*                      p_entry = find( cur_shard, h, key );
+			if ( p_entry != nullptr ) {
+				num_of_hits_.fetch_add( 1, std::memory_order_relaxed );
+				return p_entry->value_;
+			}
+		}
+		num_of_misses_.fetch_add( 1, std::memory_order_relaxed );
+
+		// 保持している値はfにムーブされる可能性があるため、コピーに適用する
+		arguments_type work( args );
+		result_type    ans = work.apply( f_ );
+
+		std::lock_guard<std::mutex> lk( cur_shard.mtx_ );
+		if ( find( cur_shard, h, key ) == nullptr ) {
+			insert( cur_shard, h, key, ans );
+		}
+		return ans;
+	}
+
+	/**
+	 * @brief xargs...からキーとなる引数を構築して、apply()を実行する
+	 */
+	template <typename... XArgs>
+	result_type operator()( XArgs&&... xargs )
+	{
+		return apply( arguments_type( std::forward<XArgs>( xargs )... ) );
+	}
+
+	/**
+	 * @brief キャッシュしているすべてのエントリを破棄する
+	 */
+	void clear( void )
+	{
+		for ( size_t i = 0; i < num_of_shards_; i++ ) {
+			std::lock_guard<std::mutex> lk( up_shards_[i].mtx_ );
+			up_shards_[i].index_.clear();
+			up_shards_[i].entries_.clear();
+		}
+	}
+
+	/**
+	 * @brief キャッシュしているエントリ数
+	 */
+	size_t size( void ) const
+	{
+		size_t ans = 0;
+		for ( size_t i = 0; i < num_of_shards_; i++ ) {
+			std::lock_guard<std::mutex> lk( up_shards_[i].mtx_ );
+			ans += up_shards_[i].entries_.size();
+		}
+		return ans;
+	}
+
+	size_t number_of_hits( void ) const
+	{
+		return num_of_hits_.load( std::memory_order_relaxed );
+	}
+
+	size_t number_of_misses( void ) const
+	{
+		return num_of_misses_.load( std::memory_order_relaxed );
+	}
+
+private:
+	struct entry {
+		entry( size_t h, const key_type& key, const result_type& value, clock_type::time_point stored_at )
+		  : hash_( h )
+		  , key_( key )
+		  , value_( value )
+		  , stored_at_( stored_at )
+		{
+		}
+
+		size_t                 hash_;
+		key_type               key_;
+		result_type            value_;
+		clock_type::time_point stored_at_;
+	};
+
+	using entry_list_t = std::list<entry>;
+
+	/**
+	 * @brief インデックスのキー。キーのコピーを避けるため、エントリ内のキー、あるいは検索するキーを指す
+	 */
+	struct lookup_key {
+		size_t          hash_;
+		const key_type* p_key_;
+	};
+
+	struct lookup_hash {
+		size_t operator()( const lookup_key& k ) const
+		{
+			return k.hash_;
+		}
+	};
+
+	struct lookup_equal {
+		bool operator()( const lookup_key& a, const lookup_key& b ) const
+		{
+			return ( a.hash_ == b.hash_ ) && KeyEqual()( *( a.p_key_ ), *( b.p_key_ ) );
+		}
+	};
+
+	struct shard {
+		shard( void )
+		  : mtx_()
+		  , entries_()
+		  , index_()
+		{
+		}
+
+		mutable std::mutex                                                                         mtx_;
+		entry_list_t                                                                               entries_;   //!< 先頭が最も新しいエントリ
+		std::unordered_map<lookup_key, typename entry_list_t::iterator, lookup_hash, lookup_equal> index_;
+	};
+
+	size_t select_shard( size_t h ) const
+	{
+		// シャード内のunordered_mapのバケットの選択と相関しないように、ハッシュ値の上位ビットを混ぜる
+		uint64_t mixed = static_cast<uint64_t>( h ) * 0x9e3779b97f4a7c15ULL;
+		return static_cast<size_t>( mixed >> 32 ) % num_of_shards_;
+	}
+
+	/**
+	 * @brief キーkeyのエントリを検索する。ロックを保持して呼び出すこと
+	 *
+	 * 最大保持時間を超えたエントリは、破棄して見つからなかったものとする。
+	 */
+	entry* find( shard& cur_shard, size_t h, const key_type& key )
+	{
+		auto it = cur_shard.index_.find( lookup_key { h, &key } );
+		if ( it == cur_shard.index_.end() ) return nullptr;
+
+		typename entry_list_t::iterator it_entry = it->second;
+		if ( ( cfg_.max_age != clock_type::duration::zero() ) && ( ( clock_type::now() - it_entry->stored_at_ ) > cfg_.max_age ) ) {
+			cur_shard.index_.erase( it );
+			cur_shard.entries_.erase( it_entry );
+			return nullptr;
+		}
+
+		if ( cfg_.policy == memoize_eviction_policy::lru ) {
+			cur_shard.entries_.splice( cur_shard.entries_.begin(), cur_shard.entries_, it_entry );
+		}
+		return &( *it_entry );
+	}
+
+	/**
+	 * @brief エントリを追加し、上限を超えた場合は末尾のエントリを追い出す。ロックを保持して呼び出すこと
+	 */
+	void insert( shard& cur_shard, size_t h, const key_type& key, const result_type& value )
+	{
+		clock_type::time_point stored_at = ( cfg_.max_age != clock_type::duration::zero() ) ? clock_type::now() : clock_type::time_point();
+		cur_shard.entries_.emplace_front( h, key, value, stored_at );
+		cur_shard.index_.emplace( lookup_key { h, &( cur_shard.entries_.front().key_ ) }, cur_shard.entries_.begin() );
+
+		while ( cur_shard.entries_.size() > capacity_per_shard_ ) {
+			entry& victim = cur_shard.entries_.back();
+			cur_shard.index_.erase( lookup_key { victim.hash_, &( victim.key_ ) } );
+			cur_shard.entries_.pop_back();
+		}
+	}
+
+	F                        f_;
+	const config             cfg_;
+	KeyHash                  key_hash_;
+	const size_t             num_of_shards_;
+	size_t                   capacity_per_shard_;
+	std::unique_ptr<shard[]> up_shards_;
+	std::atomic<size_t>      num_of_hits_;
+	std::atomic<size_t>      num_of_misses_;
+};
+
+#endif
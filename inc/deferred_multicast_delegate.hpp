@@ -0,0 +1,504 @@
+/**
+ * @file deferred_multicast_delegate.hpp
+ * @author PFA03027@nifty.com
+ * @brief multicast delegate that stores deferred call subscribers contiguously in one arena
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023, PFA03027@nifty.com
+ *
+ */
+
+#ifndef DEFERRED_MULTICAST_DELEGATE_HPP_
+#define DEFERRED_MULTICAST_DELEGATE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "deferred_apply.hpp"
+
+/**
+ * @brief Multicast delegate that stores deferred call subscribers contiguously in one arena
+ *
+ * Example of use:
+ * @code {.cpp}
+ * deferred_multicast_delegate on_update;
+ * auto h1 = on_update.subscribe( refresh_view, &view );
+ * auto h2 = on_update.subscribe( write_log, std::string( "updated" ) );
+ * on_update.invoke_all();   // refresh_view( &view ), then write_log( "updated" )
+ * on_update.unsubscribe( h1 );
+ * @endcode
+ *
+ * Each subscriber is constructed directly in one contiguous arena as the same container that deferred_apply<void> uses,
+ * and each container occupies only its own size. Therefore, invoke_all() walks the arena linearly without chasing a heap pointer per subscriber.
+ *
+ * unsubscribe() marks the entry as a tombstone and does not shift the other entries, so it is safe to unsubscribe during invoke_all().
+ * During invoke_all(), the subscriber itself may be running, so its destruction is postponed until the outermost invoke_all() returns.
+ * A subscriber added during invoke_all() is constructed outside the arena if the arena is full, and is moved into the arena when invoke_all() returns.
+ * It is not called by the invoke_all() that is running.
+ * The arena is compacted when the tombstones outnumber the live subscribers, or when it grows.
+ * A handle refers to a slot of an indirection table, so it remains valid across compaction. A stale handle is detected by its generation.
+ *
+ * The held arguments are passed to the subscriber as lvalues at each invocation, so they are neither copied nor moved,
+ * in the same way as the captures of std::function. A subscriber that takes an argument by value still copies it, and one that takes an rvalue reference is a compile error.
+ * This class is not thread-safe.
+ *
+ * @brief 延期された関数呼び出しの購読者を、1つのアリーナに連続して格納するマルチキャストデリゲート
+ *
+ * 各購読者は、deferred_apply<void>と同じコンテナとして1つの連続したアリーナに直接構築され、コンテナ自身のサイズだけを占有する。
+ * そのため、invoke_all()は、購読者毎にヒープのポインタをたどることなく、アリーナを先頭から順に走査する。
+ *
+ * unsubscribe()はエントリを削除済み(トゥームストーン)とするだけで、他のエントリを移動しない。そのため、invoke_all()の実行中にも購読を解除できる。
+ * invoke_all()の実行中は、解除する購読者自身が実行中の場合があるため、破棄は最も外側のinvoke_all()から戻るときまで延期する。
+ * invoke_all()の実行中に追加した購読者は、アリーナに空きがなければアリーナ外に構築し、invoke_all()から戻るときにアリーナへ移す。
+ * 実行中のinvoke_all()では、追加した購読者は呼び出さない。
+ * アリーナは、削除済みのエントリ数が購読中のエントリ数を上回ったとき、あるいは拡張するときに詰め直す。
+ * ハンドルは間接参照テーブルのスロットを指すため、詰め直した後も有効である。解除済みのハンドルは、世代番号で検出する。
+ *
+ * 保持している引数は、std::functionのキャプチャと同じく、呼び出し毎にコピーもムーブもせずに左辺値として渡す。
+ * 値で受け取る購読者ではコピーが発生し、右辺値参照で受け取る購読者はコンパイルエラーとなる。
+ * 本クラスは、スレッドセーフではない。
+ *
+ * @warning
+ * 引数はdeferred_apply<void>と同じ方式で保持されるため、左辺値の引数は左辺値参照として保持される。 @n
+ * 関数と引数は、アリーナの再配置のためにムーブ可能であること。
+ */
+class deferred_multicast_delegate {
+	using base_t = deferred_apply_internal::deferred_apply_base<void()>;
+
+public:
+	/**
+	 * @brief 購読者を指すハンドル
+	 */
+	class handle {
+	public:
+		handle( void )
+		  : slot_( invalid_slot )
+		  , generation_( 0 )
+		{
+		}
+
+		bool valid( void ) const
+		{
+			return slot_ != invalid_slot;
+		}
+
+	private:
+		friend class deferred_multicast_delegate;
+
+		handle( uint32_t slot, uint32_t generation )
+		  : slot_( slot )
+		  , generation_( generation )
+		{
+		}
+
+		static constexpr uint32_t invalid_slot = std::numeric_limits<uint32_t>::max();
+
+		uint32_t slot_;
+		uint32_t generation_;
+	};
+
+	deferred_multicast_delegate( void )
+	  : up_arena_()
+	  , capacity_( 0 )
+	  , used_( 0 )
+	  , pending_blocks_()
+	  , slots_()
+	  , free_slots_()
+	  , num_of_alive_( 0 )
+	  , num_of_tombstones_( 0 )
+	  , num_of_deferred_destructions_( 0 )
+	  , is_invoking_( false )
+	  , is_compaction_requested_( false )
+	{
+	}
+
+	deferred_multicast_delegate( const deferred_multicast_delegate& )            = delete;
+	deferred_multicast_delegate& operator=( const deferred_multicast_delegate& ) = delete;
+
+	~deferred_multicast_delegate()
+	{
+		destroy_all();
+	}
+
+	/**
+	 * @brief f(args...)を呼び出す購読者を、末尾に追加する
+	 *
+	 * fの戻り値の型はvoidであること。
+	 * invoke_all()の実行中に呼び出した場合、追加した購読者は、実行中のinvoke_all()では呼び出さない。
+	 *
+	 * @return 追加した購読者のハンドル
+	 */
+	template <typename F, typename... Args>
+	handle subscribe( F&& f, Args&&... args )
+	{
+		using cur_container_t = deferred_apply_internal::deferred_apply_container<void(), F, Args&&...>;
+		static_assert( cur_container_t::move_constructible, "function and arguments should be move constructible to be relocated in the arena" );
+		static_assert( alignof( cur_container_t ) <= alignof( std::max_align_t ), "alignment of function and arguments exceeds std::max_align_t" );
+
+		size_t entry_size = header_size + round_up( sizeof( cur_container_t ) );
+		if ( ( used_ + entry_size > capacity_ ) && is_invoking_ ) {
+			// invoke_all()が走査中のアリーナは再配置できないため、アリーナ外に構築し、invoke_all()の終わりにアリーナへ移す
+			std::unique_ptr<std::max_align_t[]> up_block( new std::max_align_t[entry_size / sizeof( std::max_align_t ) + 1] );
+			char*                               p_entry = reinterpret_cast<char*>( up_block.get() );
+			base_t*                             p_obj   = new ( p_entry + header_size ) cur_container_t( std::forward<F>( f ), std::forward<Args>( args )... );
+			new ( p_entry ) entry_header( entry_size, p_obj, &invoke_entry<cur_container_t> );
+
+			pending_blocks_.emplace_back( std::move( up_block ) );
+			return register_entry( reinterpret_cast<entry_header*>( p_entry ), pending_blocks_.size() - 1, true );
+		}
+
+		if ( used_ + entry_size > capacity_ ) {
+			rebuild( grown_capacity( entry_size ) );
+		}
+
+		char*   p_entry = arena() + used_;
+		base_t* p_obj   = new ( p_entry + header_size ) cur_container_t( std::forward<F>( f ), std::forward<Args>( args )... );
+		new ( p_entry ) entry_header( entry_size, p_obj, &invoke_entry<cur_container_t> );
+
+		size_t offset = used_;
+		used_ += entry_size;
+		return register_entry( reinterpret_cast<entry_header*>( p_entry ), offset, false );
+	}
+
+	/**
+	 * @brief ハンドルhが指す購読者を削除する
+	 *
+	 * エントリは削除済みとするだけで、他のエントリは移動しない。
+	 * invoke_all()の実行中は、解除した購読者自身が実行中の場合があるため、破棄は最も外側のinvoke_all()から戻るときに行う。
+	 *
+	 * @retval true 削除した
+	 * @retval false 既に削除済み、あるいは無効なハンドル
+	 */
+	bool unsubscribe( handle h )
+	{
+		if ( !is_live( h ) ) return false;
+
+		slot_t&       cur_slot = slots_[h.slot_];
+		entry_header* p_header = header_of( cur_slot );
+		p_header->is_alive_    = false;
+		if ( is_invoking_ && !cur_slot.is_pending_ ) {
+			num_of_deferred_destructions_++;
+		} else {
+			// アリーナ外のエントリは、実行中のinvoke_all()では呼び出されないため、すぐに破棄してよい
+			destroy_entry( p_header );
+		}
+		num_of_alive_--;
+		num_of_tombstones_++;
+
+		cur_slot.generation_++;
+		cur_slot.in_use_ = false;
+		free_slots_.push_back( h.slot_ );
+
+		if ( !is_invoking_ && should_compact() ) {
+			compact();
+		}
+		return true;
+	}
+
+	/**
+	 * @brief 購読中のすべての購読者を、追加した順に呼び出す
+	 *
+	 * 実行中に削除された購読者は、まだ呼び出していなければ呼び出さない。
+	 * 購読者が例外を送出した場合は、以降の購読者を呼び出さずに、例外をそのまま送出する。
+	 */
+	void invoke_all( void )
+	{
+		invoking_scope scope( *this );
+
+		size_t end_offset = used_;
+		size_t offset     = 0;
+		while ( offset < end_offset ) {
+			entry_header* p_header = header_at( offset );
+			if ( p_header->is_alive_ ) {
+				p_header->invoke_( p_header->p_obj_ );
+			}
+			offset += p_header->size_;
+		}
+	}
+
+	/**
+	 * @brief 削除済みのエントリを取り除き、購読中のエントリを詰め直す
+	 *
+	 * invoke_all()の実行中に呼び出した場合は、invoke_all()から戻るときに詰め直す。
+	 */
+	void compact( void )
+	{
+		if ( is_invoking_ ) {
+			is_compaction_requested_ = true;
+			return;
+		}
+		rebuild( capacity_ );
+	}
+
+	bool is_subscribed( handle h ) const
+	{
+		return is_live( h );
+	}
+
+	size_t size( void ) const
+	{
+		return num_of_alive_;
+	}
+
+	bool empty( void ) const
+	{
+		return num_of_alive_ == 0;
+	}
+
+	/**
+	 * @brief アリーナのうち、削除済みのエントリも含めて使用中のバイト数
+	 */
+	size_t arena_bytes_used( void ) const
+	{
+		return used_;
+	}
+
+private:
+	using invoker_t = void ( * )( base_t* );
+
+	struct entry_header {
+		entry_header( size_t size, base_t* p_obj, invoker_t invoke )
+		  : size_( size )
+		  , slot_( 0 )
+		  , is_alive_( true )
+		  , p_obj_( p_obj )
+		  , invoke_( invoke )
+		{
+		}
+
+		size_t    size_;       //!< ヘッダを含むエントリのバイト数
+		uint32_t  slot_;       //!< 本エントリを指すスロット
+		bool      is_alive_;   //!< 購読中かどうか。falseの場合は、invoke_all()が呼び出さない
+		base_t*   p_obj_;      //!< エントリ内のコンテナ。破棄済みの場合はnullptr
+		invoker_t invoke_;     //!< p_obj_の実際の型を知っている、購読者の呼び出し関数
+	};
+
+	/**
+	 * @brief 保持している値を、コピーせずに左辺値として渡して購読者を呼び出す
+	 */
+	template <typename Container>
+	static void invoke_entry( base_t* p_obj )
+	{
+		static_cast<Container*>( p_obj )->apply_func_lvalue();
+	}
+
+	struct slot_t {
+		size_t   offset_;       //!< アリーナ内のエントリのオフセット。is_pending_の場合は、pending_blocks_のインデックス
+		uint32_t generation_;   //!< 購読を解除する毎に増やす世代番号
+		bool     in_use_;
+		bool     is_pending_;   //!< invoke_all()の実行中に追加され、アリーナ外にあるかどうか
+	};
+
+	/**
+	 * @brief invoke_all()の実行中であることを示し、完了後に延期した処理を行う
+	 */
+	class invoking_scope {
+	public:
+		explicit invoking_scope( deferred_multicast_delegate& owner )
+		  : owner_( owner )
+		  , is_outermost_( !owner.is_invoking_ )
+		{
+			owner_.is_invoking_ = true;
+		}
+		~invoking_scope()
+		{
+			if ( !is_outermost_ ) return;
+
+			owner_.is_invoking_ = false;
+			owner_.finish_invoking();
+		}
+
+	private:
+		deferred_multicast_delegate& owner_;
+		bool                         is_outermost_;
+	};
+
+	static constexpr size_t round_up( size_t size )
+	{
+		return ( size + alignof( std::max_align_t ) - 1 ) / alignof( std::max_align_t ) * alignof( std::max_align_t );
+	}
+
+	static constexpr size_t header_size = ( sizeof( entry_header ) + alignof( std::max_align_t ) - 1 ) / alignof( std::max_align_t ) * alignof( std::max_align_t );
+
+	char* arena( void ) const
+	{
+		return reinterpret_cast<char*>( up_arena_.get() );
+	}
+
+	entry_header* header_at( size_t offset ) const
+	{
+		return reinterpret_cast<entry_header*>( arena() + offset );
+	}
+
+	entry_header* header_of( const slot_t& cur_slot ) const
+	{
+		if ( cur_slot.is_pending_ ) {
+			return reinterpret_cast<entry_header*>( pending_blocks_[cur_slot.offset_].get() );
+		}
+		return header_at( cur_slot.offset_ );
+	}
+
+	bool is_live( handle h ) const
+	{
+		if ( h.slot_ >= slots_.size() ) return false;
+		return slots_[h.slot_].in_use_ && ( slots_[h.slot_].generation_ == h.generation_ );
+	}
+
+	bool should_compact( void ) const
+	{
+		return ( num_of_tombstones_ > 16 ) && ( num_of_tombstones_ > num_of_alive_ );
+	}
+
+	/**
+	 * @brief 構築済みのエントリにスロットを割り当てる
+	 */
+	handle register_entry( entry_header* p_header, size_t offset, bool is_pending )
+	{
+		uint32_t slot;
+		if ( free_slots_.empty() ) {
+			slots_.push_back( slot_t { 0, 0, false, false } );
+			slot = static_cast<uint32_t>( slots_.size() - 1 );
+		} else {
+			slot = free_slots_.back();
+			free_slots_.pop_back();
+		}
+
+		slot_t& cur_slot     = slots_[slot];
+		cur_slot.offset_     = offset;
+		cur_slot.in_use_     = true;
+		cur_slot.is_pending_ = is_pending;
+		p_header->slot_      = slot;
+		num_of_alive_++;
+		return handle( slot, cur_slot.generation_ );
+	}
+
+	static void destroy_entry( entry_header* p_header )
+	{
+		if ( p_header->p_obj_ == nullptr ) return;
+		p_header->p_obj_->~base_t();
+		p_header->p_obj_ = nullptr;
+	}
+
+	/**
+	 * @brief 購読中のエントリと、追加するentry_sizeバイトのエントリが収まる容量
+	 */
+	size_t grown_capacity( size_t entry_size ) const
+	{
+		size_t required = entry_size;
+		for ( size_t offset = 0; offset < used_; offset += header_at( offset )->size_ ) {
+			if ( header_at( offset )->is_alive_ ) {
+				required += header_at( offset )->size_;
+			}
+		}
+		for ( const auto& up_block : pending_blocks_ ) {
+			const entry_header* p_header = reinterpret_cast<const entry_header*>( up_block.get() );
+			if ( p_header->is_alive_ ) {
+				required += p_header->size_;
+			}
+		}
+
+		size_t ans = ( capacity_ < 1024 ) ? 1024 : capacity_ * 2;
+		while ( ans < required ) {
+			ans *= 2;
+		}
+		return ans;
+	}
+
+	/**
+	 * @brief 最も外側のinvoke_all()から戻るときに、延期した破棄、アリーナ外のエントリの移動、詰め直しを行う
+	 */
+	void finish_invoking( void )
+	{
+		if ( num_of_deferred_destructions_ > 0 ) {
+			for ( size_t offset = 0; offset < used_; offset += header_at( offset )->size_ ) {
+				entry_header* p_header = header_at( offset );
+				if ( !p_header->is_alive_ ) {
+					destroy_entry( p_header );
+				}
+			}
+			num_of_deferred_destructions_ = 0;
+		}
+
+		if ( !pending_blocks_.empty() ) {
+			rebuild( grown_capacity( 0 ) );
+		} else if ( is_compaction_requested_ || should_compact() ) {
+			rebuild( capacity_ );
+		}
+		is_compaction_requested_ = false;
+	}
+
+	/**
+	 * @brief 容量new_capacityの新しいアリーナに、アリーナとアリーナ外の購読中のエントリを順にムーブする
+	 */
+	void rebuild( size_t new_capacity )
+	{
+		std::unique_ptr<std::max_align_t[]> up_new_arena( new std::max_align_t[new_capacity / sizeof( std::max_align_t ) + 1] );
+		char*                               p_new_arena = reinterpret_cast<char*>( up_new_arena.get() );
+
+		size_t new_used = 0;
+		for ( size_t offset = 0; offset < used_; offset += header_at( offset )->size_ ) {
+			relocate_entry( header_at( offset ), p_new_arena, new_used );
+		}
+		for ( auto& up_block : pending_blocks_ ) {
+			relocate_entry( reinterpret_cast<entry_header*>( up_block.get() ), p_new_arena, new_used );
+		}
+
+		up_arena_ = std::move( up_new_arena );
+		pending_blocks_.clear();
+		capacity_          = new_capacity;
+		used_              = new_used;
+		num_of_tombstones_ = 0;
+	}
+
+	/**
+	 * @brief 購読中のエントリを、新しいアリーナのnew_usedの位置にムーブする
+	 */
+	void relocate_entry( entry_header* p_header, char* p_new_arena, size_t& new_used )
+	{
+		if ( !p_header->is_alive_ ) return;
+
+		char*   p_entry = p_new_arena + new_used;
+		base_t* p_obj   = p_header->p_obj_->placement_new_move( p_entry + header_size );
+		new ( p_entry ) entry_header( p_header->size_, p_obj, p_header->invoke_ );
+		reinterpret_cast<entry_header*>( p_entry )->slot_ = p_header->slot_;
+		destroy_entry( p_header );
+
+		slot_t& cur_slot     = slots_[p_header->slot_];
+		cur_slot.offset_     = new_used;
+		cur_slot.is_pending_ = false;
+		new_used += p_header->size_;
+	}
+
+	void destroy_all( void )
+	{
+		for ( size_t offset = 0; offset < used_; offset += header_at( offset )->size_ ) {
+			destroy_entry( header_at( offset ) );
+		}
+		for ( auto& up_block : pending_blocks_ ) {
+			destroy_entry( reinterpret_cast<entry_header*>( up_block.get() ) );
+		}
+		pending_blocks_.clear();
+		used_ = 0;
+	}
+
+	std::unique_ptr<std::max_align_t[]>              up_arena_;                       //!< エントリを連続して格納する領域
+	size_t                                           capacity_;                       //!< アリーナのバイト数
+	size_t                                           used_;                           //!< アリーナの使用済みバイト数
+	std::vector<std::unique_ptr<std::max_align_t[]>> pending_blocks_;                 //!< invoke_all()の実行中に追加し、アリーナ外に構築したエントリ
+	std::vector<slot_t>                              slots_;                          //!< ハンドルからエントリへの間接参照テーブル
+	std::vector<uint32_t>                            free_slots_;                     //!< 未使用のスロット
+	size_t                                           num_of_alive_;                   //!< 購読中のエントリ数
+	size_t                                           num_of_tombstones_;              //!< 削除済みのエントリ数
+	size_t                                           num_of_deferred_destructions_;   //!< invoke_all()の実行中に解除し、破棄を延期しているエントリ数
+	bool                                             is_invoking_;
+	bool                                             is_compaction_requested_;        //!< invoke_all()の実行中にcompact()が呼び出されたかどうか
+};
+
+#endif
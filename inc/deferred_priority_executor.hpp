@@ -0,0 +1,372 @@
+/**
+ * @file deferred_priority_executor.hpp
+ * @author PFA03027@nifty.com
+ * @brief executor that runs deferred_apply<void> tasks from a fixed number of priority lanes
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023, PFA03027@nifty.com
+ *
+ */
+
+#ifndef DEFERRED_PRIORITY_EXECUTOR_HPP_
+#define DEFERRED_PRIORITY_EXECUTOR_HPP_
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "deferred_apply.hpp"
+
+/**
+ * @brief 優先度レーンからタスクを取り出す方式
+ */
+enum class priority_dequeue_policy {
+	strict,     //!< 常に、空でない最も優先度の高いレーンから取り出す
+	weighted,   //!< レーン毎の重みに比例した回数ずつ、順番に取り出す
+};
+
+/**
+ * @brief Executor that runs deferred_apply<void> tasks from a fixed number of priority lanes
+ *
+ * Example of use:
+ * @code {.cpp}
+ * deferred_priority_executor<2> ex( 4 );   // 2 lanes, 4 worker threads
+ * ex.post( 0, control_message_handler, msg );   // lane 0 is the highest priority
+ * ex.post( 1, bulk_job, data );
+ * @endcode
+ *
+ * Each lane has its own lock and queue, so producers of different lanes do not contend.
+ * A lower priority lane whose oldest task has waited longer than the starvation threshold is served first,
+ * so that bulk tasks do not starve even if high priority tasks keep arriving.
+ *
+ * @warning
+ * Arguments are held in the same way as deferred_apply<void>, so lvalue arguments are held as lvalue references. @n
+ * Since tasks are executed by other threads, lvalue arguments must be alive until the task is executed. Pass a copy or move it if not.
+ *
+ * @brief 固定数の優先度レーンから、deferred_apply<void>のタスクを取り出して実行するエグゼキュータ
+ *
+ * レーン毎にロックとキューを持つため、異なるレーンへ投入するスレッド同士は競合しない。
+ * 最も古いタスクの待ち時間が飢餓防止の閾値を超えた低優先度のレーンは、優先して処理される。
+ * そのため、高優先度のタスクが投入され続けても、低優先度のタスクが処理されなくなることはない。
+ *
+ * @warning
+ * 引数はdeferred_apply<void>と同じ方式で保持されるため、左辺値の引数は左辺値参照として保持される。 @n
+ * タスクは他のスレッドで実行されるため、左辺値の引数はタスクが実行されるまで生存していなければならない。そうでない場合は、コピーを渡すかムーブすること。
+ *
+ * @tparam NumLanes レーン数。レーン0が最も優先度が高い。
+ */
+template <size_t NumLanes = 2>
+class deferred_priority_executor {
+	static_assert( NumLanes > 0, "NumLanes should be greater than 0" );
+
+public:
+	using clock_type = std::chrono::steady_clock;
+
+	/**
+	 * @brief エグゼキュータの動作設定
+	 */
+	struct config {
+		config( void )
+		  : policy( priority_dequeue_policy::strict )
+		  , weights()
+		  , starvation_threshold( std::chrono::milliseconds( 100 ) )
+		{
+			weights.fill( 1 );
+		}
+
+		priority_dequeue_policy            policy;                 //!< タスクを取り出す方式
+		std::array<unsigned int, NumLanes> weights;                //!< priority_dequeue_policy::weighted の場合の、各レーンの重み
+		clock_type::duration               starvation_threshold;   //!< 飢餓防止の閾値。0の場合は飢餓防止を行わない
+	};
+
+	explicit deferred_priority_executor( size_t num_of_workers, const config& cfg = config() )
+	  : cfg_( cfg )
+	  , lanes_()
+	  , num_of_pending_( 0 )
+	  , num_of_sleepers_( 0 )
+	  , sleep_mtx_()
+	  , sleep_cv_()
+	  , stop_( false )
+	  , is_terminated_( false )
+	  , workers_()
+	{
+		for ( auto& w : cfg_.weights ) {
+			if ( w == 0 ) w = 1;
+		}
+
+		workers_.reserve( num_of_workers );
+		for ( size_t i = 0; i < num_of_workers; i++ ) {
+			workers_.emplace_back( &deferred_priority_executor::worker_loop, this );
+		}
+	}
+
+	deferred_priority_executor( const deferred_priority_executor& )            = delete;
+	deferred_priority_executor& operator=( const deferred_priority_executor& ) = delete;
+
+	~deferred_priority_executor()
+	{
+		shutdown();
+	}
+
+	/**
+	 * @brief レーンlaneに、f(args...)を実行するタスクを投入する
+	 *
+	 * fの戻り値の型はvoidであること。
+	 */
+	template <typename F,
+	          typename... Args,
+	          typename std::enable_if<!std::is_same<typename std::decay<F>::type, deferred_apply<void>>::value>::type* = nullptr>
+	void post( size_t lane, F&& f, Args&&... args )
+	{
+		post( lane, deferred_apply<void>( std::forward<F>( f ), std::forward<Args>( args )... ) );
+	}
+
+	/**
+	 * @brief レーンlaneに、taskを投入する
+	 *
+	 * laneがレーン数以上の場合は、最も優先度の低いレーンに投入する。
+	 * shutdown()でワーカースレッドが終了した後は、taskを呼び出したスレッドで直ちに実行する。
+	 */
+	void post( size_t lane, deferred_apply<void>&& task )
+	{
+		if ( is_terminated_.load() ) {
+			task.apply();
+			return;
+		}
+		if ( lane >= NumLanes ) lane = NumLanes - 1;
+
+		lane_t& cur_lane = lanes_[lane];
+		{
+			std::lock_guard<std::mutex> lk( cur_lane.mtx_ );
+			cur_lane.q_.emplace_back( std::move( task ), clock_type::now() );
+			cur_lane.size_.store( cur_lane.q_.size(), std::memory_order_release );
+			// 取り出し側はロック内で減らすため、取り出される前に増やしておかないと、一時的に0未満(SIZE_MAX)となる
+			num_of_pending_.fetch_add( 1 );
+		}
+
+		if ( is_terminated_.load() ) {
+			// shutdown()と競合し、ワーカースレッドの終了後に投入した。shutdown()が取り出していなければ、ここで実行する
+			run_remaining();
+			return;
+		}
+		if ( num_of_sleepers_.load() > 0 ) {
+			// 待機に入ろうとしているワーカーが起床条件を確認し終わってから通知するため、一旦ロックを取得する
+			{
+				std::lock_guard<std::mutex> lk( sleep_mtx_ );
+			}
+			sleep_cv_.notify_one();
+		}
+	}
+
+	/**
+	 * @brief 最も優先度の低いレーンに、taskを投入する
+	 */
+	void post( deferred_apply<void>&& task )
+	{
+		post( NumLanes - 1, std::move( task ) );
+	}
+
+	/**
+	 * @brief 投入済みのタスクをすべて実行してから、ワーカースレッドを終了する
+	 *
+	 * 以降にpost()したタスクは、キューに入れずにpost()を呼び出したスレッドで実行する。
+	 */
+	void shutdown( void )
+	{
+		{
+			std::lock_guard<std::mutex> lk( sleep_mtx_ );
+			stop_ = true;
+		}
+		sleep_cv_.notify_all();
+
+		for ( auto& t : workers_ ) {
+			if ( t.joinable() ) t.join();
+		}
+		workers_.clear();
+
+		// ワーカースレッドの終了と競合して投入されたタスクを、呼び出したスレッドで実行する
+		is_terminated_.store( true );
+		run_remaining();
+	}
+
+	/**
+	 * @brief レーンlaneで、実行待ちとなっているタスク数
+	 */
+	size_t pending( size_t lane ) const
+	{
+		if ( lane >= NumLanes ) return 0;
+		return lanes_[lane].size_.load( std::memory_order_acquire );
+	}
+
+	static constexpr size_t number_of_lanes( void )
+	{
+		return NumLanes;
+	}
+
+private:
+	struct queued_task {
+		queued_task( deferred_apply<void>&& task, clock_type::time_point enqueued_at )
+		  : task_( std::move( task ) )
+		  , enqueued_at_( enqueued_at )
+		{
+		}
+
+		deferred_apply<void>   task_;
+		clock_type::time_point enqueued_at_;
+	};
+
+	struct lane_t {
+		lane_t( void )
+		  : mtx_()
+		  , q_()
+		  , size_( 0 )
+		{
+		}
+
+		std::mutex              mtx_;
+		std::deque<queued_task> q_;
+		std::atomic<size_t>     size_;   //!< ロックを取得せずに空かどうかを判定するためのq_の要素数
+	};
+
+	/**
+	 * @brief priority_dequeue_policy::weighted のための、ワーカースレッド毎の状態
+	 */
+	struct worker_state {
+		worker_state( void )
+		  : cur_lane_( 0 )
+		  , credits_( 0 )
+		{
+		}
+
+		size_t       cur_lane_;
+		unsigned int credits_;
+	};
+
+	bool try_pop_from( size_t lane, deferred_apply<void>& task )
+	{
+		lane_t& cur_lane = lanes_[lane];
+		if ( cur_lane.size_.load( std::memory_order_acquire ) == 0 ) return false;
+
+		std::lock_guard<std::mutex> lk( cur_lane.mtx_ );
+		if ( cur_lane.q_.empty() ) return false;
+		task = std::move( cur_lane.q_.front().task_ );
+		cur_lane.q_.pop_front();
+		cur_lane.size_.store( cur_lane.q_.size(), std::memory_order_release );
+		num_of_pending_.fetch_sub( 1 );
+		return true;
+	}
+
+	/**
+	 * @brief 最も古いタスクの待ち時間が閾値を超えた低優先度のレーンから、タスクを取り出す
+	 */
+	bool try_pop_starving( deferred_apply<void>& task )
+	{
+		if ( cfg_.starvation_threshold <= clock_type::duration::zero() ) return false;
+
+		clock_type::time_point deadline = clock_type::now() - cfg_.starvation_threshold;
+		for ( size_t lane = NumLanes - 1; lane > 0; lane-- ) {
+			lane_t& cur_lane = lanes_[lane];
+			if ( cur_lane.size_.load( std::memory_order_acquire ) == 0 ) continue;
+
+			std::lock_guard<std::mutex> lk( cur_lane.mtx_ );
+			if ( cur_lane.q_.empty() ) continue;
+			if ( deadline < cur_lane.q_.front().enqueued_at_ ) continue;
+			task = std::move( cur_lane.q_.front().task_ );
+			cur_lane.q_.pop_front();
+			cur_lane.size_.store( cur_lane.q_.size(), std::memory_order_release );
+			num_of_pending_.fetch_sub( 1 );
+			return true;
+		}
+		return false;
+	}
+
+	bool try_pop_strict( deferred_apply<void>& task )
+	{
+		for ( size_t lane = 0; lane < NumLanes; lane++ ) {
+			if ( try_pop_from( lane, task ) ) return true;
+		}
+		return false;
+	}
+
+	bool try_pop_weighted( worker_state& ws, deferred_apply<void>& task )
+	{
+		// 現在のレーンの持ち分を使い切るか、レーンが空ならば次のレーンに移る
+		for ( size_t i = 0; i <= NumLanes; i++ ) {
+			if ( ws.credits_ == 0 ) {
+				ws.cur_lane_ = ( ws.cur_lane_ + 1 ) % NumLanes;
+				ws.credits_  = cfg_.weights[ws.cur_lane_];
+			}
+			if ( try_pop_from( ws.cur_lane_, task ) ) {
+				ws.credits_--;
+				return true;
+			}
+			ws.credits_ = 0;
+		}
+		return false;
+	}
+
+	bool try_pop( worker_state& ws, deferred_apply<void>& task )
+	{
+		if ( num_of_pending_.load() == 0 ) return false;
+		if ( try_pop_starving( task ) ) return true;
+
+		if ( cfg_.policy == priority_dequeue_policy::weighted ) {
+			return try_pop_weighted( ws, task );
+		}
+		return try_pop_strict( task );
+	}
+
+	/**
+	 * @brief ワーカースレッドの終了後に残っているタスクを、優先度の順に呼び出したスレッドで実行する
+	 */
+	void run_remaining( void )
+	{
+		deferred_apply<void> task;
+		while ( try_pop_strict( task ) ) {
+			task.apply();
+		}
+	}
+
+	void worker_loop( void )
+	{
+		worker_state ws;
+		ws.cur_lane_ = NumLanes - 1;   // 最初の取り出しで、レーン0から開始するため
+
+		while ( true ) {
+			deferred_apply<void> task;
+			if ( try_pop( ws, task ) ) {
+				task.apply();
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lk( sleep_mtx_ );
+			num_of_sleepers_.fetch_add( 1 );
+			sleep_cv_.wait( lk, [this]() {
+				return stop_ || ( num_of_pending_.load() > 0 );
+			} );
+			num_of_sleepers_.fetch_sub( 1 );
+			if ( stop_ && ( num_of_pending_.load() == 0 ) ) return;
+		}
+	}
+
+	config                       cfg_;
+	std::array<lane_t, NumLanes> lanes_;
+	std::atomic<size_t>          num_of_pending_;    //!< 全レーンの実行待ちタスク数
+	std::atomic<size_t>          num_of_sleepers_;   //!< 待機中のワーカースレッド数
+	std::mutex                   sleep_mtx_;
+	std::condition_variable      sleep_cv_;
+	bool                         stop_;
+	std::atomic<bool>            is_terminated_;   //!< shutdown()で、ワーカースレッドが終了したかどうか
+	std::vector<std::thread>     workers_;
+};
+
+#endif
@@ -0,0 +1,483 @@
+/**
+ * @file deferred_sharded_executor.hpp
+ * @author PFA03027@nifty.com
+ * @brief executor with one worker pinned to each CPU, whose cross-core posts go through per-pair SPSC rings
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023, PFA03027@nifty.com
+ *
+ */
+
+#ifndef DEFERRED_SHARDED_EXECUTOR_HPP_
+#define DEFERRED_SHARDED_EXECUTOR_HPP_
+
+#include <sched.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "deferred_apply.hpp"
+#include "deferred_async_logger.hpp"
+
+/**
+ * @brief Executor with one worker pinned to each CPU, whose cross-core posts go through per-pair SPSC rings
+ *
+ * Example of use:
+ * @code {.cpp}
+ * deferred_size_class_pool::install();   // each worker allocates heap fallbacks from its own free lists
+ * deferred_sharded_executor ex;          // one worker per CPU available to the process
+ *
+ * size_t core = key_hash % ex.number_of_workers();
+ * ex.post_to( core, handle_request, &shards[core], std::move( req ) );
+ * @endcode
+ *
+ * Each worker is pinned by sched_setaffinity() to one of the CPUs in the affinity mask of the constructing thread, and owns a shard of the work.
+ * A task posted by a worker to another worker goes through the SPSC ring dedicated to the pair of them, so no lock is taken and
+ * producers for the same worker do not contend on a shared queue. The ring for a pair is created at the first post between them.
+ * When the ring is full, the task is kept in the overflow queue of the producing worker, and the producing worker moves it to the ring later,
+ * so the tasks from one worker to another are executed in the order of posting.
+ * Tasks posted from threads that are not workers go through the mutex-protected inbox of the destination worker.
+ *
+ * deferred_apply<void> allocates the function and arguments that do not fit in its inline buffer by the allocator set by set_deferred_apply_heap_allocator().
+ * With deferred_size_class_pool installed, the free lists are per thread, so each worker serves the heap fallbacks of the tasks it creates from its own arena,
+ * carved on the worker's own CPU.
+ *
+ * post( deferred_apply<void>&& ) posts to the calling worker itself, or in round robin from other threads, so that this class can be used as an executor of other components.
+ *
+ * @brief CPU毎に1つのワーカーを固定して実行し、コア間の投入をペア毎のSPSCリングで受け渡すエグゼキュータ
+ *
+ * 各ワーカーは、構築したスレッドのアフィニティマスクに含まれるCPUの1つに、sched_setaffinity()で固定され、処理のシャードを担当する。
+ * ワーカーから他のワーカーへ投入したタスクは、そのペア専用のSPSCリングで受け渡すため、ロックを取得せず、同じワーカーへ投入するスレッド同士も共有のキューで競合しない。
+ * ペアのリングは、そのペアの間の最初の投入で生成する。
+ * リングが満杯の場合、タスクは投入したワーカーのオーバーフローキューに保持し、後で投入したワーカーがリングに移すため、
+ * あるワーカーから別のワーカーへのタスクは、投入順に実行される。
+ * ワーカー以外のスレッドから投入したタスクは、投入先のワーカーの、mutexで保護された受信キューで受け渡す。
+ *
+ * deferred_apply<void>は、内部バッファに収まらない関数と引数を、set_deferred_apply_heap_allocator()で設定したアロケータで確保する。
+ * deferred_size_class_poolを設定した場合、フリーリストはスレッド毎であるため、各ワーカーは自身が生成したタスクのヒープ領域を、
+ * 自身のCPUで切り出した自身のアリーナから確保する。
+ *
+ * post( deferred_apply<void>&& )は、ワーカーからの呼び出しでは自身に、他のスレッドからの呼び出しではラウンドロビンで投入するため、他のコンポーネントのエグゼキュータとして使用できる。
+ *
+ * @warning
+ * 引数はdeferred_apply<void>と同じ方式で保持されるため、左辺値の引数は左辺値参照として保持される。 @n
+ * タスクは例外を送出してはならない。 @n
+ * ワーカーから、本インスタンスを破棄してはならない。 @n
+ * Linux専用である。CPUへの固定に失敗した場合(権限の制限など)は、固定せずに動作する。
+ */
+class deferred_sharded_executor {
+public:
+	/**
+	 * @brief エグゼキュータの動作設定
+	 */
+	struct config {
+		config( void )
+		  : num_of_workers( 0 )
+		  , pin_workers( true )
+		  , ring_capacity( 256 )
+		{
+		}
+
+		size_t num_of_workers;   //!< ワーカー数。0の場合は、構築したスレッドのアフィニティマスクに含まれるCPU数
+		bool   pin_workers;      //!< ワーカーをCPUに固定するかどうか
+		size_t ring_capacity;    //!< ワーカーのペア毎のリングに保持できるタスク数。2のべき乗に切り上げられる
+	};
+
+	static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+	explicit deferred_sharded_executor( const config& cfg = config() )
+	  : cfg_( cfg )
+	  , workers_()
+	  , up_rings_()
+	  , next_core_( 0 )
+	  , stop_( false )
+	{
+		std::vector<int> cpus = available_cpus();
+		size_t           num  = ( cfg_.num_of_workers == 0 ) ? cpus.size() : cfg_.num_of_workers;
+
+		workers_.reserve( num );
+		for ( size_t i = 0; i < num; i++ ) {
+			workers_.emplace_back( new worker_t( cpus[i % cpus.size()], num ) );
+		}
+		up_rings_.reset( new std::atomic<ring_t*>[num * num] );
+		for ( size_t i = 0; i < num * num; i++ ) {
+			up_rings_[i].store( nullptr, std::memory_order_relaxed );
+		}
+
+		// すべてのワーカーとリングの表を構築してから、スレッドを開始する
+		for ( size_t i = 0; i < num; i++ ) {
+			workers_[i]->th_ = std::thread( &deferred_sharded_executor::worker_loop, this, i );
+		}
+	}
+
+	deferred_sharded_executor( const deferred_sharded_executor& )            = delete;
+	deferred_sharded_executor& operator=( const deferred_sharded_executor& ) = delete;
+
+	~deferred_sharded_executor()
+	{
+		shutdown();
+
+		for ( size_t i = 0; i < workers_.size() * workers_.size(); i++ ) {
+			delete up_rings_[i].load( std::memory_order_relaxed );
+		}
+	}
+
+	/**
+	 * @brief ワーカーcoreで、f(args...)を実行するタスクを投入する
+	 *
+	 * fの戻り値の型はvoidであること。
+	 */
+	template <typename F,
+	          typename... Args,
+	          typename std::enable_if<!std::is_same<typename std::decay<F>::type, deferred_apply<void>>::value>::type* = nullptr>
+	void post_to( size_t core, F&& f, Args&&... args )
+	{
+		post_to( core, deferred_apply<void>( std::forward<F>( f ), std::forward<Args>( args )... ) );
+	}
+
+	/**
+	 * @brief ワーカーcoreに、taskを投入する
+	 *
+	 * coreがワーカー数以上の場合は、ワーカー数の剰余のワーカーに投入する。
+	 */
+	void post_to( size_t core, deferred_apply<void>&& task )
+	{
+		core %= workers_.size();
+
+		size_t from = current_core();
+		if ( from == npos ) {
+			post_to_inbox( core, std::move( task ) );
+			return;
+		}
+
+		worker_t&                         w_from   = *workers_[from];
+		std::deque<deferred_apply<void>>& overflow = w_from.overflow_[core];
+		if ( overflow.empty() && get_ring( from, core )->try_emplace( std::move( task ) ) ) {
+			notify( core, 1 );
+			return;
+		}
+
+		// 投入順を保つため、先に溢れたタスクがリングに移るまでは、オーバーフローキューに追加する
+		overflow.emplace_back( std::move( task ) );
+		w_from.num_of_overflow_++;
+	}
+
+	/**
+	 * @brief taskを投入する
+	 *
+	 * ワーカーから呼び出した場合は自身に、それ以外のスレッドから呼び出した場合はラウンドロビンで選んだワーカーに投入する。
+	 */
+	void post( deferred_apply<void>&& task )
+	{
+		size_t core = current_core();
+		if ( core == npos ) {
+			core = next_core_.fetch_add( 1, std::memory_order_relaxed );
+		}
+		post_to( core, std::move( task ) );
+	}
+
+	/**
+	 * @brief 投入済みのタスクをすべて実行してから、ワーカースレッドを終了する
+	 *
+	 * ワーカーが終了した後に投入されたタスクは、shutdown()を呼び出したスレッドで実行する。
+	 *
+	 * ワーカー(タスクの中など)から呼び出した場合は、自身をjoinできないため、ワーカーに終了を要求するだけで戻る。
+	 * この場合、ワーカースレッドのjoinと、ワーカーが終了した後に投入されたタスクの実行は、
+	 * ワーカー以外のスレッドからのshutdown()、あるいはデストラクタで行われる。
+	 */
+	void shutdown( void )
+	{
+		stop_.store( true );
+		for ( auto& up_w : workers_ ) {
+			{
+				std::lock_guard<std::mutex> lk( up_w->mtx_ );
+			}
+			up_w->cv_.notify_one();
+		}
+		if ( current_core() != npos ) return;
+
+		for ( auto& up_w : workers_ ) {
+			if ( up_w->th_.joinable() ) up_w->th_.join();
+		}
+
+		size_t num_of_done;
+		do {
+			num_of_done = 0;
+			for ( size_t i = 0; i < workers_.size(); i++ ) {
+				num_of_done += run_pending( i );
+			}
+		} while ( num_of_done > 0 );
+	}
+
+	/**
+	 * @brief 呼び出したスレッドが本エグゼキュータのワーカーの場合は、そのワーカーの番号。それ以外の場合はnpos
+	 */
+	size_t current_core( void ) const
+	{
+		const current_worker& cw = current();
+		if ( cw.p_owner_ != this ) return npos;
+		return cw.idx_;
+	}
+
+	/**
+	 * @brief ワーカーcoreを固定するCPUの番号
+	 */
+	int cpu_of( size_t core ) const
+	{
+		return workers_[core % workers_.size()]->cpu_;
+	}
+
+	size_t number_of_workers( void ) const
+	{
+		return workers_.size();
+	}
+
+private:
+	using ring_t = deferred_apply_internal::spsc_ring<deferred_apply<void>>;
+
+	struct worker_t {
+		worker_t( int cpu, size_t num_of_workers )
+		  : cpu_( cpu )
+		  , num_of_pending_( 0 )
+		  , is_sleeping_( false )
+		  , mtx_()
+		  , cv_()
+		  , inbox_()
+		  , inbox_size_( 0 )
+		  , overflow_( num_of_workers )
+		  , num_of_overflow_( 0 )
+		  , th_()
+		{
+		}
+
+		const int                                     cpu_;
+		std::atomic<size_t>                           num_of_pending_;    //!< 本ワーカーへ投入され、実行待ちのタスク数
+		std::atomic<bool>                             is_sleeping_;       //!< 本ワーカーが待機中かどうか
+		std::mutex                                    mtx_;               //!< inbox_と待機を保護する
+		std::condition_variable                       cv_;
+		std::deque<deferred_apply<void>>              inbox_;             //!< ワーカー以外のスレッドから投入されたタスク
+		std::atomic<size_t>                           inbox_size_;        //!< ロックを取得せずに、inbox_が空かどうかを判定するためのタスク数
+		std::vector<std::deque<deferred_apply<void>>> overflow_;          //!< リングが満杯のため、投入先毎に保持しているタスク。本ワーカーだけが参照する
+		size_t                                        num_of_overflow_;   //!< overflow_が保持しているタスク数。本ワーカーだけが参照する
+		std::thread                                   th_;
+	};
+
+	struct current_worker {
+		const deferred_sharded_executor* p_owner_;
+		size_t                           idx_;
+	};
+
+	/**
+	 * @brief 呼び出したスレッドが実行しているワーカー
+	 */
+	static current_worker& current( void )
+	{
+		static thread_local current_worker cw = { nullptr, npos };
+		return cw;
+	}
+
+	/**
+	 * @brief 構築したスレッドのアフィニティマスクに含まれるCPUの番号
+	 */
+	static std::vector<int> available_cpus( void )
+	{
+		std::vector<int> ans;
+
+		cpu_set_t cur_set;
+		CPU_ZERO( &cur_set );
+		if ( ::sched_getaffinity( 0, sizeof( cur_set ), &cur_set ) == 0 ) {
+			for ( int i = 0; i < CPU_SETSIZE; i++ ) {
+				if ( CPU_ISSET( i, &cur_set ) ) ans.push_back( i );
+			}
+		}
+		if ( ans.empty() ) {
+			unsigned int num = std::thread::hardware_concurrency();
+			for ( unsigned int i = 0; i < ( ( num == 0 ) ? 1 : num ); i++ ) {
+				ans.push_back( static_cast<int>( i ) );
+			}
+		}
+		return ans;
+	}
+
+	/**
+	 * @brief ワーカーfromからワーカーtoへのリングを取得する。初回のみ、fromのスレッドでリングを生成する
+	 */
+	ring_t* get_ring( size_t from, size_t to )
+	{
+		std::atomic<ring_t*>& slot   = up_rings_[to * workers_.size() + from];
+		ring_t*               p_ring = slot.load( std::memory_order_relaxed );   // 生成するのはfrom自身のため、relaxedで良い
+		if ( p_ring == nullptr ) {
+			p_ring = new ring_t( cfg_.ring_capacity );
+			slot.store( p_ring, std::memory_order_release );
+		}
+		return p_ring;
+	}
+
+	void post_to_inbox( size_t core, deferred_apply<void>&& task )
+	{
+		worker_t& w = *workers_[core];
+		{
+			std::lock_guard<std::mutex> lk( w.mtx_ );
+			w.inbox_.emplace_back( std::move( task ) );
+			w.inbox_size_.store( w.inbox_.size(), std::memory_order_release );
+		}
+		notify( core, 1 );
+	}
+
+	/**
+	 * @brief ワーカーcoreの実行待ちタスク数を増やし、待機中であれば起床させる
+	 */
+	void notify( size_t core, size_t num )
+	{
+		worker_t& w = *workers_[core];
+		w.num_of_pending_.fetch_add( num );
+		if ( w.is_sleeping_.load() ) {
+			// 待機に入ろうとしているワーカーが起床条件を確認し終わってから通知するため、一旦ロックを取得する
+			{
+				std::lock_guard<std::mutex> lk( w.mtx_ );
+			}
+			w.cv_.notify_one();
+		}
+	}
+
+	/**
+	 * @brief ワーカーfromのオーバーフローキューのタスクを、空きのあるリングに移す
+	 */
+	void flush_overflow( size_t from )
+	{
+		worker_t& w_from = *workers_[from];
+		for ( size_t to = 0; ( to < workers_.size() ) && ( w_from.num_of_overflow_ > 0 ); to++ ) {
+			std::deque<deferred_apply<void>>& overflow = w_from.overflow_[to];
+			if ( overflow.empty() ) continue;
+
+			ring_t* p_ring = get_ring( from, to );
+			size_t  num    = 0;
+			while ( !overflow.empty() && p_ring->try_emplace( std::move( overflow.front() ) ) ) {
+				overflow.pop_front();
+				num++;
+			}
+			if ( num > 0 ) {
+				w_from.num_of_overflow_ -= num;
+				notify( to, num );
+			}
+		}
+	}
+
+	/**
+	 * @brief ワーカーの終了時に、残っているオーバーフローキューのタスクを投入先の受信キューに移す
+	 *
+	 * 投入先のワーカーが終了済みの場合でも、shutdown()がリング、受信キューの順に実行するため、投入順は保たれる。
+	 */
+	void move_overflow_to_inbox( size_t from )
+	{
+		worker_t& w_from = *workers_[from];
+		for ( size_t to = 0; to < workers_.size(); to++ ) {
+			std::deque<deferred_apply<void>>& overflow = w_from.overflow_[to];
+			while ( !overflow.empty() ) {
+				post_to_inbox( to, std::move( overflow.front() ) );
+				overflow.pop_front();
+			}
+		}
+		w_from.num_of_overflow_ = 0;
+	}
+
+	/**
+	 * @brief ワーカーcoreへ投入されたタスクを、各リング、受信キューの順に実行する
+	 *
+	 * @return 実行したタスク数
+	 */
+	size_t run_pending( size_t core )
+	{
+		worker_t& w   = *workers_[core];
+		size_t    ans = 0;
+
+		for ( size_t from = 0; from < workers_.size(); from++ ) {
+			ring_t* p_ring = up_rings_[core * workers_.size() + from].load( std::memory_order_acquire );
+			if ( p_ring == nullptr ) continue;
+
+			ans += p_ring->consume_all( []( deferred_apply<void>& task ) {
+				task.apply();
+			} );
+		}
+
+		if ( w.inbox_size_.load( std::memory_order_acquire ) > 0 ) {
+			std::deque<deferred_apply<void>> tasks;
+			{
+				std::lock_guard<std::mutex> lk( w.mtx_ );
+				tasks.swap( w.inbox_ );
+				w.inbox_size_.store( 0, std::memory_order_release );
+			}
+			for ( auto& task : tasks ) {
+				task.apply();
+			}
+			ans += tasks.size();
+		}
+
+		if ( ans > 0 ) {
+			w.num_of_pending_.fetch_sub( ans );
+		}
+		return ans;
+	}
+
+	void pin_to_cpu( int cpu )
+	{
+		cpu_set_t cur_set;
+		CPU_ZERO( &cur_set );
+		CPU_SET( cpu, &cur_set );
+		::sched_setaffinity( 0, sizeof( cur_set ), &cur_set );   // 失敗した場合は、固定せずに動作する
+	}
+
+	void worker_loop( size_t idx )
+	{
+		worker_t& w = *workers_[idx];
+		if ( cfg_.pin_workers ) {
+			pin_to_cpu( w.cpu_ );
+		}
+		current() = current_worker { this, idx };
+
+		while ( true ) {
+			size_t num_of_done = run_pending( idx );
+			if ( w.num_of_overflow_ > 0 ) {
+				flush_overflow( idx );
+			}
+			if ( num_of_done > 0 ) continue;
+
+			std::unique_lock<std::mutex> lk( w.mtx_ );
+			w.is_sleeping_.store( true );
+			auto pred = [this, &w]() {
+				return stop_.load() || ( w.num_of_pending_.load() > 0 );
+			};
+			if ( w.num_of_overflow_ > 0 ) {
+				// 投入先のリングに空きができるのを待つ
+				w.cv_.wait_for( lk, std::chrono::microseconds( 100 ), pred );
+			} else {
+				w.cv_.wait( lk, pred );
+			}
+			w.is_sleeping_.store( false );
+
+			if ( stop_.load() && ( w.num_of_pending_.load() == 0 ) ) break;
+		}
+
+		move_overflow_to_inbox( idx );
+		current() = current_worker { nullptr, npos };
+	}
+
+	config                                  cfg_;
+	std::vector<std::unique_ptr<worker_t>>  workers_;
+	std::unique_ptr<std::atomic<ring_t*>[]> up_rings_;    //!< up_rings_[to * ワーカー数 + from]が、fromからtoへのリング
+	std::atomic<size_t>                     next_core_;   //!< ワーカー以外のスレッドからpost()する際の、次の投入先
+	std::atomic<bool>                       stop_;
+};
+
+#endif
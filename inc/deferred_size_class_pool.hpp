@@ -0,0 +1,332 @@
+/**
+ * @file deferred_size_class_pool.hpp
+ * @author PFA03027@nifty.com
+ * @brief size-class memory pool with per-thread free lists for the heap fallback of deferred_apply
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023, PFA03027@nifty.com
+ *
+ */
+
+#ifndef DEFERRED_SIZE_CLASS_POOL_HPP_
+#define DEFERRED_SIZE_CLASS_POOL_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <new>
+
+#include "deferred_apply.hpp"
+
+/**
+ * @brief Size-class memory pool with per-thread free lists, used by the heap fallback of deferred_apply
+ *
+ * Example of use:
+ * @code {.cpp}
+ * int main( void )
+ * {
+ *     deferred_size_class_pool::install();   // before using deferred_apply
+ *     ...
+ * }
+ * @endcode
+ *
+ * Each thread has a free list for each size class, so allocation and deallocation usually take no lock.
+ * A block freed by a thread other than the allocating one is kept in the free list of the freeing thread.
+ * When a free list of a thread grows beyond 2 * batch_size blocks, batch_size blocks are returned to the shared free list at once,
+ * and a thread that has no free block takes a batch from the shared free list. Therefore, even if one thread creates tasks and another
+ * thread destroys them, the lock is taken only once per batch_size blocks, and steady-state task churn allocates nothing from the system allocator.
+ *
+ * Blocks larger than max_block_size are allocated from the system allocator.
+ * The memory of the pool is never returned to the system allocator, because deferred_apply with static storage duration may be destroyed after the pool.
+ *
+ * @brief deferred_applyのヒープへの配置で使用する、スレッド毎のフリーリストを持つサイズクラス別のメモリプール
+ *
+ * スレッド毎にサイズクラス別のフリーリストを持つため、通常、確保と解放でロックは不要である。
+ * 確保したスレッドとは異なるスレッドで解放したブロックは、解放したスレッドのフリーリストに保持する。
+ * スレッドのフリーリストが 2 * batch_size 個を超えた場合は、batch_size 個をまとめて共有のフリーリストに返却し、
+ * 空きブロックがないスレッドは、共有のフリーリストからまとめて取得する。
+ * そのため、タスクを生成するスレッドと破棄するスレッドが異なる場合でも、ロックは batch_size 個に1回となり、
+ * 定常状態では、システムのアロケータからのメモリ確保は発生しない。
+ *
+ * max_block_size を超えるブロックは、システムのアロケータから確保する。
+ * 静的記憶域期間のdeferred_applyがプールより後に破棄される可能性があるため、プールのメモリはシステムのアロケータに返却しない。
+ */
+class deferred_size_class_pool {
+public:
+	static constexpr size_t min_block_size    = 64;                                             //!< 最小のサイズクラスのブロックサイズ[byte]
+	static constexpr size_t number_of_classes = 7;                                              //!< サイズクラスの数。ブロックサイズは、最小から2倍ずつ増える
+	static constexpr size_t max_block_size    = min_block_size << ( number_of_classes - 1 );   //!< 最大のサイズクラスのブロックサイズ[byte]
+	static constexpr size_t chunk_size        = 64 * 1024;                                      //!< システムのアロケータから一度に確保するサイズ[byte]
+	static constexpr size_t batch_size        = 32;                                             //!< スレッドと共有のフリーリストの間で、一度に受け渡すブロック数
+
+	/**
+	 * @brief deferred_applyが、内部バッファに収まらない関数と引数を配置する際に、本プールを使用するように設定する
+	 *
+	 * スレッドセーフではないため、deferred_applyを使用する前に呼び出すこと。
+	 *
+	 * @return 以前に設定されていたアロケータ
+	 */
+	static deferred_apply_heap_allocator install( void )
+	{
+		return set_deferred_apply_heap_allocator( deferred_apply_heap_allocator { allocate, deallocate } );
+	}
+
+	/**
+	 * @brief sizeバイトの領域を確保する
+	 */
+	static void* allocate( size_t size )
+	{
+		if ( size > max_block_size ) {
+			return ::operator new( size );
+		}
+
+		size_t        class_idx = size_class_of( size );
+		thread_cache* p_cache   = local_cache();
+		if ( p_cache == nullptr ) {
+			// スレッドの終了処理中のため、共有のフリーリストから直接確保する
+			free_block* p_block = central().pop_batch( class_idx );
+			if ( p_block == nullptr ) {
+				p_block = carve_chunk( class_idx );
+			}
+			central().push_batch( class_idx, p_block->next_ );
+			return p_block;
+		}
+
+		return p_cache->pop( class_idx );
+	}
+
+	/**
+	 * @brief allocate( size )で確保した領域を解放する
+	 */
+	static void deallocate( void* p, size_t size ) noexcept
+	{
+		if ( p == nullptr ) return;
+
+		if ( size > max_block_size ) {
+			::operator delete( p );
+			return;
+		}
+
+		size_t        class_idx = size_class_of( size );
+		free_block*   p_block   = static_cast<free_block*>( p );
+		thread_cache* p_cache   = local_cache();
+		if ( p_cache == nullptr ) {
+			// スレッドの終了処理中のため、共有のフリーリストに直接返却する
+			p_block->next_ = nullptr;
+			central().push_batch( class_idx, p_block );
+			return;
+		}
+
+		p_cache->push( class_idx, p_block );
+	}
+
+	/**
+	 * @brief プールがシステムのアロケータから確保したチャンクの数
+	 */
+	static size_t number_of_chunks( void )
+	{
+		return central().num_of_chunks_.load( std::memory_order_relaxed );
+	}
+
+private:
+	struct free_block {
+		free_block* next_;         //!< 同じバッチ内の次のブロック
+		free_block* next_batch_;   //!< 共有のフリーリストで、次のバッチの先頭ブロック。バッチの先頭ブロックのみ有効
+	};
+
+	static size_t size_class_of( size_t size )
+	{
+		size_t ans        = 0;
+		size_t block_size = min_block_size;
+		while ( block_size < size ) {
+			block_size <<= 1;
+			ans++;
+		}
+		return ans;
+	}
+
+	static constexpr size_t block_size_of( size_t class_idx )
+	{
+		return min_block_size << class_idx;
+	}
+
+	/**
+	 * @brief すべてのスレッドで共有する、バッチ単位のフリーリスト
+	 */
+	class central_free_list {
+	public:
+		central_free_list( void )
+		  : mtx_()
+		  , batch_head_()
+		  , num_of_chunks_( 0 )
+		{
+			for ( size_t i = 0; i < number_of_classes; i++ ) {
+				batch_head_[i] = nullptr;
+			}
+		}
+
+		/**
+		 * @brief next_で連結したブロックの列を、1つのバッチとして追加する
+		 */
+		void push_batch( size_t class_idx, free_block* p_head )
+		{
+			if ( p_head == nullptr ) return;
+
+			std::lock_guard<std::mutex> lk( mtx_ );
+			p_head->next_batch_    = batch_head_[class_idx];
+			batch_head_[class_idx] = p_head;
+		}
+
+		/**
+		 * @brief バッチを1つ取り出す
+		 *
+		 * @return バッチの先頭ブロック。バッチがない場合はnullptr
+		 */
+		free_block* pop_batch( size_t class_idx )
+		{
+			std::lock_guard<std::mutex> lk( mtx_ );
+			free_block*                 p_head = batch_head_[class_idx];
+			if ( p_head != nullptr ) {
+				batch_head_[class_idx] = p_head->next_batch_;
+			}
+			return p_head;
+		}
+
+		std::mutex          mtx_;
+		free_block*         batch_head_[number_of_classes];
+		std::atomic<size_t> num_of_chunks_;
+	};
+
+	/**
+	 * @brief スレッド毎のフリーリスト
+	 */
+	class thread_cache {
+	public:
+		thread_cache( void )
+		  : head_()
+		  , count_()
+		{
+			for ( size_t i = 0; i < number_of_classes; i++ ) {
+				head_[i]  = nullptr;
+				count_[i] = 0;
+			}
+		}
+
+		~thread_cache()
+		{
+			// 保持しているブロックを、他のスレッドが使えるように共有のフリーリストに返却する
+			for ( size_t i = 0; i < number_of_classes; i++ ) {
+				central().push_batch( i, head_[i] );
+				head_[i]  = nullptr;
+				count_[i] = 0;
+			}
+			is_destructed() = true;
+		}
+
+		free_block* pop( size_t class_idx )
+		{
+			if ( head_[class_idx] == nullptr ) {
+				free_block* p_batch = central().pop_batch( class_idx );
+				head_[class_idx]    = ( p_batch != nullptr ) ? p_batch : carve_chunk( class_idx );
+				count_[class_idx]   = count_list( head_[class_idx] );
+			}
+
+			free_block* p_block = head_[class_idx];
+			head_[class_idx]    = p_block->next_;
+			count_[class_idx]--;
+			return p_block;
+		}
+
+		void push( size_t class_idx, free_block* p_block )
+		{
+			p_block->next_    = head_[class_idx];
+			head_[class_idx]  = p_block;
+			count_[class_idx]++;
+
+			if ( count_[class_idx] >= 2 * batch_size ) {
+				// 先頭のbatch_size個を残し、残りを1つのバッチとして共有のフリーリストに返却する
+				free_block* p_last = head_[class_idx];
+				for ( size_t i = 1; i < batch_size; i++ ) {
+					p_last = p_last->next_;
+				}
+				free_block* p_batch = p_last->next_;
+				p_last->next_       = nullptr;
+				count_[class_idx]   = batch_size;
+				central().push_batch( class_idx, p_batch );
+			}
+		}
+
+	private:
+		static size_t count_list( free_block* p_head )
+		{
+			size_t ans = 0;
+			for ( ; p_head != nullptr; p_head = p_head->next_ ) {
+				ans++;
+			}
+			return ans;
+		}
+
+		free_block* head_[number_of_classes];
+		size_t      count_[number_of_classes];
+	};
+
+	static central_free_list& central( void )
+	{
+		// 静的記憶域期間のdeferred_applyの破棄に備えて、意図的に破棄しない
+		static central_free_list* p_central = new central_free_list();
+		return *p_central;
+	}
+
+	// スレッドの終了処理でthread_cacheを破棄した後も参照できるように、トリビアルな型で保持する
+	static bool& is_destructed( void )
+	{
+		static thread_local bool destructed = false;
+		return destructed;
+	}
+
+	/**
+	 * @return 呼び出したスレッドのフリーリスト。スレッドの終了処理で破棄済みの場合はnullptr
+	 */
+	static thread_cache* local_cache( void )
+	{
+		if ( is_destructed() ) return nullptr;
+
+		static thread_local thread_cache cache;
+		return &cache;
+	}
+
+	/**
+	 * @brief システムのアロケータからチャンクを確保し、class_idxのブロックに分割する
+	 *
+	 * 分割したブロックは、batch_size個毎のバッチとし、先頭のバッチ以外は共有のフリーリストに追加する。
+	 *
+	 * @return 先頭のバッチの先頭ブロック
+	 */
+	static free_block* carve_chunk( size_t class_idx )
+	{
+		char*  p_chunk       = static_cast<char*>( ::operator new( chunk_size ) );
+		size_t block_size    = block_size_of( class_idx );
+		size_t num_of_blocks = chunk_size / block_size;
+		central().num_of_chunks_.fetch_add( 1, std::memory_order_relaxed );
+
+		free_block* p_first_batch = nullptr;
+		for ( size_t batch_top = 0; batch_top < num_of_blocks; batch_top += batch_size ) {
+			size_t batch_end = ( batch_top + batch_size < num_of_blocks ) ? batch_top + batch_size : num_of_blocks;
+			for ( size_t i = batch_top; i < batch_end; i++ ) {
+				free_block* p_block = reinterpret_cast<free_block*>( p_chunk + i * block_size );
+				p_block->next_      = ( i + 1 < batch_end ) ? reinterpret_cast<free_block*>( p_chunk + ( i + 1 ) * block_size ) : nullptr;
+			}
+
+			free_block* p_batch = reinterpret_cast<free_block*>( p_chunk + batch_top * block_size );
+			if ( p_first_batch == nullptr ) {
+				p_first_batch = p_batch;
+			} else {
+				central().push_batch( class_idx, p_batch );
+			}
+		}
+		return p_first_batch;
+	}
+};
+
+#endif
@@ -0,0 +1,241 @@
+/**
+ * @file deferred_strand.hpp
+ * @author PFA03027@nifty.com
+ * @brief strand that runs deferred_apply<void> tasks one at a time in order on top of an executor, without a mutex per post
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023, PFA03027@nifty.com
+ *
+ */
+
+#ifndef DEFERRED_STRAND_HPP_
+#define DEFERRED_STRAND_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+#include "deferred_apply.hpp"
+#include "deferred_apply_all.hpp"
+
+/**
+ * @brief Strand that runs deferred_apply<void> tasks one at a time in order on top of an executor, without a mutex per post
+ *
+ * Example of use:
+ * @code {.cpp}
+ * deferred_strand<> session_strand;   // one strand per session
+ * session_strand.post( on_receive, &session, std::move( packet ) );
+ * session_strand.post( on_timeout, &session );   // never runs concurrently with on_receive()
+ * @endcode
+ *
+ * Tasks posted to the same strand run one at a time in the order of post(), and different strands run in parallel on the workers of the executor.
+ * Therefore, the state touched only by the tasks of a strand needs no lock.
+ *
+ * The tasks are linked to a lock-free multi-producer single-consumer queue, and an atomic counter of pending tasks is the state word of the strand.
+ * Only the post() that increments the counter from 0 posts a drainer to the executor, so post() takes no mutex.
+ * The drainer runs up to max_batch tasks, then posts itself again if tasks remain, so that a busy strand does not occupy a worker.
+ *
+ * deferred_strand has post( deferred_apply<void>&& ), so a strand can be used as an executor of other components.
+ *
+ * @brief エグゼキュータ上で、deferred_apply<void>のタスクを1つずつ投入順に実行するストランド。投入毎にmutexを使用しない
+ *
+ * 同じストランドに投入したタスクは投入順に1つずつ実行され、異なるストランドはエグゼキュータのワーカースレッドで並行に実行される。
+ * そのため、1つのストランドのタスクだけが参照する状態には、ロックが不要となる。
+ *
+ * タスクはロックフリーのmulti-producer single-consumerキューに連結し、実行待ちタスク数のアトミックなカウンタをストランドの状態とする。
+ * カウンタを0から増やしたpost()だけが、タスクを実行するドレイナーをエグゼキュータに投入するため、post()はmutexを取得しない。
+ * ドレイナーは最大でmax_batch個のタスクを実行し、タスクが残っていれば自身を再投入する。そのため、処理の多いストランドがワーカースレッドを占有しない。
+ *
+ * post( deferred_apply<void>&& )を持つため、ストランドを他のコンポーネントのエグゼキュータとして使用できる。
+ *
+ * @warning
+ * 引数はdeferred_apply<void>と同じ方式で保持されるため、左辺値の引数は左辺値参照として保持される。 @n
+ * タスクは例外を送出してはならない。
+ *
+ * @tparam Executor post( deferred_apply<void>&& )でタスクを投入できるエグゼキュータの型
+ */
+template <typename Executor = deferred_priority_executor<1>>
+class deferred_strand {
+public:
+	/**
+	 * @brief apply_all()と共有する、組み込みのスレッドプールを使用するストランドを構築する
+	 */
+	deferred_strand( void )
+	  : deferred_strand( default_apply_all_executor() )
+	{
+	}
+
+	explicit deferred_strand( Executor& ex, size_t max_batch = 64 )
+	  : sp_state_( std::make_shared<shared_state>( ex, max_batch ) )
+	{
+	}
+
+	deferred_strand( const deferred_strand& )            = delete;
+	deferred_strand& operator=( const deferred_strand& ) = delete;
+
+	/**
+	 * @brief f(args...)を実行するタスクを投入する
+	 *
+	 * fの戻り値の型はvoidであること。
+	 */
+	template <typename F,
+	          typename... Args,
+	          typename std::enable_if<!std::is_same<typename std::decay<F>::type, deferred_apply<void>>::value>::type* = nullptr>
+	void post( F&& f, Args&&... args )
+	{
+		post( deferred_apply<void>( std::forward<F>( f ), std::forward<Args>( args )... ) );
+	}
+
+	/**
+	 * @brief taskを投入する
+	 *
+	 * ストランドを破棄しても、投入済みのタスクはすべて実行される。
+	 */
+	void post( deferred_apply<void>&& task )
+	{
+		shared_state::post( sp_state_, std::move( task ) );
+	}
+
+	/**
+	 * @brief 呼び出したスレッドで、本ストランドのタスクを実行中かどうか
+	 */
+	bool running_in_this_thread( void ) const
+	{
+		return shared_state::current() == sp_state_.get();
+	}
+
+private:
+	/**
+	 * @brief ストランドと、エグゼキュータに投入したドレイナーが共有する状態
+	 */
+	class shared_state {
+	public:
+		shared_state( Executor& ex, size_t max_batch )
+		  : ex_( ex )
+		  , max_batch_( ( max_batch == 0 ) ? 1 : max_batch )
+		  , num_of_pending_( 0 )
+		  , p_tail_( new node() )
+		  , head_( p_tail_ )
+		{
+		}
+
+		~shared_state()
+		{
+			node* p_cur = p_tail_;
+			while ( p_cur != nullptr ) {
+				node* p_next = p_cur->next_.load( std::memory_order_relaxed );
+				delete p_cur;
+				p_cur = p_next;
+			}
+		}
+
+		static void post( const std::shared_ptr<shared_state>& sp_state, deferred_apply<void>&& task )
+		{
+			sp_state->push( new node( std::move( task ) ) );
+			if ( sp_state->num_of_pending_.fetch_add( 1, std::memory_order_acq_rel ) == 0 ) {
+				// 実行中のドレイナーがないため、新たに投入する
+				schedule( sp_state );
+			}
+		}
+
+		/**
+		 * @brief 呼び出したスレッドで実行中のストランドの状態
+		 */
+		static const shared_state*& current( void )
+		{
+			static thread_local const shared_state* p_current = nullptr;
+			return p_current;
+		}
+
+	private:
+		struct node {
+			node( void )
+			  : next_( nullptr )
+			  , task_()
+			{
+			}
+			explicit node( deferred_apply<void>&& task )
+			  : next_( nullptr )
+			  , task_( std::move( task ) )
+			{
+			}
+
+			std::atomic<node*>   next_;
+			deferred_apply<void> task_;
+		};
+
+		static void schedule( const std::shared_ptr<shared_state>& sp_state )
+		{
+			std::shared_ptr<shared_state> sp_captured = sp_state;
+			sp_state->ex_.post( deferred_apply<void>( [sp_captured]() {
+				drain( sp_captured );
+			} ) );
+		}
+
+		/**
+		 * @brief 実行待ちのタスクを、投入順に最大max_batch_個実行する
+		 */
+		static void drain( const std::shared_ptr<shared_state>& sp_state )
+		{
+			const shared_state*& p_current = current();
+			const shared_state*  p_prev    = p_current;
+			p_current                      = sp_state.get();
+
+			for ( size_t i = 0; i < sp_state->max_batch_; i++ ) {
+				deferred_apply<void> task = sp_state->pop();
+				task.apply();
+				task.reset();
+
+				if ( sp_state->num_of_pending_.fetch_sub( 1, std::memory_order_acq_rel ) == 1 ) {
+					// 実行待ちのタスクがなくなった。次のpost()がドレイナーを投入する
+					p_current = p_prev;
+					return;
+				}
+			}
+			p_current = p_prev;
+
+			// 他のストランドのタスクも実行できるように、ワーカースレッドを明け渡す
+			schedule( sp_state );
+		}
+
+		void push( node* p_node )
+		{
+			node* p_prev = head_.exchange( p_node, std::memory_order_acq_rel );
+			p_prev->next_.store( p_node, std::memory_order_release );
+		}
+
+		/**
+		 * @brief 先頭のタスクを取り出す。num_of_pending_で、タスクが存在することを確認してから呼び出すこと
+		 *
+		 * 取り出したノードは、次のダミーノードとなる。
+		 */
+		deferred_apply<void> pop( void )
+		{
+			node* p_next = p_tail_->next_.load( std::memory_order_acquire );
+			while ( p_next == nullptr ) {
+				// push()がheadを更新してから、nextを連結するまでの間は待つ
+				std::this_thread::yield();
+				p_next = p_tail_->next_.load( std::memory_order_acquire );
+			}
+
+			deferred_apply<void> ans( std::move( p_next->task_ ) );
+			delete p_tail_;
+			p_tail_ = p_next;
+			return ans;
+		}
+
+		Executor&           ex_;
+		const size_t        max_batch_;
+		std::atomic<size_t> num_of_pending_;   //!< 実行待ちと実行中のタスク数。0から増やしたpost()がドレイナーを投入する
+		node*               p_tail_;           //!< 先頭のダミーノード。ドレイナーだけが参照する
+		std::atomic<node*>  head_;             //!< 最後に連結したノード。post()するスレッドが更新する
+	};
+
+	std::shared_ptr<shared_state> sp_state_;
+};
+
+#endif
@@ -0,0 +1,422 @@
+/**
+ * @file deferred_task_graph.hpp
+ * @author PFA03027@nifty.com
+ * @brief reusable dependency graph of deferred_apply<void> tasks that runs each task as soon as its predecessors finish
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023, PFA03027@nifty.com
+ *
+ */
+
+#ifndef DEFERRED_TASK_GRAPH_HPP_
+#define DEFERRED_TASK_GRAPH_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "deferred_apply.hpp"
+#include "deferred_apply_all.hpp"
+
+/**
+ * @brief Reusable dependency graph of deferred_apply<void> tasks that runs each task as soon as its predecessors finish
+ *
+ * Example of use:
+ * @code {.cpp}
+ * deferred_task_graph g;
+ * size_t load   = g.add_node( load_input, path );
+ * size_t stat_a = g.add_node( compute_a, &data );
+ * size_t stat_b = g.add_node( compute_b, &data );
+ * size_t report = g.add_node( write_report, &data );
+ * g.add_edge( load, stat_a );
+ * g.add_edge( load, stat_b );
+ * g.add_edge( stat_a, report );
+ * g.add_edge( stat_b, report );
+ * g.run();   // stat_a and stat_b run in parallel. g.run() can be called again without rebuilding
+ * @endcode
+ *
+ * Each node has an atomic counter of unfinished predecessors, which is reset to the in-degree at the start of run().
+ * When a node finishes, it decrements the counters of its successors, and the successors whose counter becomes 0 are ready.
+ * The first ready successor is executed on the same thread as a continuation, and the others are posted to the executor.
+ * Therefore, a chain of nodes on the critical path runs without going through the queue of the executor.
+ *
+ * The tasks are held in the repeatable apply mode of deferred_apply, so the rvalue arguments are copied at each run().
+ * Therefore, the arguments should be copyable, and add_node( f, args... ) rejects non-copyable ones at compile time.
+ * While waiting, the thread that calls run() also executes the posted nodes, so run() can be called from a worker thread of the executor.
+ *
+ * If a task throws an exception, the tasks that are not started yet are skipped, and run() rethrows the first exception.
+ *
+ * @brief 先行するタスクがすべて完了したタスクから実行する、再利用可能なdeferred_apply<void>のタスクの依存関係グラフ
+ *
+ * 各ノードは、未完了の先行ノード数のアトミックなカウンタを持ち、run()の開始時に入次数に初期化される。
+ * ノードの完了時に後続ノードのカウンタを減らし、0になった後続ノードが実行可能となる。
+ * 実行可能となった最初の後続ノードは継続として同じスレッドで実行し、それ以外はエグゼキュータに投入する。
+ * そのため、クリティカルパス上のノードの連鎖は、エグゼキュータのキューを経由せずに実行される。
+ *
+ * タスクはdeferred_applyの繰り返し適用可能なモードで保持されるため、右辺値の引数はrun()毎にコピーされる。
+ * そのため、引数はコピー可能であること。add_node( f, args... )は、コピーできない引数をコンパイル時に拒否する。
+ * run()を呼び出したスレッドも、完了を待つ間に投入済みのノードを実行するため、エグゼキュータのワーカースレッドからrun()を呼び出してもよい。
+ *
+ * タスクが例外を送出した場合、まだ開始していないタスクは実行せずに完了扱いとし、run()は最初の例外を再送出する。
+ *
+ * @warning
+ * 引数はdeferred_apply<void>と同じ方式で保持されるため、左辺値の引数は左辺値参照として保持される。
+ * run()の実行中に、ノードや依存関係を追加してはならない。
+ */
+class deferred_task_graph {
+public:
+	/**
+	 * @brief 存在しないノードを指定した場合の例外
+	 */
+	class bad_node_id : public std::out_of_range {
+	public:
+		bad_node_id( void )
+		  : std::out_of_range( "node id of deferred_task_graph is out of range" )
+		{
+		}
+	};
+
+	/**
+	 * @brief 依存関係が循環している場合の例外
+	 */
+	class cyclic_dependency : public std::logic_error {
+	public:
+		cyclic_dependency( void )
+		  : std::logic_error( "deferred_task_graph has a cyclic dependency" )
+		{
+		}
+	};
+
+	deferred_task_graph( void )
+	  : nodes_()
+	  , is_acyclic_checked_( true )
+	{
+	}
+
+	deferred_task_graph( const deferred_task_graph& )            = delete;
+	deferred_task_graph& operator=( const deferred_task_graph& ) = delete;
+
+	/**
+	 * @brief f(args...)を実行するノードを追加する
+	 *
+	 * fの戻り値の型はvoidであること。
+	 *
+	 * @return 追加したノードのID
+	 */
+	template <typename F,
+	          typename... Args,
+	          typename std::enable_if<!std::is_same<typename std::decay<F>::type, deferred_apply<void>>::value>::type* = nullptr>
+	size_t add_node( F&& f, Args&&... args )
+	{
+		using cur_container_t = deferred_apply_internal::deferred_apply_container<void(), F, Args&&...>;
+		static_assert( cur_container_t::copy_constructible, "function and arguments should be copy constructible to be run repeatedly" );
+
+		return add_node( deferred_apply<void>( std::forward<F>( f ), std::forward<Args>( args )... ) );
+	}
+
+	/**
+	 * @brief taskを実行するノードを追加する
+	 *
+	 * taskが保持する関数と引数がコピーできない場合、run()でそのノードは bad_copy_consturct 例外を送出する。
+	 *
+	 * @return 追加したノードのID
+	 */
+	size_t add_node( deferred_apply<void>&& task )
+	{
+		// std::dequeは末尾への追加で既存要素を移動しないため、アトミック変数を持つノードを保持できる
+		nodes_.emplace_back( std::move( task ) );
+		nodes_.back().task_.enable_repeatable_apply();
+		return nodes_.size() - 1;
+	}
+
+	/**
+	 * @brief ノードbeforeの完了後に、ノードafterを実行するように依存関係を追加する
+	 *
+	 * 存在しないノードを指定した場合は、bad_node_id 例外を送出する。
+	 */
+	void add_edge( size_t before, size_t after )
+	{
+		if ( ( before >= nodes_.size() ) || ( after >= nodes_.size() ) ) {
+			deferred_apply_internal::raise_error<bad_node_id>();
+		}
+
+		nodes_[before].successors_.push_back( after );
+		nodes_[after].in_degree_++;
+		is_acyclic_checked_ = false;
+	}
+
+	/**
+	 * @brief 組み込みのスレッドプールで、すべてのノードを依存関係の順に実行し、完了を待つ
+	 */
+	void run( void )
+	{
+		run( default_apply_all_executor() );
+	}
+
+	/**
+	 * @brief エグゼキュータexで、すべてのノードを依存関係の順に実行し、完了を待つ
+	 *
+	 * 依存関係が循環している場合は、いずれのノードも実行せずに cyclic_dependency 例外を送出する。
+	 * タスクが例外を送出した場合は、すべてのノードの完了後に、最初に送出された例外を再送出する。
+	 *
+	 * @param ex post( deferred_apply<void>&& )でタスクを投入できるエグゼキュータ
+	 */
+	template <typename Executor>
+	void run( Executor& ex )
+	{
+		if ( nodes_.empty() ) return;
+		if ( !is_acyclic_checked_ ) {
+			if ( !is_acyclic() ) {
+				deferred_apply_internal::raise_error<cyclic_dependency>();
+			}
+			is_acyclic_checked_ = true;
+		}
+
+		std::vector<size_t> roots;
+		for ( size_t i = 0; i < nodes_.size(); i++ ) {
+			nodes_[i].num_of_pending_.store( nodes_[i].in_degree_, std::memory_order_relaxed );
+			if ( nodes_[i].in_degree_ == 0 ) {
+				roots.push_back( i );
+			}
+		}
+
+		std::shared_ptr<run_state<Executor>> sp_state = std::make_shared<run_state<Executor>>( nodes_, ex );
+
+		// 最初のルートノードは、呼び出したスレッドで実行する
+		for ( size_t i = 1; i < roots.size(); i++ ) {
+			sp_state->post_ready( roots[i] );
+		}
+		sp_state->execute_from( roots[0] );
+
+		// エグゼキュータのワーカースレッドから呼び出された場合でもデッドロックしないように、投入済みのノードも呼び出したスレッドで実行する
+		sp_state->run_and_wait();
+#if DEFERRED_APPLY_HAS_EXCEPTIONS
+		std::exception_ptr p_exception = sp_state->take_exception();
+		if ( p_exception ) {
+			std::rethrow_exception( p_exception );
+		}
+#endif
+	}
+
+	size_t size( void ) const
+	{
+		return nodes_.size();
+	}
+
+private:
+	struct node {
+		explicit node( deferred_apply<void>&& task )
+		  : task_( std::move( task ) )
+		  , successors_()
+		  , in_degree_( 0 )
+		  , num_of_pending_( 0 )
+		{
+		}
+
+		deferred_apply<void> task_;
+		std::vector<size_t>  successors_;
+		size_t               in_degree_;        //!< 先行ノード数
+		std::atomic<size_t>  num_of_pending_;   //!< 今回のrun()で、未完了の先行ノード数
+	};
+
+	/**
+	 * @brief 1回のrun()で、呼び出したスレッドとエグゼキュータに投入したトランポリンが共有する状態
+	 *
+	 * 実行可能となったノードは実行待ちのキューに入れ、トランポリンと呼び出したスレッドのうち、先に取り出した方が実行する。
+	 * run()が戻った後にトランポリンが実行されても参照できるように、std::shared_ptrで共有する。
+	 * ノードとエグゼキュータは、ノードを取り出して実行している間だけ参照する。
+	 */
+	template <typename Executor>
+	class run_state : public std::enable_shared_from_this<run_state<Executor>> {
+	public:
+		run_state( std::deque<node>& nodes, Executor& ex )
+		  : nodes_( nodes )
+		  , ex_( ex )
+		  , mtx_()
+		  , cv_()
+		  , ready_()
+		  , num_of_remaining_( nodes.size() )
+		  , is_waiting_( false )
+		  , is_failed_( false )
+#if DEFERRED_APPLY_HAS_EXCEPTIONS
+		  , p_exception_()
+#endif
+		{
+		}
+
+		/**
+		 * @brief ノードidxを実行待ちのキューに入れ、それを実行するトランポリンをエグゼキュータに投入する
+		 */
+		void post_ready( size_t idx )
+		{
+			{
+				std::lock_guard<std::mutex> lk( mtx_ );
+				ready_.push_back( idx );
+				if ( is_waiting_ ) {
+					cv_.notify_one();
+				}
+			}
+
+			std::shared_ptr<run_state> sp_state = this->shared_from_this();
+			ex_.post( deferred_apply<void>( [sp_state]() {
+				sp_state->try_run_one();
+			} ) );
+		}
+
+		/**
+		 * @brief ノードidxを実行し、実行可能となった後続ノードを継続して実行する
+		 */
+		void execute_from( size_t idx )
+		{
+			while ( true ) {
+				node& cur_node = nodes_[idx];
+				apply_node( cur_node );
+
+				bool   has_next = false;
+				size_t next_idx = 0;
+				for ( size_t succ_idx : cur_node.successors_ ) {
+					if ( nodes_[succ_idx].num_of_pending_.fetch_sub( 1, std::memory_order_acq_rel ) != 1 ) continue;
+
+					if ( !has_next ) {
+						has_next = true;
+						next_idx = succ_idx;
+					} else {
+						post_ready( succ_idx );
+					}
+				}
+
+				// 減らした後は、他のスレッドが最後のノードを完了してrun()が戻り、グラフが破棄されている可能性がある。
+				// そのため、継続するノードがない場合は、以降はノードを参照しない
+				if ( num_of_remaining_.fetch_sub( 1 ) == 1 ) {
+					std::lock_guard<std::mutex> lk( mtx_ );
+					cv_.notify_all();
+					return;
+				}
+				if ( !has_next ) return;
+				idx = next_idx;
+			}
+		}
+
+		/**
+		 * @brief 実行待ちのノードがあれば、1つ取り出して実行する
+		 */
+		void try_run_one( void )
+		{
+			size_t idx;
+			{
+				std::lock_guard<std::mutex> lk( mtx_ );
+				if ( ready_.empty() ) return;   // 呼び出したスレッドが実行済み
+				idx = ready_.front();
+				ready_.pop_front();
+			}
+			execute_from( idx );
+		}
+
+		/**
+		 * @brief 実行待ちのノードを実行しながら、すべてのノードの完了を待つ
+		 */
+		void run_and_wait( void )
+		{
+			std::unique_lock<std::mutex> lk( mtx_ );
+			while ( true ) {
+				if ( !ready_.empty() ) {
+					size_t idx = ready_.front();
+					ready_.pop_front();
+					lk.unlock();
+					execute_from( idx );
+					lk.lock();
+					continue;
+				}
+				if ( num_of_remaining_.load() == 0 ) break;
+
+				is_waiting_ = true;
+				cv_.wait( lk, [this]() {
+					return ( !ready_.empty() ) || ( num_of_remaining_.load() == 0 );
+				} );
+				is_waiting_ = false;
+			}
+		}
+
+#if DEFERRED_APPLY_HAS_EXCEPTIONS
+		std::exception_ptr take_exception( void )
+		{
+			std::lock_guard<std::mutex> lk( mtx_ );
+			return p_exception_;
+		}
+#endif
+
+	private:
+		void apply_node( node& cur_node )
+		{
+			if ( is_failed_.load( std::memory_order_relaxed ) ) return;
+
+#if DEFERRED_APPLY_HAS_EXCEPTIONS
+			try {
+				cur_node.task_.apply();
+			} catch ( ... ) {
+				std::lock_guard<std::mutex> lk( mtx_ );
+				if ( !p_exception_ ) {
+					p_exception_ = std::current_exception();
+				}
+				is_failed_.store( true, std::memory_order_relaxed );
+			}
+#else
+			cur_node.task_.apply();
+#endif
+		}
+
+		std::deque<node>&       nodes_;
+		Executor&               ex_;
+		std::mutex              mtx_;
+		std::condition_variable cv_;
+		std::deque<size_t>      ready_;              //!< 実行可能となり、まだ取り出されていないノードのID
+		std::atomic<size_t>     num_of_remaining_;   //!< 未完了のノード数
+		bool                    is_waiting_;         //!< 呼び出したスレッドが、cv_で待っているかどうか
+		std::atomic<bool>       is_failed_;          //!< タスクが例外を送出したかどうか
+#if DEFERRED_APPLY_HAS_EXCEPTIONS
+		std::exception_ptr p_exception_;   //!< 最初に送出された例外
+#endif
+	};
+
+	/**
+	 * @brief Kahnのアルゴリズムで、依存関係が循環していないかどうかを判定する
+	 */
+	bool is_acyclic( void ) const
+	{
+		std::vector<size_t> in_degrees( nodes_.size() );
+		std::vector<size_t> ready;
+		for ( size_t i = 0; i < nodes_.size(); i++ ) {
+			in_degrees[i] = nodes_[i].in_degree_;
+			if ( in_degrees[i] == 0 ) {
+				ready.push_back( i );
+			}
+		}
+
+		size_t num_of_visited = 0;
+		while ( !ready.empty() ) {
+			size_t idx = ready.back();
+			ready.pop_back();
+			num_of_visited++;
+			for ( size_t succ_idx : nodes_[idx].successors_ ) {
+				if ( --in_degrees[succ_idx] == 0 ) {
+					ready.push_back( succ_idx );
+				}
+			}
+		}
+		return num_of_visited == nodes_.size();
+	}
+
+	std::deque<node> nodes_;
+	bool             is_acyclic_checked_;   //!< 最後に依存関係を追加してから、循環していないことを確認済みかどうか
+};
+
+#endif
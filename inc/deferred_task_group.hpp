@@ -0,0 +1,267 @@
+/**
+ * @file deferred_task_group.hpp
+ * @author PFA03027@nifty.com
+ * @brief fork-join group of deferred calls whose waiter helps to execute the pending tasks
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023, PFA03027@nifty.com
+ *
+ */
+
+#ifndef DEFERRED_TASK_GROUP_HPP_
+#define DEFERRED_TASK_GROUP_HPP_
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "deferred_apply.hpp"
+#include "deferred_apply_all.hpp"
+
+/**
+ * @brief Fork-join group of deferred calls whose waiter helps to execute the pending tasks
+ *
+ * Example of use:
+ * @code {.cpp}
+ * deferred_task_group<> tg;
+ * for ( auto& key : keys ) {
+ *     tg.run( lookup, key, &results[i++] );
+ * }
+ * tg.wait();   // executes pending lookups on this thread too, and rethrows the first exception
+ * @endcode
+ *
+ * Each task is constructed directly in a deferred_apply<void> of the group, so run() does not allocate a shared state per task as std::future does.
+ * run() posts a small trampoline to the executor, and the trampoline executes one of the pending tasks of the group.
+ * wait() executes the pending tasks on the calling thread until no task is left, then waits for the tasks that are executed by the workers.
+ * Therefore, wait() completes even if all the workers of the executor are busy.
+ *
+ * If tasks throw exceptions, wait() rethrows the first one. The group can be reused after wait().
+ *
+ * @brief 待機するスレッドも実行待ちのタスクを実行する、延期された関数呼び出しのfork-joinグループ
+ *
+ * 各タスクは、グループ内のdeferred_apply<void>に直接構築されるため、std::futureのようにタスク毎の共有状態を確保しない。
+ * run()は、小さなトランポリンをエグゼキュータに投入し、トランポリンはグループの実行待ちタスクを1つ実行する。
+ * wait()は、実行待ちタスクがなくなるまで呼び出したスレッドで実行し、その後、ワーカースレッドで実行中のタスクの完了を待つ。
+ * そのため、エグゼキュータのワーカースレッドがすべて他の処理を実行中でも、wait()は完了する。
+ *
+ * タスクが例外を送出した場合、wait()は最初の例外を再送出する。wait()の後は、グループを再利用できる。
+ *
+ * @warning
+ * 引数はdeferred_apply<void>と同じ方式で保持されるため、左辺値の引数は左辺値参照として保持される。
+ * wait()から戻るまでは生存しているため、呼び出し元の変数を参照で渡してよい。
+ *
+ * @tparam Executor post( deferred_apply<void>&& )でタスクを投入できるエグゼキュータの型
+ */
+template <typename Executor = deferred_priority_executor<1>>
+class deferred_task_group {
+public:
+	/**
+	 * @brief apply_all()と共有する、組み込みのスレッドプールを使用するグループを構築する
+	 */
+	deferred_task_group( void )
+	  : deferred_task_group( default_apply_all_executor() )
+	{
+	}
+
+	explicit deferred_task_group( Executor& ex )
+	  : ex_( ex )
+	  , sp_state_( std::make_shared<shared_state>() )
+	{
+	}
+
+	deferred_task_group( const deferred_task_group& )            = delete;
+	deferred_task_group& operator=( const deferred_task_group& ) = delete;
+
+	/**
+	 * @brief 実行待ちのタスクを実行し、完了を待つ。タスクが送出した例外は破棄される。
+	 */
+	~deferred_task_group()
+	{
+		sp_state_->run_and_wait();
+	}
+
+	/**
+	 * @brief f(args...)を実行するタスクを、グループに追加する
+	 *
+	 * fの戻り値の型はvoidであること。
+	 */
+	template <typename F, typename... Args>
+	void run( F&& f, Args&&... args )
+	{
+		sp_state_->push( std::forward<F>( f ), std::forward<Args>( args )... );
+
+		std::shared_ptr<shared_state> sp_state = sp_state_;
+		ex_.post( deferred_apply<void>( [sp_state]() {
+			sp_state->try_run_one();
+		} ) );
+	}
+
+	/**
+	 * @brief グループに追加したすべてのタスクの完了を待つ
+	 *
+	 * 実行待ちのタスクは、呼び出したスレッドで実行する。
+	 * タスクが例外を送出した場合は、すべてのタスクの完了後に、最初に送出された例外を再送出する。
+	 */
+	void wait( void )
+	{
+		sp_state_->run_and_wait();
+#if DEFERRED_APPLY_HAS_EXCEPTIONS
+		std::exception_ptr p_exception = sp_state_->take_exception();
+		if ( p_exception ) {
+			std::rethrow_exception( p_exception );
+		}
+#endif
+	}
+
+private:
+	/**
+	 * @brief グループと、エグゼキュータに投入したトランポリンが共有する状態
+	 *
+	 * グループの破棄後にトランポリンが実行されても参照できるように、std::shared_ptrで共有する。
+	 */
+	class shared_state {
+	public:
+		shared_state( void )
+		  : mtx_()
+		  , cv_()
+		  , tasks_()
+		  , next_( 0 )
+		  , num_of_running_( 0 )
+#if DEFERRED_APPLY_HAS_EXCEPTIONS
+		  , p_exception_()
+#endif
+		{
+		}
+
+		template <typename F, typename... Args>
+		void push( F&& f, Args&&... args )
+		{
+			std::lock_guard<std::mutex> lk( mtx_ );
+			if ( tasks_.size() == tasks_.capacity() ) {
+				grow();
+			}
+			tasks_.emplace_back( std::forward<F>( f ), std::forward<Args>( args )... );
+		}
+
+		/**
+		 * @brief 実行待ちのタスクがあれば、1つ実行する
+		 */
+		void try_run_one( void )
+		{
+			deferred_apply<void> task;
+			{
+				std::lock_guard<std::mutex> lk( mtx_ );
+				if ( !pop( task ) ) return;
+			}
+			execute( task );
+		}
+
+		/**
+		 * @brief 実行待ちのタスクがなくなるまで実行し、他のスレッドで実行中のタスクの完了を待つ
+		 */
+		void run_and_wait( void )
+		{
+			std::unique_lock<std::mutex> lk( mtx_ );
+			while ( true ) {
+				deferred_apply<void> task;
+				if ( pop( task ) ) {
+					lk.unlock();
+					execute( task );
+					lk.lock();
+					continue;
+				}
+				if ( num_of_running_ == 0 ) break;
+
+				cv_.wait( lk, [this]() {
+					return ( next_ < tasks_.size() ) || ( num_of_running_ == 0 );
+				} );
+			}
+
+			// 容量は残したまま、次の利用に備えて空にする
+			tasks_.clear();
+			next_ = 0;
+		}
+
+#if DEFERRED_APPLY_HAS_EXCEPTIONS
+		std::exception_ptr take_exception( void )
+		{
+			std::lock_guard<std::mutex> lk( mtx_ );
+			std::exception_ptr          ans = p_exception_;
+			p_exception_                    = nullptr;
+			return ans;
+		}
+#endif
+
+	private:
+		// 実行中にrun()で追加されてtasks_の再配置が起きても影響を受けないように、取り出してから実行する
+		bool pop( deferred_apply<void>& task )
+		{
+			if ( next_ >= tasks_.size() ) return false;
+
+			task = std::move( tasks_[next_] );
+			next_++;
+			num_of_running_++;
+			return true;
+		}
+
+		/**
+		 * @brief 容量を拡張し、実行待ちのタスクを先頭に詰める
+		 *
+		 * deferred_apply<void>のムーブコンストラクタはnoexceptではないため、std::vectorの再配置に任せると
+		 * コピーとなり、ムーブのみ可能なタスクを保持できない。そのため、確保済みの領域にムーブして再配置する。
+		 */
+		void grow( void )
+		{
+			std::vector<deferred_apply<void>> new_tasks;
+			new_tasks.reserve( ( tasks_.capacity() < 8 ) ? 16 : tasks_.capacity() * 2 );
+			for ( size_t i = next_; i < tasks_.size(); i++ ) {
+				new_tasks.emplace_back( std::move( tasks_[i] ) );
+			}
+			tasks_.swap( new_tasks );
+			next_ = 0;
+		}
+
+		void execute( deferred_apply<void>& task )
+		{
+#if DEFERRED_APPLY_HAS_EXCEPTIONS
+			try {
+				task.apply();
+			} catch ( ... ) {
+				std::lock_guard<std::mutex> lk( mtx_ );
+				if ( !p_exception_ ) {
+					p_exception_ = std::current_exception();
+				}
+			}
+#else
+			task.apply();
+#endif
+			task.reset();
+
+			std::lock_guard<std::mutex> lk( mtx_ );
+			num_of_running_--;
+			if ( num_of_running_ == 0 ) {
+				cv_.notify_all();
+			}
+		}
+
+		std::mutex                        mtx_;
+		std::condition_variable           cv_;
+		std::vector<deferred_apply<void>> tasks_;
+		size_t                            next_;             //!< 次に実行するtasks_のインデックス
+		size_t                            num_of_running_;   //!< 取り出して実行中のタスク数
+#if DEFERRED_APPLY_HAS_EXCEPTIONS
+		std::exception_ptr p_exception_;   //!< 最初に送出された例外
+#endif
+	};
+
+	Executor&                     ex_;
+	std::shared_ptr<shared_state> sp_state_;
+};
+
+#endif
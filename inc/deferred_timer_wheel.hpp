@@ -0,0 +1,452 @@
+/**
+ * @file deferred_timer_wheel.hpp
+ * @author PFA03027@nifty.com
+ * @brief hierarchical timing wheel that executes deferred_apply<void> at the scheduled time
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023, PFA03027@nifty.com
+ *
+ */
+
+#ifndef DEFERRED_TIMER_WHEEL_HPP_
+#define DEFERRED_TIMER_WHEEL_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <type_traits>
+#include <utility>
+
+#include "deferred_apply.hpp"
+
+/**
+ * @brief Hierarchical timing wheel that executes deferred_apply<void> tasks at the scheduled time
+ *
+ * Example of use:
+ * @code {.cpp}
+ * deferred_timer_wheel<> tw( std::chrono::milliseconds( 1 ) );
+ * auto h = tw.schedule_after( std::chrono::milliseconds( 100 ), f, a, b );
+ * // ... tw.cancel( h ); if it is not needed anymore
+ * while ( true ) {
+ *     tw.tick();   // executes f(a,b) after 100ms
+ * }
+ * @endcode
+ *
+ * schedule and cancel are O(1). Tasks are kept inline in the nodes of the wheel slots, so no memory is allocated per task as long as
+ * the function and arguments fit in the inline buffer of deferred_apply<void> and a released node can be reused.
+ *
+ * Time is handled in ticks of the resolution that is given to the constructor.
+ * A task is never executed before the scheduled time, and is executed by the first tick()/run_until() after the scheduled time.
+ *
+ * @warning
+ * This class is not thread-safe. schedule(), cancel(), tick() and run_until() should be called from one thread.
+ * A task may call schedule() or cancel() of the same wheel.
+ *
+ * @brief deferred_apply<void>のタスクを、指定した時刻に実行するための階層型タイミングホイール
+ *
+ * scheduleとcancelはO(1)で処理する。タスクはホイールのスロットのノード内に直接保持されるため、
+ * 関数と引数がdeferred_apply<void>の内部バッファに収まり、解放済みノードを再利用できる限り、タスク毎のメモリ確保は発生しない。
+ *
+ * 時刻は、コンストラクタで指定した分解能のtick単位で扱う。
+ * タスクが指定時刻より前に実行されることはなく、指定時刻以降の最初のtick()/run_until()で実行される。
+ *
+ * @warning
+ * 本クラスはスレッドセーフではない。schedule(), cancel(), tick(), run_until()は、1つのスレッドから呼び出すこと。
+ * なお、タスクの中から同じホイールのschedule()やcancel()を呼び出すことは可能。
+ *
+ * @tparam Clock 時刻を得るためのクロック型。static member function now()を持つこと。テストでは偽のクロックに置き換えることができる。
+ */
+template <typename Clock = std::chrono::steady_clock>
+class deferred_timer_wheel {
+public:
+	using clock_type = Clock;
+	using time_point = typename Clock::time_point;
+	using duration   = typename Clock::duration;
+
+	/**
+	 * @brief スケジュールしたタスクを識別するためのハンドル。cancel()に使用する。
+	 */
+	class timer_handle {
+	public:
+		timer_handle( void )
+		  : idx_( npos )
+		  , generation_( 0 )
+		{
+		}
+
+		bool valid( void ) const
+		{
+			return idx_ != npos;
+		}
+
+	private:
+		timer_handle( size_t idx, uint32_t generation )
+		  : idx_( idx )
+		  , generation_( generation )
+		{
+		}
+
+		size_t   idx_;
+		uint32_t generation_;
+
+		friend class deferred_timer_wheel;
+	};
+
+	explicit deferred_timer_wheel( duration resolution = std::chrono::milliseconds( 1 ) )
+	  : deferred_timer_wheel( resolution, Clock::now() )
+	{
+	}
+
+	deferred_timer_wheel( duration resolution, time_point origin )
+	  : resolution_( resolution )
+	  , origin_( origin )
+	  , current_tick_( 0 )
+	  , num_of_tasks_( 0 )
+	  , nodes_()
+	  , free_head_( npos )
+	{
+		for ( auto& e : heads_ ) {
+			e = npos;
+		}
+	}
+
+	deferred_timer_wheel( const deferred_timer_wheel& )            = delete;
+	deferred_timer_wheel& operator=( const deferred_timer_wheel& ) = delete;
+
+	/**
+	 * @brief 時刻tpにf(args...)を実行するようにスケジュールする
+	 *
+	 * fの戻り値の型はvoidであること。
+	 */
+	template <typename F,
+	          typename... Args,
+	          typename std::enable_if<!std::is_same<typename std::decay<F>::type, deferred_apply<void>>::value>::type* = nullptr>
+	timer_handle schedule_at( time_point tp, F&& f, Args&&... args )
+	{
+		return schedule_at( tp, deferred_apply<void>( std::forward<F>( f ), std::forward<Args>( args )... ) );
+	}
+
+	/**
+	 * @brief 時刻tpにtaskを実行するようにスケジュールする
+	 */
+	timer_handle schedule_at( time_point tp, deferred_apply<void>&& task )
+	{
+		uint64_t expiry = time_to_tick_ceil( tp );
+		if ( expiry <= current_tick_ ) {
+			expiry = current_tick_ + 1;
+		}
+
+		size_t idx          = allocate_node();
+		node&  cur_node     = nodes_[idx];
+		cur_node.task_      = std::move( task );
+		cur_node.expiry_    = expiry;
+		timer_handle handle = timer_handle( idx, cur_node.generation_ );
+
+		insert_node( idx );
+		num_of_tasks_++;
+
+		return handle;
+	}
+
+	/**
+	 * @brief 現在時刻からdだけ経過した時刻にf(args...)を実行するようにスケジュールする
+	 */
+	template <typename F, typename... Args>
+	timer_handle schedule_after( duration d, F&& f, Args&&... args )
+	{
+		return schedule_at( Clock::now() + d, std::forward<F>( f ), std::forward<Args>( args )... );
+	}
+
+	/**
+	 * @brief スケジュールしたタスクを取り消す
+	 *
+	 * @retval true 取り消した
+	 * @retval false 既に実行済み、あるいは取り消し済み
+	 */
+	bool cancel( const timer_handle& handle )
+	{
+		if ( !handle.valid() ) return false;
+		if ( handle.idx_ >= nodes_.size() ) return false;
+		node& cur_node = nodes_[handle.idx_];
+		if ( cur_node.generation_ != handle.generation_ ) return false;
+		if ( cur_node.list_id_ == npos ) return false;
+
+		unlink_node( handle.idx_ );
+		release_node( handle.idx_ );
+		num_of_tasks_--;
+		return true;
+	}
+
+	/**
+	 * @brief Clock::now()までに期限を迎えたタスクを実行する
+	 *
+	 * @return 実行したタスクの数
+	 */
+	size_t tick( void )
+	{
+		return run_until( Clock::now() );
+	}
+
+	/**
+	 * @brief 時刻tpまでに期限を迎えたタスクを実行する
+	 *
+	 * @return 実行したタスクの数
+	 */
+	size_t run_until( time_point tp )
+	{
+		size_t ans = run_expired_list();
+
+		uint64_t target_tick = time_to_tick_floor( tp );
+		while ( current_tick_ < target_tick ) {
+			// 何も起きないtickは、1つずつ処理せずに読み飛ばす
+			uint64_t next_tick = next_event_tick( target_tick );
+			if ( next_tick > target_tick ) {
+				current_tick_ = target_tick;
+				break;
+			}
+
+			current_tick_ = next_tick;
+			cascade();
+
+			size_t& slot_head       = heads_[slot_list_id( 0, current_tick_ )];
+			heads_[expired_list_id] = slot_head;
+			slot_head               = npos;
+			for ( size_t idx = heads_[expired_list_id]; idx != npos; idx = nodes_[idx].next_ ) {
+				nodes_[idx].list_id_ = expired_list_id;
+			}
+			ans += run_expired_list();
+		}
+
+		return ans;
+	}
+
+	size_t size( void ) const
+	{
+		return num_of_tasks_;
+	}
+
+	bool empty( void ) const
+	{
+		return num_of_tasks_ == 0;
+	}
+
+	/**
+	 * @brief 最後に処理したtickに対応する時刻
+	 */
+	time_point now_tick_time( void ) const
+	{
+		return origin_ + resolution_ * static_cast<typename duration::rep>( current_tick_ );
+	}
+
+private:
+	static constexpr size_t npos             = static_cast<size_t>( -1 );
+	static constexpr size_t slot_bits        = 8;
+	static constexpr size_t slots_per_level  = static_cast<size_t>( 1 ) << slot_bits;
+	static constexpr size_t slot_mask        = slots_per_level - 1;
+	static constexpr size_t levels           = 4;
+	static constexpr size_t overflow_list_id = levels * slots_per_level;   // 最上位の階層でも表現できない遠い将来のタスクのリスト
+	static constexpr size_t expired_list_id  = overflow_list_id + 1;       // 期限を迎え、実行待ちとなっているタスクのリスト
+	static constexpr size_t num_of_lists     = expired_list_id + 1;
+
+	struct node {
+		node( void )
+		  : task_()
+		  , expiry_( 0 )
+		  , prev_( npos )
+		  , next_( npos )
+		  , list_id_( npos )
+		  , generation_( 0 )
+		{
+		}
+
+		deferred_apply<void> task_;
+		uint64_t             expiry_;
+		size_t               prev_;
+		size_t               next_;
+		size_t               list_id_;   // 所属するリストのID。未使用ノードはnpos
+		uint32_t             generation_;
+	};
+
+	static size_t slot_list_id( size_t level, uint64_t tick )
+	{
+		return level * slots_per_level + static_cast<size_t>( ( tick >> ( level * slot_bits ) ) & slot_mask );
+	}
+
+	uint64_t time_to_tick_floor( time_point tp ) const
+	{
+		if ( tp <= origin_ ) return 0;
+		return static_cast<uint64_t>( ( tp - origin_ ) / resolution_ );
+	}
+
+	uint64_t time_to_tick_ceil( time_point tp ) const
+	{
+		if ( tp <= origin_ ) return 0;
+		uint64_t ans = time_to_tick_floor( tp );
+		if ( origin_ + resolution_ * static_cast<typename duration::rep>( ans ) < tp ) ans++;
+		return ans;
+	}
+
+	size_t allocate_node( void )
+	{
+		if ( free_head_ == npos ) {
+			// std::dequeは末尾への追加で既存要素を移動しないため、deferred_apply<void>のムーブやコピーが発生しない
+			nodes_.emplace_back();
+			return nodes_.size() - 1;
+		}
+
+		size_t idx = free_head_;
+		free_head_ = nodes_[idx].next_;
+		return idx;
+	}
+
+	void release_node( size_t idx )
+	{
+		node& cur_node = nodes_[idx];
+		cur_node.task_ = deferred_apply<void>();
+		cur_node.generation_++;
+		cur_node.list_id_ = npos;
+		cur_node.prev_    = npos;
+		cur_node.next_    = free_head_;
+		free_head_        = idx;
+	}
+
+	void link_node( size_t list_id, size_t idx )
+	{
+		node& cur_node    = nodes_[idx];
+		cur_node.list_id_ = list_id;
+		cur_node.prev_    = npos;
+		cur_node.next_    = heads_[list_id];
+		if ( heads_[list_id] != npos ) {
+			nodes_[heads_[list_id]].prev_ = idx;
+		}
+		heads_[list_id] = idx;
+	}
+
+	void unlink_node( size_t idx )
+	{
+		node& cur_node = nodes_[idx];
+		if ( cur_node.prev_ != npos ) {
+			nodes_[cur_node.prev_].next_ = cur_node.next_;
+		} else {
+			heads_[cur_node.list_id_] = cur_node.next_;
+		}
+		if ( cur_node.next_ != npos ) {
+			nodes_[cur_node.next_].prev_ = cur_node.prev_;
+		}
+		cur_node.prev_    = npos;
+		cur_node.next_    = npos;
+		cur_node.list_id_ = npos;
+	}
+
+	/**
+	 * @brief 期限までの残りtick数に応じて、ノードを適切な階層のスロットに登録する
+	 */
+	void insert_node( size_t idx )
+	{
+		uint64_t delta = nodes_[idx].expiry_ - current_tick_;
+		for ( size_t level = 0; level < levels; level++ ) {
+			if ( delta < ( static_cast<uint64_t>( 1 ) << ( ( level + 1 ) * slot_bits ) ) ) {
+				link_node( slot_list_id( level, nodes_[idx].expiry_ ), idx );
+				return;
+			}
+		}
+		link_node( overflow_list_id, idx );
+	}
+
+	/**
+	 * @brief current_tick_が上位階層のスロットの境界に達した場合、そのスロットのノードを下位階層に再配置する
+	 */
+	void cascade( void )
+	{
+		for ( size_t level = 1; level <= levels; level++ ) {
+			if ( ( current_tick_ & ( ( static_cast<uint64_t>( 1 ) << ( level * slot_bits ) ) - 1 ) ) != 0 ) break;
+
+			size_t list_id  = ( level < levels ) ? slot_list_id( level, current_tick_ ) : overflow_list_id;
+			size_t idx      = heads_[list_id];
+			heads_[list_id] = npos;
+			while ( idx != npos ) {
+				size_t next_idx = nodes_[idx].next_;
+				insert_node( idx );
+				idx = next_idx;
+			}
+		}
+	}
+
+	/**
+	 * @brief current_tick_の次に、スロットの実行あるいは再配置が発生するtickを求める
+	 *
+	 * 各階層のスロットは、その階層の単位時間の境界でのみ処理されるため、空のスロットに対応するtickは読み飛ばしてよい。
+	 * 階層levelのノードは、current_tick_から、その階層の単位時間でスロット数分先までの境界で処理される。
+	 * この範囲は上位階層の境界をまたぐことがあるため、各階層の範囲全体を探索し、最も早いtickを求める。
+	 *
+	 * @param limit_tick 探索を打ち切るtick。limit_tickより後に発生する場合は、limit_tickより大きな値を返す。
+	 */
+	uint64_t next_event_tick( uint64_t limit_tick ) const
+	{
+		if ( num_of_tasks_ == 0 ) return limit_tick + 1;
+
+		// 最上位の階層の境界では、遠い将来のタスクを再配置する
+		uint64_t ans = ( ( current_tick_ >> ( levels * slot_bits ) ) + 1 ) << ( levels * slot_bits );
+
+		for ( size_t level = 0; level < levels; level++ ) {
+			const size_t   shift = level * slot_bits;
+			const uint64_t unit  = static_cast<uint64_t>( 1 ) << shift;
+			uint64_t       t     = ( ( current_tick_ >> shift ) + 1 ) << shift;
+			for ( size_t i = 0; i < slots_per_level; i++, t += unit ) {
+				if ( t >= ans ) break;
+				if ( ( t > limit_tick ) || ( heads_[slot_list_id( level, t )] != npos ) ) {
+					ans = t;
+					break;
+				}
+			}
+		}
+
+		return ans;
+	}
+
+	size_t run_expired_list( void )
+	{
+		size_t ans = 0;
+		while ( heads_[expired_list_id] != npos ) {
+			size_t idx = heads_[expired_list_id];
+			unlink_node( idx );
+			deferred_apply<void> task = std::move( nodes_[idx].task_ );
+			release_node( idx );
+			num_of_tasks_--;
+
+			// タスクの中からschedule()やcancel()が呼び出されても良いように、ノードを解放してから実行する
+			task.apply();
+			ans++;
+		}
+		return ans;
+	}
+
+	duration         resolution_;
+	time_point       origin_;
+	uint64_t         current_tick_;   //!< 処理済みの最後のtick
+	size_t           num_of_tasks_;
+	std::deque<node> nodes_;
+	size_t           free_head_;
+	size_t           heads_[num_of_lists];
+};
+
+template <typename Clock>
+constexpr size_t deferred_timer_wheel<Clock>::npos;
+template <typename Clock>
+constexpr size_t deferred_timer_wheel<Clock>::slot_bits;
+template <typename Clock>
+constexpr size_t deferred_timer_wheel<Clock>::slots_per_level;
+template <typename Clock>
+constexpr size_t deferred_timer_wheel<Clock>::slot_mask;
+template <typename Clock>
+constexpr size_t deferred_timer_wheel<Clock>::levels;
+template <typename Clock>
+constexpr size_t deferred_timer_wheel<Clock>::overflow_list_id;
+template <typename Clock>
+constexpr size_t deferred_timer_wheel<Clock>::expired_list_id;
+template <typename Clock>
+constexpr size_t deferred_timer_wheel<Clock>::num_of_lists;
+
+#endif
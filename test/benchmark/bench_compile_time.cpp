@@ -0,0 +1,158 @@
+/**
+ * @file bench_compile_time.cpp
+ * @author PFA03027@nifty.com
+ * @brief N個の引数を持つdeferred_applyを使う翻訳単位をコンパイルし、コンパイル時間とピークメモリ使用量を計測するベンチマーク
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ * Usage:
+ * @code
+ * bench_compile_time <c++ compiler> <include dir> [number of arguments...]
+ * @endcode
+ */
+
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief 引数の数がnum_of_argsのmake_deferred_apply()を、生成、コピー、適用するソースコードを生成する
+ *
+ * 引数は、右辺値、左辺値、文字列リテラルを混在させる。
+ */
+std::string generate_source( int num_of_args )
+{
+	std::string src;
+	src += "#include <string>\n";
+	src += "#include \"deferred_apply.hpp\"\n";
+	src += "struct sink {\n";
+	src += "\ttemplate <typename... Ts>\n";
+	src += "\tvoid operator()( Ts&&... ) const\n";
+	src += "\t{\n";
+	src += "\t}\n";
+	src += "};\n";
+	src += "int main( void )\n";
+	src += "{\n";
+	src += "\tint lv = 0;\n";
+	src += "\tauto da = make_deferred_apply( sink()";
+	for ( int i = 0; i < num_of_args; i++ ) {
+		switch ( i % 4 ) {
+			case 0:
+				src += ", " + std::to_string( i );
+				break;
+			case 1:
+				src += ", lv";
+				break;
+			case 2:
+				src += ", std::string( \"a\" )";
+				break;
+			default:
+				src += ", \"literal\"";
+				break;
+		}
+	}
+	src += " );\n";
+	src += "\tauto da2 = da;\n";
+	src += "\tda2.apply();\n";
+	src += "\treturn 0;\n";
+	src += "}\n";
+	return src;
+}
+
+struct compile_result {
+	bool   success_;
+	double elapsed_sec_;
+	long   max_rss_kb_;
+};
+
+/**
+ * @brief コンパイラを子プロセスとして実行し、経過時間と子プロセスのピークメモリ使用量を取得する
+ */
+compile_result run_compiler( const std::vector<std::string>& args )
+{
+	compile_result ans { false, 0.0, 0 };
+
+	std::vector<char*> argv;
+	for ( auto& e : args ) {
+		argv.push_back( const_cast<char*>( e.c_str() ) );
+	}
+	argv.push_back( nullptr );
+
+	auto  start = std::chrono::steady_clock::now();
+	pid_t pid   = fork();
+	if ( pid < 0 ) {
+		perror( "fork" );
+		return ans;
+	}
+	if ( pid == 0 ) {
+		execvp( argv[0], argv.data() );
+		perror( "execvp" );
+		_exit( 127 );
+	}
+
+	int           status = 0;
+	struct rusage usage {};
+	if ( wait4( pid, &status, 0, &usage ) < 0 ) {
+		perror( "wait4" );
+		return ans;
+	}
+	auto end = std::chrono::steady_clock::now();
+
+	ans.success_     = WIFEXITED( status ) && ( WEXITSTATUS( status ) == 0 );
+	ans.elapsed_sec_ = std::chrono::duration<double>( end - start ).count();
+	ans.max_rss_kb_  = usage.ru_maxrss;
+	return ans;
+}
+
+}   // namespace
+
+int main( int argc, char* argv[] )
+{
+	if ( argc < 3 ) {
+		fprintf( stderr, "Usage: %s <c++ compiler> <include dir> [number of arguments...]\n", argv[0] );
+		return EXIT_FAILURE;
+	}
+	std::string compiler( argv[1] );
+	std::string include_dir( argv[2] );
+
+	std::vector<int> nums;
+	for ( int i = 3; i < argc; i++ ) {
+		nums.push_back( atoi( argv[i] ) );
+	}
+	if ( nums.empty() ) {
+		nums = { 8, 32, 128 };
+	}
+
+	bool all_success = true;
+	for ( const char* p_std : { "-std=c++11", "-std=c++17" } ) {
+		for ( int n : nums ) {
+			std::string src_name = "compile_time_stress_" + std::to_string( n ) + ".cpp";
+			FILE*       fp       = fopen( src_name.c_str(), "w" );
+			if ( fp == nullptr ) {
+				perror( "fopen" );
+				return EXIT_FAILURE;
+			}
+			std::string src = generate_source( n );
+			fwrite( src.data(), 1, src.size(), fp );
+			fclose( fp );
+
+			compile_result ret = run_compiler( { compiler, p_std, "-O2", "-I" + include_dir, "-c", src_name, "-o", src_name + ".o" } );
+			printf( "%-12s args=%-4d %s time=%.2fs max_rss=%ldKB\n",
+			        p_std, n, ret.success_ ? "ok  " : "FAIL", ret.elapsed_sec_, ret.max_rss_kb_ );
+			all_success = all_success && ret.success_;
+		}
+	}
+
+	return all_success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,109 @@
+/**
+ * @file bench_deferred_async_logger.cpp
+ * @author PFA03027@nifty.com
+ * @brief deferred_async_logger::log()の呼び出し側のレイテンシを計測するベンチマーク
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "deferred_async_logger.hpp"
+
+namespace {
+
+constexpr int num_of_logs_per_thread = 100000;
+
+/**
+ * @brief 1回のlog()呼び出しに要した時間[ns]を記録する
+ */
+std::vector<long long> run_producer( deferred_async_logger<>& logger, int thread_id )
+{
+	std::vector<long long> latencies;
+	latencies.reserve( num_of_logs_per_thread );
+
+	std::string str( "request done" );
+	for ( int i = 0; i < num_of_logs_per_thread; i++ ) {
+		auto start = std::chrono::steady_clock::now();
+		while ( !logger.log( "thread %d: %d, %f, %s\n", thread_id, i, 3.14, str ) ) {
+			// リングバッファに空きがない場合は、バックグラウンドスレッドの出力を待つ
+			std::this_thread::yield();
+		}
+		auto end = std::chrono::steady_clock::now();
+		latencies.push_back( std::chrono::duration_cast<std::chrono::nanoseconds>( end - start ).count() );
+	}
+
+	return latencies;
+}
+
+void report( const char* title, std::vector<long long>& latencies )
+{
+	std::sort( latencies.begin(), latencies.end() );
+	long long sum = 0;
+	for ( auto e : latencies ) {
+		sum += e;
+	}
+	auto percentile = [&latencies]( double p ) {
+		return latencies[static_cast<size_t>( p * static_cast<double>( latencies.size() - 1 ) )];
+	};
+
+	printf( "%-12s calls=%zu mean=%lldns p50=%lldns p99=%lldns p99.9=%lldns max=%lldns\n",
+	        title,
+	        latencies.size(),
+	        sum / static_cast<long long>( latencies.size() ),
+	        percentile( 0.5 ),
+	        percentile( 0.99 ),
+	        percentile( 0.999 ),
+	        latencies.back() );
+}
+
+void run_bench( int num_of_threads )
+{
+	FILE* fp = fopen( "/dev/null", "w" );
+	if ( fp == nullptr ) {
+		perror( "fopen" );
+		exit( EXIT_FAILURE );
+	}
+
+	std::vector<std::vector<long long>> results( num_of_threads );
+	{
+		deferred_async_logger<>  logger( fp, 1 << 16 );
+		std::vector<std::thread> producers;
+		for ( int t = 0; t < num_of_threads; t++ ) {
+			producers.emplace_back( [&logger, &results, t]() {
+				results[t] = run_producer( logger, t );
+			} );
+		}
+		for ( auto& th : producers ) {
+			th.join();
+		}
+	}
+	fclose( fp );
+
+	std::vector<long long> all;
+	for ( auto& r : results ) {
+		all.insert( all.end(), r.begin(), r.end() );
+	}
+	char title[32];
+	snprintf( title, sizeof( title ), "%d thread(s)", num_of_threads );
+	report( title, all );
+}
+
+}   // namespace
+
+int main( void )
+{
+	printf( "front-end latency of deferred_async_logger::log()\n" );
+	run_bench( 1 );
+	run_bench( 4 );
+	return EXIT_SUCCESS;
+}
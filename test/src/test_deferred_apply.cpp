@@ -12,7 +12,10 @@
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <memory>
+#include <string>
 #include <typeindex>
+#include <vector>
 
 #include "deferred_apply.hpp"
 
@@ -807,3 +810,612 @@ TEST( Deferred_Apply, CanCall_apply_functor_that_return_void )
 	static_assert( std::is_same<decltype( xx.apply() ), void>::value );
 	EXPECT_EQ( 2, aa.call_counter );
 }
+
+TEST( Deferred_Apply, fits_inline_trait )
+{
+	// Arrange
+	struct local {
+		static int t_func( int arg )
+		{
+			return arg;
+		}
+	};
+	struct big_functor {
+		void operator()( void )
+		{
+		}
+		char buff_[256];
+	};
+
+	// Act
+	// Assert
+	static_assert( deferred_apply<int>::fits_inline<int ( * )( int ), int>::value, "function pointer and int should fit in the inline buffer" );
+	static_assert( !deferred_apply<void>::fits_inline<big_functor>::value, "big_functor should not fit in the inline buffer" );
+	static_assert( deferred_apply<void, 512>::fits_inline<big_functor>::value, "big_functor should fit in the 512 bytes inline buffer" );
+	auto sut = make_deferred_apply( &local::t_func, 3 );
+	EXPECT_EQ( 3, sut.apply() );
+}
+
+TEST( Inplace_Deferred_Apply, apply_copy_move )
+{
+	// Arrange
+	struct local {
+		static int t_func( int arg1, int arg2 )
+		{
+			return arg1 + arg2;
+		}
+	};
+	int  a   = 1;
+	auto sut = make_inplace_deferred_apply<32>( &local::t_func, a, 2 );
+	static_assert( std::is_same<decltype( sut ), inplace_deferred_apply<int, 32>>::value, "sut should be inplace_deferred_apply" );
+
+	// Act
+	auto sut2 = sut;
+	auto sut3 = std::move( sut );
+
+	// Assert
+	EXPECT_FALSE( sut.valid() );
+	EXPECT_EQ( 3, sut2.apply() );
+	EXPECT_EQ( 3, sut3.apply() );
+	EXPECT_EQ( 1, sut3.number_of_times_applied() );
+}
+
+TEST( Inplace_Deferred_Apply, big_functor_with_enough_buffer )
+{
+	// Arrange
+	struct big_functor {
+		int operator()( int arg )
+		{
+			return arg + static_cast<int>( sizeof( buff_ ) );
+		}
+		char buff_[256];
+	};
+	inplace_deferred_apply<int, 512> sut( big_functor {}, 1 );
+	inplace_deferred_apply<int, 512> sut2;
+
+	// Act
+	sut2 = sut;
+
+	// Assert
+	EXPECT_EQ( 257, sut.apply() );
+	EXPECT_EQ( 257, sut2.apply() );
+	// inplace_deferred_apply<int, 128> sut3( big_functor {}, 1 ); // static_assert failure
+}
+
+TEST( Deferred_Apply, emplace_replace_content )
+{
+	// Arrange
+	struct local {
+		static int t_func( int arg1, int arg2 )
+		{
+			return arg1 + arg2;
+		}
+		static int t_func2( int arg1 )
+		{
+			return arg1 * 10;
+		}
+	};
+	auto sut = make_deferred_apply( &local::t_func, 1, 2 );
+	EXPECT_EQ( 3, sut.apply() );
+
+	// Act
+	sut.emplace( &local::t_func2, 4 );
+
+	// Assert
+	EXPECT_TRUE( sut.valid() );
+	EXPECT_EQ( 0, sut.number_of_times_applied() );
+	EXPECT_EQ( 40, sut.apply() );
+}
+
+TEST( Deferred_Apply, reset_make_empty )
+{
+	// Arrange
+	struct local {
+		static int t_func( int arg1 )
+		{
+			return arg1;
+		}
+	};
+	auto sut = make_deferred_apply( &local::t_func, 1 );
+
+	// Act
+	sut.reset();
+
+	// Assert
+	EXPECT_FALSE( sut.valid() );
+}
+
+TEST( Deferred_Apply, apply_with_trailing_arguments )
+{
+	// Arrange
+	struct local {
+		static int t_func( int arg1, int arg2, int arg3 )
+		{
+			return arg1 * 100 + arg2 * 10 + arg3;
+		}
+	};
+	deferred_apply<int( int, int )> sut( &local::t_func, 1 );
+
+	// Act
+	int ret1 = sut.apply( 2, 3 );
+	int ret2 = sut.apply( 4, 5 );
+
+	// Assert
+	EXPECT_EQ( 123, ret1 );
+	EXPECT_EQ( 145, ret2 );
+	EXPECT_EQ( 2, sut.number_of_times_applied() );
+	static_assert( std::is_same<deferred_apply<int( int, int )>::result_type, int>::value, "result_type should be int" );
+}
+
+TEST( Deferred_Apply, apply_with_trailing_move_only_argument )
+{
+	// Arrange
+	struct local {
+		static void t_func( std::string* p_out, const std::string& prefix, std::unique_ptr<std::string> up_buff )
+		{
+			*p_out = prefix + *up_buff;
+		}
+	};
+	std::string                                          out;
+	deferred_apply<void( std::unique_ptr<std::string> )> sut( &local::t_func, &out, std::string( "recv:" ) );
+	auto                                                 sut2 = sut;
+
+	// Act
+	sut2.apply( std::unique_ptr<std::string>( new std::string( "data" ) ) );
+
+	// Assert
+	EXPECT_EQ( "recv:data", out );
+}
+
+TEST( Deferred_Apply, apply_with_trailing_reference_argument )
+{
+	// Arrange
+	deferred_apply<void( int& )> sut( []( int delta, int& target ) { target += delta; }, 3 );
+	int                          target = 1;
+
+	// Act
+	sut.apply( target );
+
+	// Assert
+	EXPECT_EQ( 4, target );
+}
+
+TEST( Deferred_Apply, make_deferred_apply_with_placeholders )
+{
+	// Arrange
+	using namespace deferred_apply_placeholders;
+	struct local {
+		static int t_func( int arg1, int arg2, int arg3 )
+		{
+			return arg1 * 100 + arg2 * 10 + arg3;
+		}
+	};
+
+	// Act
+	auto sut = make_deferred_apply( local::t_func, _2, 5, _1 );
+
+	// Assert
+	static_assert( std::is_same<decltype( sut ), deferred_apply<int( int, int )>>::value, "signature should be deduced from the placeholders" );
+	EXPECT_EQ( 253, sut.apply( 3, 2 ) );
+	EXPECT_EQ( 758, sut.apply( 8, 7 ) );
+}
+
+TEST( Deferred_Apply, placeholder_with_move_only_argument )
+{
+	// Arrange
+	using namespace deferred_apply_placeholders;
+	struct local {
+		static void t_func( std::string* p_out, std::unique_ptr<std::string> up_buff, const std::string& suffix )
+		{
+			*p_out = *up_buff + suffix;
+		}
+	};
+	std::string                                          out;
+	deferred_apply<void( std::unique_ptr<std::string> )> sut( &local::t_func, &out, _1, std::string( ":done" ) );
+
+	// Act
+	sut.apply( std::unique_ptr<std::string>( new std::string( "data" ) ) );
+
+	// Assert
+	EXPECT_EQ( "data:done", out );
+	static_assert( deferred_apply<void( std::unique_ptr<std::string> )>::fits_inline<void ( * )( std::string*, std::unique_ptr<std::string>, const std::string& ), std::string*, const deferred_apply_placeholders::placeholder<1>&, std::string>::value, "placeholder should not increase the size" );
+}
+
+namespace {
+
+struct copy_move_counter {
+	copy_move_counter( void ) = default;
+	copy_move_counter( const copy_move_counter& orig )
+	  : valid_( orig.valid_ )
+	{
+		num_of_copies_++;
+	}
+	copy_move_counter( copy_move_counter&& orig )
+	  : valid_( orig.valid_ )
+	{
+		orig.valid_ = false;
+	}
+
+	bool valid_ = true;
+
+	static int num_of_copies_;
+};
+
+int copy_move_counter::num_of_copies_ = 0;
+
+void consume_counter( std::vector<bool>* p_log, copy_move_counter&& arg )
+{
+	copy_move_counter tmp( std::move( arg ) );
+	p_log->push_back( tmp.valid_ );
+}
+
+}   // namespace
+
+TEST( Deferred_Apply, repeatable_apply_with_apply_final )
+{
+	// Arrange
+	std::vector<bool> log;
+	auto              sut = make_deferred_apply( &consume_counter, &log, copy_move_counter() );
+	sut.enable_repeatable_apply();
+	copy_move_counter::num_of_copies_ = 0;
+
+	// Act
+	sut.apply();
+	sut.apply();
+	sut.apply_final();
+
+	// Assert
+	EXPECT_TRUE( sut.is_repeatable_apply() );
+	EXPECT_EQ( 2, copy_move_counter::num_of_copies_ );
+	EXPECT_EQ( ( std::vector<bool> { true, true, true } ), log );
+	EXPECT_EQ( 3, sut.number_of_times_applied() );
+}
+
+TEST( Deferred_Apply, repeatable_apply_moves_on_last_attempt )
+{
+	// Arrange
+	std::vector<bool> log;
+	auto              sut = make_deferred_apply( &consume_counter, &log, copy_move_counter() );
+	sut.enable_repeatable_apply( 3 );
+	copy_move_counter::num_of_copies_ = 0;
+
+	// Act
+	sut.apply();
+	sut.apply();
+	sut.apply();
+
+	// Assert
+	EXPECT_EQ( 2, copy_move_counter::num_of_copies_ );
+	EXPECT_EQ( ( std::vector<bool> { true, true, true } ), log );
+}
+
+TEST( Deferred_Apply, repeatable_apply_after_final_throws )
+{
+	// Arrange
+	std::vector<bool> log;
+	auto              sut1 = make_deferred_apply( &consume_counter, &log, copy_move_counter() );
+	auto              sut2 = make_deferred_apply( &consume_counter, &log, copy_move_counter() );
+	sut1.enable_repeatable_apply();
+	sut2.enable_repeatable_apply( 2 );
+
+	// Act
+	sut1.apply();
+	sut1.apply_final();
+	sut2.apply();
+	sut2.apply();
+
+	// Assert
+	EXPECT_THROW( sut1.apply(), decltype( sut1 )::bad_apply_after_final );
+	EXPECT_THROW( sut1.apply_final(), decltype( sut1 )::bad_apply_after_final );
+	EXPECT_THROW( sut2.apply(), decltype( sut2 )::bad_apply_after_final );
+	EXPECT_EQ( ( std::vector<bool> { true, true, true, true } ), log );
+	EXPECT_EQ( 2, sut1.number_of_times_applied() );
+}
+
+TEST( Deferred_Apply, repeatable_apply_with_move_only_argument )
+{
+	// Arrange
+	struct local {
+		static void t_func( std::unique_ptr<int> )
+		{
+		}
+	};
+	deferred_apply<void> sut( &local::t_func, std::unique_ptr<int>( new int( 1 ) ) );
+	sut.enable_repeatable_apply();
+
+	// Act
+	// Assert
+	EXPECT_THROW( sut.apply(), std::bad_alloc );
+	EXPECT_NO_THROW( sut.apply_final() );
+}
+
+TEST( Deferred_Apply, introspect_empty_instance )
+{
+	// Arrange
+	deferred_apply<void> sut;
+
+	// Act
+	deferred_apply_introspection info = sut.introspect();
+
+	// Assert
+	EXPECT_EQ( deferred_apply_storage_mode::empty, info.storage_mode );
+	EXPECT_EQ( 0, info.storage_size );
+	EXPECT_EQ( 0, info.number_of_arguments );
+}
+
+TEST( Deferred_Apply, introspect_inline_instance )
+{
+	// Arrange
+	struct local {
+		static void t_func( int, int&, const char*, std::string )
+		{
+		}
+	};
+	int  lv = 1;
+	auto sut = make_deferred_apply( &local::t_func, 1, lv, "abc", std::string( "def" ) );
+
+	// Act
+	deferred_apply_introspection info = sut.introspect();
+
+	// Assert
+	EXPECT_EQ( deferred_apply_storage_mode::inline_buffer, info.storage_mode );
+	EXPECT_LE( info.storage_size, deferred_apply_default_buffer_size );
+	EXPECT_EQ( 0, info.storage_size % info.storage_align );
+	EXPECT_TRUE( info.copy_constructible );
+	EXPECT_TRUE( info.move_constructible );
+	ASSERT_EQ( 4, info.number_of_arguments );
+	EXPECT_EQ( deferred_argument_storage::owned_value, info.p_argument_storage[0] );
+	EXPECT_EQ( deferred_argument_storage::reference, info.p_argument_storage[1] );
+	EXPECT_EQ( deferred_argument_storage::pointer, info.p_argument_storage[2] );
+	EXPECT_EQ( deferred_argument_storage::owned_value, info.p_argument_storage[3] );
+	EXPECT_EQ( 1, info.number_of_references() );
+}
+
+TEST( Deferred_Apply, introspect_heap_and_move_only_instance )
+{
+	// Arrange
+	struct big_functor {
+		void operator()( std::unique_ptr<int> )
+		{
+		}
+		char buff_[256];
+	};
+	deferred_apply<void> sut( big_functor(), std::unique_ptr<int>( new int( 1 ) ) );
+
+	// Act
+	deferred_apply_introspection info = sut.introspect();
+
+	// Assert
+	EXPECT_EQ( deferred_apply_storage_mode::heap, info.storage_mode );
+	EXPECT_GT( info.storage_size, deferred_apply_default_buffer_size );
+	EXPECT_FALSE( info.copy_constructible );
+	EXPECT_TRUE( info.move_constructible );
+	EXPECT_EQ( 0, info.number_of_references() );
+}
+
+namespace {
+
+std::string format_with_count( int* p_count, const std::string& prefix, int v )
+{
+	( *p_count )++;
+	return prefix + std::to_string( v );
+}
+
+void store_string( std::string* p_out, std::string s )
+{
+	*p_out = std::move( s );
+}
+
+}   // namespace
+
+TEST( Deferred_Apply, lazy_argument_is_evaluated_at_apply )
+{
+	// Arrange
+	int         count = 0;
+	std::string out;
+	auto        sut = make_deferred_apply( &store_string, &out, deferred_lazy( &format_with_count, &count, std::string( "v" ), 1 ) );
+	EXPECT_EQ( 0, count );
+
+	// Act
+	sut.apply();
+
+	// Assert
+	EXPECT_EQ( 1, count );
+	EXPECT_EQ( "v1", out );
+}
+
+TEST( Deferred_Apply, lazy_argument_is_not_evaluated_if_dropped )
+{
+	// Arrange
+	int count = 0;
+	{
+		std::string out;
+		auto        sut = make_deferred_apply( &store_string, &out, deferred_lazy( &format_with_count, &count, std::string( "v" ), 1 ) );
+
+		// Act
+		sut.reset();
+	}
+
+	// Assert
+	EXPECT_EQ( 0, count );
+}
+
+TEST( Deferred_Apply, lazy_argument_is_evaluated_at_each_repeated_apply )
+{
+	// Arrange
+	int         count = 0;
+	std::string out;
+	auto        sut = make_deferred_apply( &store_string, &out, deferred_lazy( &format_with_count, &count, std::string( "v" ), 2 ) );
+	sut.enable_repeatable_apply();
+
+	// Act
+	sut.apply();
+	sut.apply();
+	sut.apply_final();
+
+	// Assert
+	EXPECT_EQ( 3, count );
+	EXPECT_EQ( "v2", out );
+}
+
+TEST( Deferred_Apply, cached_lazy_argument_is_evaluated_once )
+{
+	// Arrange
+	int         count = 0;
+	std::string out;
+	auto        sut = make_deferred_apply( &store_string, &out, deferred_lazy_cached( &format_with_count, &count, std::string( "v" ), 3 ) );
+	sut.enable_repeatable_apply();
+
+	// Act
+	sut.apply();
+	out.clear();
+	sut.apply();
+	sut.apply_final();
+
+	// Assert
+	EXPECT_EQ( 1, count );
+	EXPECT_EQ( "v3", out );
+}
+
+TEST( Deferred_Apply, introspect_lazy_argument )
+{
+	// Arrange
+	int         count = 0;
+	std::string out;
+	auto        sut = make_deferred_apply( &store_string, &out, deferred_lazy_cached( &format_with_count, &count, std::string( "v" ), 4 ) );
+
+	// Act
+	deferred_apply_introspection info = sut.introspect();
+
+	// Assert
+	ASSERT_EQ( 2, info.number_of_arguments );
+	EXPECT_EQ( deferred_argument_storage::lazy, info.p_argument_storage[1] );
+	EXPECT_EQ( 0, count );
+}
+
+namespace {
+
+struct large_result {
+	explicit large_result( int v )
+	  : v_( v )
+	{
+		buff_[0] = static_cast<char>( v );
+	}
+	large_result( const large_result& orig )
+	  : v_( orig.v_ )
+	{
+		num_of_copies_or_moves_++;
+	}
+	large_result( large_result&& orig )
+	  : v_( orig.v_ )
+	{
+		num_of_copies_or_moves_++;
+	}
+
+	int  v_;
+	char buff_[1024];
+
+	static int num_of_copies_or_moves_;
+};
+
+int large_result::num_of_copies_or_moves_ = 0;
+
+large_result make_large_result( int v )
+{
+	return large_result( v );
+}
+
+}   // namespace
+
+TEST( Deferred_Apply, apply_into_constructs_results_in_array )
+{
+	// Arrange
+	std::vector<deferred_apply<large_result>> jobs;
+	for ( int i = 0; i < 4; i++ ) {
+		jobs.emplace_back( &make_large_result, static_cast<int>( i ) );
+	}
+	typename std::aligned_storage<sizeof( large_result ), alignof( large_result )>::type slots[4];
+	large_result*                                                                         p_results = reinterpret_cast<large_result*>( slots );
+
+	// Act
+	for ( int i = 0; i < 4; i++ ) {
+		jobs[i].apply_into( &p_results[i] );
+	}
+
+	// Assert
+	for ( int i = 0; i < 4; i++ ) {
+		EXPECT_EQ( i, p_results[i].v_ );
+		p_results[i].~large_result();
+	}
+}
+
+TEST( Deferred_Apply, apply_into_with_extra_and_repeatable_apply )
+{
+	// Arrange
+	struct local {
+		static std::string t_func( std::string s, int n )
+		{
+			return s + std::to_string( n );
+		}
+	};
+	deferred_apply<std::string( int )> sut( &local::t_func, std::string( "x" ) );
+	sut.enable_repeatable_apply();
+	typename std::aligned_storage<sizeof( std::string ), alignof( std::string )>::type slot1;
+	typename std::aligned_storage<sizeof( std::string ), alignof( std::string )>::type slot2;
+
+	// Act
+	sut.apply_into( reinterpret_cast<std::string*>( &slot1 ), 1 );
+	sut.apply_into( reinterpret_cast<std::string*>( &slot2 ), 2 );
+
+	// Assert
+	std::string* p_s1 = reinterpret_cast<std::string*>( &slot1 );
+	std::string* p_s2 = reinterpret_cast<std::string*>( &slot2 );
+	EXPECT_EQ( "x1", *p_s1 );
+	EXPECT_EQ( "x2", *p_s2 );
+	EXPECT_EQ( 2, sut.number_of_times_applied() );
+	p_s1->~basic_string();
+	p_s2->~basic_string();
+}
+
+#if __cplusplus >= 201703L
+namespace {
+
+struct non_movable_result {
+	explicit non_movable_result( int v )
+	  : v_( v )
+	{
+	}
+	non_movable_result( const non_movable_result& ) = delete;
+	non_movable_result( non_movable_result&& )      = delete;
+
+	int v_;
+};
+
+non_movable_result make_non_movable_result( int v )
+{
+	return non_movable_result( v );
+}
+
+}   // namespace
+
+TEST( Deferred_Apply, apply_emplace_with_non_movable_result )
+{
+	// Arrange
+	deferred_apply<non_movable_result> sut( &make_non_movable_result, 7 );
+	std::optional<non_movable_result>  opt;
+	deferred_apply<large_result>       sut2( &make_large_result, 3 );
+	std::optional<large_result>        opt2;
+	large_result::num_of_copies_or_moves_ = 0;
+
+	// Act
+	non_movable_result& ret = sut.apply_emplace( opt );
+	sut2.apply_emplace( opt2 );
+
+	// Assert
+	ASSERT_TRUE( opt.has_value() );
+	EXPECT_EQ( 7, ret.v_ );
+	EXPECT_EQ( 7, opt->v_ );
+	EXPECT_EQ( 3, opt2->v_ );
+	EXPECT_EQ( 0, large_result::num_of_copies_or_moves_ );
+}
+#endif
@@ -0,0 +1,147 @@
+/**
+ * @file test_deferred_apply_all.cpp
+ * @author PFA03027@nifty.com
+ * @brief apply_all()のテスト
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "deferred_apply_all.hpp"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+int twice( int v )
+{
+	return v * 2;
+}
+
+int throw_if_negative( int v )
+{
+	if ( v < 0 ) {
+		throw std::runtime_error( "negative" );
+	}
+	return v;
+}
+
+void add_to( std::atomic<int>* p_sum, int v )
+{
+	p_sum->fetch_add( v );
+}
+
+}   // namespace
+
+TEST( Deferred_Apply_All, write_results_in_order_on_default_executor )
+{
+	// Arrange
+	std::vector<deferred_apply<int>> jobs;
+	for ( int i = 0; i < 1000; i++ ) {
+		jobs.emplace_back( &twice, static_cast<int>( i ) );
+	}
+	std::vector<int> results( jobs.size(), -1 );
+
+	// Act
+	apply_all( jobs.begin(), jobs.end(), results.begin(), 7 );
+
+	// Assert
+	for ( int i = 0; i < 1000; i++ ) {
+		EXPECT_EQ( i * 2, results[i] );
+	}
+}
+
+TEST( Deferred_Apply_All, apply_function_to_deferred_applying_arguments )
+{
+	// Arrange
+	using args_t = decltype( make_deferred_applying_values( 1, std::string() ) );
+	std::vector<args_t> jobs;
+	for ( int i = 0; i < 100; i++ ) {
+		jobs.push_back( make_deferred_applying_values( i, std::string( "x" ) ) );
+	}
+	std::string results[100];
+	auto        f = []( int n, std::string s ) {
+		return s + std::to_string( n );
+	};
+
+	// Act
+	apply_all( jobs.begin(), jobs.end(), results, f );
+
+	// Assert
+	EXPECT_EQ( "x0", results[0] );
+	EXPECT_EQ( "x99", results[99] );
+}
+
+TEST( Deferred_Apply_All, run_on_supplied_executor )
+{
+	// Arrange
+	deferred_priority_executor<2>    ex( 2 );
+	std::vector<deferred_apply<int>> jobs;
+	for ( int i = 0; i < 100; i++ ) {
+		jobs.emplace_back( &twice, static_cast<int>( i ) );
+	}
+	std::vector<int> results( jobs.size(), -1 );
+
+	// Act
+	apply_all( ex, jobs.begin(), jobs.end(), results.begin() );
+
+	// Assert
+	EXPECT_EQ( 0, results[0] );
+	EXPECT_EQ( 198, results[99] );
+}
+
+TEST( Deferred_Apply_All, empty_range )
+{
+	// Arrange
+	std::vector<deferred_apply<int>> jobs;
+	int                              result = -1;
+
+	// Act
+	apply_all( jobs.begin(), jobs.end(), &result );
+
+	// Assert
+	EXPECT_EQ( -1, result );
+}
+
+TEST( Deferred_Apply_All, exception_is_rethrown_after_other_chunks )
+{
+	// Arrange
+	std::vector<deferred_apply<int>> jobs;
+	for ( int i = 0; i < 100; i++ ) {
+		jobs.emplace_back( &throw_if_negative, ( i == 50 ) ? -1 : static_cast<int>( i ) );
+	}
+	std::vector<int> results( jobs.size(), -1 );
+
+	// Act
+	EXPECT_THROW( apply_all( jobs.begin(), jobs.end(), results.begin(), 10 ), std::runtime_error );
+
+	// Assert
+	EXPECT_EQ( 0, results[0] );
+	EXPECT_EQ( -1, results[50] );
+	EXPECT_EQ( 99, results[99] );
+}
+
+TEST( Deferred_Apply_All, apply_void_range_without_output )
+{
+	// Arrange
+	deferred_priority_executor<1>     ex( 2 );
+	std::atomic<int>                  sum( 0 );
+	std::vector<deferred_apply<void>> jobs;
+	for ( int i = 0; i < 100; i++ ) {
+		jobs.emplace_back( &add_to, &sum, static_cast<int>( i ) );
+	}
+
+	// Act
+	apply_all( jobs.begin(), jobs.end(), 7 );
+	apply_all( ex, jobs.begin(), jobs.end() );
+
+	// Assert
+	EXPECT_EQ( 2 * 4950, sum.load() );
+}
@@ -0,0 +1,160 @@
+/**
+ * @file test_deferred_apply_batch.cpp
+ * @author PFA03027@nifty.com
+ * @brief deferred_apply_batchのテスト
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "deferred_apply_batch.hpp"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+void record_int( std::vector<std::string>* p_log, int v )
+{
+	p_log->push_back( std::to_string( v ) );
+}
+
+void record_str( std::vector<std::string>* p_log, std::string v )
+{
+	p_log->push_back( v );
+}
+
+}   // namespace
+
+TEST( Deferred_Apply_Batch, drain_grouped_by_type )
+{
+	// Arrange
+	deferred_apply_batch     sut;
+	std::vector<std::string> log;
+	sut.push( &record_int, &log, 1 );
+	sut.push( &record_str, &log, std::string( "a" ) );
+	sut.push( &record_int, &log, 2 );
+	sut.push( &record_str, &log, std::string( "b" ) );
+	sut.push( &record_int, &log, 3 );
+
+	// Act
+	size_t ret = sut.drain();
+
+	// Assert
+	EXPECT_EQ( 5, ret );
+	EXPECT_TRUE( sut.empty() );
+	EXPECT_EQ( ( std::vector<std::string> { "1", "2", "3", "a", "b" } ), log );
+}
+
+TEST( Deferred_Apply_Batch, drain_fifo )
+{
+	// Arrange
+	deferred_apply_batch     sut;
+	std::vector<std::string> log;
+	sut.push( &record_int, &log, 1 );
+	sut.push( &record_int, &log, 2 );
+	sut.push( &record_str, &log, std::string( "a" ) );
+	sut.push( &record_int, &log, 3 );
+	sut.push( &record_str, &log, std::string( "b" ) );
+
+	// Act
+	size_t ret = sut.drain( batch_drain_order::fifo );
+
+	// Assert
+	EXPECT_EQ( 5, ret );
+	EXPECT_TRUE( sut.empty() );
+	EXPECT_EQ( ( std::vector<std::string> { "1", "2", "a", "3", "b" } ), log );
+}
+
+TEST( Deferred_Apply_Batch, number_of_types )
+{
+	// Arrange
+	deferred_apply_batch     sut;
+	std::vector<std::string> log;
+
+	// Act
+	sut.push( &record_int, &log, 1 );
+	sut.push( &record_str, &log, std::string( "a" ) );
+	sut.push( &record_int, &log, 2 );
+	sut.push( [&log]() { log.push_back( "lambda" ); } );
+
+	// Assert
+	EXPECT_EQ( 4, sut.size() );
+	EXPECT_EQ( 3, sut.number_of_types() );
+	sut.clear();
+	EXPECT_TRUE( sut.empty() );
+	EXPECT_EQ( 0, sut.number_of_types() );
+	EXPECT_EQ( 0, sut.drain() );
+	EXPECT_TRUE( log.empty() );
+}
+
+TEST( Deferred_Apply_Batch, move_only_argument )
+{
+	// Arrange
+	struct local {
+		static void t_func( int* p_out, std::unique_ptr<int> up )
+		{
+			*p_out += *up;
+		}
+	};
+	deferred_apply_batch sut;
+	int                  out = 0;
+	for ( int i = 0; i < 100; i++ ) {
+		sut.push( &local::t_func, &out, std::unique_ptr<int>( new int( 1 ) ) );
+	}
+
+	// Act
+	sut.drain();
+
+	// Assert
+	EXPECT_EQ( 100, out );
+}
+
+TEST( Deferred_Apply_Batch, push_while_draining )
+{
+	// Arrange
+	deferred_apply_batch     sut;
+	std::vector<std::string> log;
+	sut.push( [&sut, &log]() {
+		log.push_back( "first" );
+		sut.push( &record_int, &log, 2 );
+	} );
+
+	// Act
+	size_t ret = sut.drain();
+
+	// Assert
+	EXPECT_EQ( 1, ret );
+	EXPECT_EQ( 1, sut.size() );
+	sut.drain();
+	EXPECT_EQ( ( std::vector<std::string> { "first", "2" } ), log );
+}
+
+TEST( Deferred_Apply_Batch, exception_discards_rest )
+{
+	// Arrange
+	struct local {
+		static void t_throw( void )
+		{
+			throw std::runtime_error( "test" );
+		}
+	};
+	deferred_apply_batch     sut;
+	std::vector<std::string> log;
+	sut.push( &record_int, &log, 1 );
+	sut.push( &local::t_throw );
+	sut.push( &record_int, &log, 2 );
+
+	// Act
+	EXPECT_THROW( sut.drain( batch_drain_order::fifo ), std::runtime_error );
+
+	// Assert
+	EXPECT_TRUE( sut.empty() );
+	EXPECT_EQ( ( std::vector<std::string> { "1" } ), log );
+}
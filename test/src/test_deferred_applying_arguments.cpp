@@ -12,6 +12,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <memory>
+#include <string>
 #include <typeindex>
 
 #include "deferred_apply.hpp"
@@ -421,3 +422,146 @@ TEST( DeferredApplyingArguments, CanCall_apply_functor_that_return_void )
 	static_assert( std::is_same<decltype( xx.apply( aa ) ), void>::value );
 	EXPECT_EQ( 2, aa.call_counter );
 }
+
+TEST( DeferredApplyingArguments, make_deferred_applying_values_holds_copy_of_lvalue )
+{
+	// Arrange
+	struct local {
+		static std::string t_func( std::string arg1, const char* arg2 )
+		{
+			return arg1 + arg2;
+		}
+	};
+	std::string str( "abc" );
+	auto        xx = make_deferred_applying_values( str, "def" );
+
+	// Act
+	str      = "xyz";
+	auto ret = xx.apply( local::t_func );
+
+	// Assert
+	EXPECT_EQ( "abcdef", ret );
+	EXPECT_EQ( "xyz", str );
+}
+
+TEST( DeferredApplyingArguments, apply_with_trailing_arguments )
+{
+	// Arrange
+	struct local {
+		static std::string t_func( std::string arg1, int arg2, const std::string& arg3 )
+		{
+			return arg1 + std::to_string( arg2 ) + arg3;
+		}
+	};
+	auto        xx = make_deferred_applying_arguments( std::string( "abc" ) );
+	std::string extra( "def" );
+
+	// Act
+	auto ret = xx.apply( local::t_func, 1, extra );
+
+	// Assert
+	EXPECT_EQ( "abc1def", ret );
+}
+
+TEST( DeferredApplyingArguments, apply_with_placeholders )
+{
+	// Arrange
+	using namespace deferred_apply_placeholders;
+	struct local {
+		static std::string t_func( const std::string& arg1, int arg2, const std::string& arg3 )
+		{
+			return arg1 + std::to_string( arg2 ) + arg3;
+		}
+	};
+	auto        xx = make_deferred_applying_arguments( _2, 1, _1 );
+	std::string extra( "def" );
+
+	// Act
+	auto ret = xx.apply( local::t_func, extra, std::string( "abc" ) );
+
+	// Assert
+	EXPECT_EQ( "abc1def", ret );
+}
+
+TEST( DeferredApplyingArguments, placeholders_take_no_storage )
+{
+	// Arrange
+	using namespace deferred_apply_placeholders;
+
+	// Act
+	auto xx = make_deferred_applying_arguments( _1, 1, _2 );
+
+	// Assert
+	EXPECT_EQ( sizeof( make_deferred_applying_arguments( 1 ) ), sizeof( xx ) );
+}
+
+TEST( DeferredApplyingArguments, apply_copy_keeps_held_values )
+{
+	// Arrange
+	struct local {
+		static std::string t_func( std::string&& arg1 )
+		{
+			std::string ret( std::move( arg1 ) );
+			return ret;
+		}
+	};
+	auto xx = make_deferred_applying_arguments( std::string( "abc" ) );
+
+	// Act
+	auto ret1 = xx.apply_copy( local::t_func );
+	auto ret2 = xx.apply_copy( local::t_func );
+	auto ret3 = xx.apply( local::t_func );
+
+	// Assert
+	EXPECT_EQ( "abc", ret1 );
+	EXPECT_EQ( "abc", ret2 );
+	EXPECT_EQ( "abc", ret3 );
+}
+
+TEST( DeferredApplyingArguments, introspect_argument_storage )
+{
+	// Arrange
+	using namespace deferred_apply_placeholders;
+	int lv = 1;
+
+	// Act
+	auto xx                           = make_deferred_applying_arguments( lv, _1, std::string( "abc" ), "literal" );
+	using xx_t                        = decltype( xx );
+	deferred_apply_introspection info = xx_t::introspect();
+
+	// Assert
+	static_assert( xx_t::number_of_arguments == 4, "number of arguments should include the placeholder" );
+	static_assert( xx_t::argument_storage<0>::value == deferred_argument_storage::reference, "lvalue should be held by reference" );
+	static_assert( xx_t::argument_storage<1>::value == deferred_argument_storage::placeholder, "_1 should be a placeholder" );
+	static_assert( xx_t::argument_storage<2>::value == deferred_argument_storage::owned_value, "rvalue should be held by value" );
+	static_assert( xx_t::argument_storage<3>::value == deferred_argument_storage::pointer, "array should be held by pointer" );
+	EXPECT_EQ( deferred_apply_storage_mode::inline_buffer, info.storage_mode );
+	EXPECT_EQ( sizeof( xx ), info.storage_size );
+	EXPECT_EQ( alignof( xx_t ), info.storage_align );
+	EXPECT_TRUE( info.copy_constructible );
+	EXPECT_EQ( 1, info.number_of_references() );
+	EXPECT_EQ( 1, info.number_of_arguments_stored_as( deferred_argument_storage::placeholder ) );
+}
+
+TEST( DeferredApplyingArguments, apply_lvalue_passes_held_values_without_copy )
+{
+	// Arrange
+	using namespace deferred_apply_placeholders;
+	struct local {
+		static const std::string* t_func( std::string& arg1, int arg2, const std::unique_ptr<int>& arg3 )
+		{
+			arg1 += std::to_string( arg2 + *arg3 );
+			return &arg1;
+		}
+	};
+	auto xx = make_deferred_applying_arguments( std::string( "abc" ), _1, std::unique_ptr<int>( new int( 1 ) ) );
+
+	// Act
+	const std::string* p_ret1 = xx.apply_lvalue( local::t_func, 1 );
+	const std::string* p_ret2 = xx.apply_lvalue( local::t_func, 2 );
+
+	// Assert
+	EXPECT_EQ( &std::get<0>( xx.stored_values() ), p_ret1 );   // 保持している値そのものが渡される
+	EXPECT_EQ( p_ret1, p_ret2 );
+	EXPECT_EQ( "abc23", *p_ret2 );
+}
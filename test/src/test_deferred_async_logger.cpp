@@ -0,0 +1,150 @@
+/**
+ * @file test_deferred_async_logger.cpp
+ * @author PFA03027@nifty.com
+ * @brief deferred_async_loggerのテスト
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "deferred_async_logger.hpp"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+std::string read_all( FILE* fp )
+{
+	std::string ans;
+	rewind( fp );
+	char buff[256];
+	size_t n;
+	while ( ( n = fread( buff, 1, sizeof( buff ), fp ) ) > 0 ) {
+		ans.append( buff, n );
+	}
+	return ans;
+}
+
+}   // namespace
+
+TEST( Deferred_Async_Logger, log_then_flush )
+{
+	// Arrange
+	FILE* fp = tmpfile();
+	ASSERT_NE( nullptr, fp );
+	deferred_async_logger<> sut( fp );
+	std::string             str( "abc" );
+
+	// Act
+	bool ret = sut.log( "%d, %s, %s, %.1f\n", 1, str, "literal", 2.5 );
+	str      = "modified";   // 値としてキャプチャされているため、出力に影響しない
+	sut.flush();
+
+	// Assert
+	EXPECT_TRUE( ret );
+	EXPECT_EQ( "1, abc, literal, 2.5\n", read_all( fp ) );
+	EXPECT_EQ( 0, sut.dropped() );
+	fclose( fp );
+}
+
+TEST( Deferred_Async_Logger, destructor_writes_remaining_records )
+{
+	// Arrange
+	FILE* fp = tmpfile();
+	ASSERT_NE( nullptr, fp );
+
+	// Act
+	{
+		deferred_async_logger<> sut( fp );
+		for ( int i = 0; i < 3; i++ ) {
+			sut.log( "%d\n", i );
+		}
+	}
+
+	// Assert
+	EXPECT_EQ( "0\n1\n2\n", read_all( fp ) );
+	fclose( fp );
+}
+
+TEST( Deferred_Async_Logger, multiple_threads_keep_per_thread_order )
+{
+	// Arrange
+	FILE* fp = tmpfile();
+	ASSERT_NE( nullptr, fp );
+	const int num_of_threads = 4;
+	const int num_of_logs    = 200;
+
+	// Act
+	{
+		deferred_async_logger<> sut( fp, 16 );
+		std::vector<std::thread> producers;
+		for ( int t = 0; t < num_of_threads; t++ ) {
+			producers.emplace_back( [&sut, t, num_of_logs]() {
+				for ( int i = 0; i < num_of_logs; i++ ) {
+					while ( !sut.log( "%d %d\n", t, i ) ) {
+						std::this_thread::yield();
+					}
+				}
+			} );
+		}
+		for ( auto& th : producers ) {
+			th.join();
+		}
+	}
+
+	// Assert
+	std::vector<int> next_expected( num_of_threads, 0 );
+	std::string      out = read_all( fp );
+	size_t           pos = 0;
+	int              num_of_lines = 0;
+	while ( pos < out.size() ) {
+		size_t eol = out.find( '\n', pos );
+		ASSERT_NE( std::string::npos, eol );
+		int t, i;
+		ASSERT_EQ( 2, sscanf( out.c_str() + pos, "%d %d", &t, &i ) );
+		ASSERT_LT( t, num_of_threads );
+		EXPECT_EQ( next_expected[t], i );
+		next_expected[t] = i + 1;
+		pos              = eol + 1;
+		num_of_lines++;
+	}
+	EXPECT_EQ( num_of_threads * num_of_logs, num_of_lines );
+	fclose( fp );
+}
+
+TEST( Deferred_Async_Logger, ring_of_exited_thread_is_released )
+{
+	// Arrange
+	FILE* fp = tmpfile();
+	ASSERT_NE( nullptr, fp );
+	deferred_async_logger<> sut( fp );
+
+	// Act
+	for ( int t = 0; t < 20; t++ ) {
+		std::thread producer( [&sut, t]() {
+			sut.log( "%d\n", t );
+		} );
+		producer.join();
+	}
+	for ( int i = 0; ( i < 10000 ) && ( sut.number_of_rings() > 0 ); i++ ) {
+		std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+	}
+	sut.flush();
+
+	// Assert
+	EXPECT_EQ( 0, sut.number_of_rings() );
+	std::string out = read_all( fp );
+	for ( int t = 0; t < 20; t++ ) {
+		EXPECT_NE( std::string::npos, out.find( std::to_string( t ) + "\n" ) );
+	}
+	EXPECT_EQ( 0, sut.dropped() );
+	fclose( fp );
+}
@@ -0,0 +1,179 @@
+/**
+ * @file test_deferred_coalescing_queue.cpp
+ * @author PFA03027@nifty.com
+ * @brief deferred_coalescing_queueのテスト
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "deferred_coalescing_queue.hpp"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+void record( std::vector<int>* p_log, int v )
+{
+	p_log->push_back( v );
+}
+
+/**
+ * @brief ムーブ構築で例外を送出する引数
+ */
+struct throw_on_move {
+	throw_on_move( void ) = default;
+
+	throw_on_move( throw_on_move&& )
+	{
+		throw std::runtime_error( "move of throw_on_move" );
+	}
+
+	throw_on_move( const throw_on_move& ) = default;
+};
+
+void ignore_arg( throw_on_move ) {}
+
+}   // namespace
+
+TEST( Deferred_Coalescing_Queue, run_in_fifo_order )
+{
+	// Arrange
+	deferred_coalescing_queue<int> sut;
+	std::vector<int>               log;
+
+	// Act
+	EXPECT_TRUE( sut.push( 1, &record, &log, 10 ) );
+	EXPECT_TRUE( sut.push( 2, &record, &log, 20 ) );
+	EXPECT_TRUE( sut.push( 3, &record, &log, 30 ) );
+	size_t ret = sut.run_all();
+
+	// Assert
+	EXPECT_EQ( 3, ret );
+	EXPECT_TRUE( sut.empty() );
+	EXPECT_EQ( ( std::vector<int> { 10, 20, 30 } ), log );
+}
+
+TEST( Deferred_Coalescing_Queue, replace_keeps_position )
+{
+	// Arrange
+	deferred_coalescing_queue<int> sut;
+	std::vector<int>               log;
+	sut.push( 1, &record, &log, 10 );
+	sut.push( 2, &record, &log, 20 );
+
+	// Act
+	bool ret = sut.push( 1, &record, &log, 11 );
+
+	// Assert
+	EXPECT_FALSE( ret );
+	EXPECT_EQ( 2, sut.size() );
+	EXPECT_EQ( 1, sut.number_of_coalesced() );
+	sut.run_all();
+	EXPECT_EQ( ( std::vector<int> { 11, 20 } ), log );
+}
+
+TEST( Deferred_Coalescing_Queue, replace_by_different_function )
+{
+	// Arrange
+	deferred_coalescing_queue<std::string> sut;
+	std::vector<int>                       log;
+	sut.push( "a", &record, &log, 10 );
+
+	// Act
+	sut.push( "a", [&log]() { log.push_back( 99 ); } );
+	sut.push( "a", deferred_apply<void>( &record, &log, 12 ) );
+
+	// Assert
+	EXPECT_EQ( 1, sut.size() );
+	EXPECT_EQ( 2, sut.number_of_coalesced() );
+	EXPECT_TRUE( sut.run_one() );
+	EXPECT_FALSE( sut.run_one() );
+	EXPECT_EQ( ( std::vector<int> { 12 } ), log );
+}
+
+TEST( Deferred_Coalescing_Queue, push_again_after_run )
+{
+	// Arrange
+	deferred_coalescing_queue<int> sut;
+	std::vector<int>               log;
+	sut.push( 1, &record, &log, 10 );
+	sut.run_all();
+
+	// Act
+	bool ret = sut.push( 1, &record, &log, 11 );
+
+	// Assert
+	EXPECT_TRUE( ret );
+	EXPECT_TRUE( sut.contains( 1 ) );
+	sut.run_all();
+	EXPECT_EQ( ( std::vector<int> { 10, 11 } ), log );
+	EXPECT_FALSE( sut.contains( 1 ) );
+}
+
+TEST( Deferred_Coalescing_Queue, erase_pending_task )
+{
+	// Arrange
+	deferred_coalescing_queue<int> sut;
+	std::vector<int>               log;
+	sut.push( 1, &record, &log, 10 );
+	sut.push( 2, &record, &log, 20 );
+	sut.push( 3, &record, &log, 30 );
+
+	// Act
+	EXPECT_TRUE( sut.erase( 2 ) );
+	EXPECT_FALSE( sut.erase( 2 ) );
+	sut.push( 4, &record, &log, 40 );
+
+	// Assert
+	sut.run_all();
+	EXPECT_EQ( ( std::vector<int> { 10, 30, 40 } ), log );
+}
+
+TEST( Deferred_Coalescing_Queue, task_pushed_while_running_is_deferred )
+{
+	// Arrange
+	deferred_coalescing_queue<int> sut;
+	std::vector<int>               log;
+	sut.push( 1, [&sut, &log]() {
+		log.push_back( 1 );
+		sut.push( 1, &record, &log, 2 );
+	} );
+
+	// Act
+	size_t ret = sut.run_all();
+
+	// Assert
+	EXPECT_EQ( 1, ret );
+	EXPECT_EQ( 1, sut.size() );
+	sut.run_all();
+	EXPECT_EQ( ( std::vector<int> { 1, 2 } ), log );
+}
+
+TEST( Deferred_Coalescing_Queue, push_that_throws_leaves_no_pending_task )
+{
+	// Arrange
+	deferred_coalescing_queue<int> sut;
+	std::vector<int>               log;
+	sut.push( 1, &record, &log, 10 );
+	sut.push( 2, &record, &log, 20 );
+
+	// Act
+	EXPECT_THROW( sut.push( 1, &ignore_arg, throw_on_move() ), std::runtime_error );   // 置き換え
+	EXPECT_THROW( sut.push( 3, &ignore_arg, throw_on_move() ), std::runtime_error );   // 新しいキー
+	bool   ret1 = sut.push( 3, &record, &log, 30 );
+	size_t ret2 = sut.run_all();
+
+	// Assert
+	EXPECT_FALSE( sut.contains( 1 ) );
+	EXPECT_TRUE( ret1 );
+	EXPECT_EQ( 2, ret2 );
+	EXPECT_EQ( ( std::vector<int> { 20, 30 } ), log );
+	EXPECT_TRUE( sut.empty() );
+}
@@ -0,0 +1,151 @@
+/**
+ * @file test_deferred_epoch_reclaimer.cpp
+ * @author PFA03027@nifty.com
+ * @brief deferred_epoch_reclaimerのテスト
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "deferred_epoch_reclaimer.hpp"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+void count_up( std::atomic<int>* p_count )
+{
+	( *p_count )++;
+}
+
+struct shared_value {
+	explicit shared_value( int v )
+	  : v_( v )
+	{
+	}
+	~shared_value()
+	{
+		v_ = -1;
+	}
+
+	int v_;
+};
+
+}   // namespace
+
+TEST( Deferred_Epoch_Reclaimer, cleanup_without_readers_is_applied_by_collect )
+{
+	// Arrange
+	deferred_epoch_reclaimer sut;
+	std::atomic<int>         count( 0 );
+	sut.retire( &count_up, &count );
+
+	// Act
+	size_t num = sut.collect();
+
+	// Assert
+	EXPECT_EQ( 1, num );
+	EXPECT_EQ( 1, count.load() );
+	EXPECT_EQ( 0, sut.number_of_pending() );
+}
+
+TEST( Deferred_Epoch_Reclaimer, cleanup_waits_for_active_reader )
+{
+	// Arrange
+	deferred_epoch_reclaimer         sut;
+	deferred_epoch_reclaimer::reader rd( sut );
+	std::atomic<int>                 count( 0 );
+
+	// Act
+	{
+		deferred_epoch_reclaimer::guard g( rd );
+		sut.retire( &count_up, &count );
+		sut.collect();
+		sut.collect();
+
+		// Assert
+		EXPECT_EQ( 0, count.load() );
+	}
+	sut.collect();
+	EXPECT_EQ( 1, count.load() );
+}
+
+TEST( Deferred_Epoch_Reclaimer, inactive_reader_does_not_block )
+{
+	// Arrange
+	deferred_epoch_reclaimer         sut;
+	deferred_epoch_reclaimer::reader rd( sut );
+	std::atomic<int>                 count( 0 );
+	sut.retire( &count_up, &count );
+
+	// Act
+	sut.collect();   // リーダーがいないため、エポックが進み適用される
+	deferred_epoch_reclaimer::guard g( rd );
+	sut.retire( &count_up, &count );
+	sut.collect();
+
+	// Assert
+	EXPECT_EQ( 1, count.load() );
+	EXPECT_EQ( 1, sut.number_of_pending() );
+}
+
+TEST( Deferred_Epoch_Reclaimer, too_many_readers_throws )
+{
+	// Arrange
+	deferred_epoch_reclaimer::config cfg;
+	cfg.max_readers = 1;
+	deferred_epoch_reclaimer         sut( cfg );
+	deferred_epoch_reclaimer::reader rd( sut );
+
+	// Act
+	// Assert
+	EXPECT_THROW( deferred_epoch_reclaimer::reader rd2( sut ), deferred_epoch_reclaimer::too_many_readers );
+}
+
+TEST( Deferred_Epoch_Reclaimer, background_thread_reclaims_while_readers_run )
+{
+	// Arrange
+	deferred_epoch_reclaimer::config cfg;
+	cfg.use_background_thread = true;
+	cfg.collect_threshold     = 8;
+	std::atomic<int>                          num_of_broken( 0 );
+	std::atomic<bool>                         stop( false );
+	std::atomic<shared_value*>                p_current( new shared_value( 0 ) );
+	std::unique_ptr<deferred_epoch_reclaimer> up_sut( new deferred_epoch_reclaimer( cfg ) );
+
+	std::vector<std::thread> readers;
+	for ( int t = 0; t < 3; t++ ) {
+		readers.emplace_back( [&]() {
+			deferred_epoch_reclaimer::reader rd( *up_sut );
+			while ( !stop.load() ) {
+				deferred_epoch_reclaimer::guard g( rd );
+				if ( p_current.load( std::memory_order_acquire )->v_ < 0 ) {
+					num_of_broken++;
+				}
+			}
+		} );
+	}
+
+	// Act
+	for ( int i = 1; i <= 2000; i++ ) {
+		shared_value* p_old = p_current.exchange( new shared_value( i ) );
+		up_sut->retire( std::default_delete<shared_value>(), p_old );
+	}
+	stop.store( true );
+	for ( auto& th : readers ) {
+		th.join();
+	}
+	up_sut.reset();
+
+	// Assert
+	EXPECT_EQ( 0, num_of_broken.load() );
+	delete p_current.load();
+}
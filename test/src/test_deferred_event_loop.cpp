@@ -0,0 +1,199 @@
+/**
+ * @file test_deferred_event_loop.cpp
+ * @author PFA03027@nifty.com
+ * @brief deferred_event_loopのテスト
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "deferred_event_loop.hpp"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+void record( std::vector<int>* p_log, int v )
+{
+	p_log->push_back( v );
+}
+
+void on_readable( int fd, std::vector<uint32_t>* p_events, uint32_t events )
+{
+	uint64_t counter;
+	EXPECT_EQ( sizeof( counter ), ::read( fd, &counter, sizeof( counter ) ) );
+	p_events->push_back( events );
+}
+
+}   // namespace
+
+TEST( Deferred_Event_Loop, posted_tasks_run_in_order_in_one_iteration )
+{
+	// Arrange
+	deferred_event_loop sut;
+	std::vector<int>    log;
+	for ( int i = 0; i < 100; i++ ) {
+		sut.post( &record, &log, int( i ) );
+	}
+
+	// Act
+	size_t num = sut.run_once();
+
+	// Assert
+	EXPECT_EQ( 100, num );
+	ASSERT_EQ( 100, log.size() );
+	for ( int i = 0; i < 100; i++ ) {
+		EXPECT_EQ( i, log[i] );
+	}
+}
+
+TEST( Deferred_Event_Loop, max_batch_limits_tasks_per_iteration )
+{
+	// Arrange
+	deferred_event_loop::config cfg;
+	cfg.max_batch = 10;
+	deferred_event_loop sut( cfg );
+	std::vector<int>    log;
+	for ( int i = 0; i < 25; i++ ) {
+		sut.post( &record, &log, int( i ) );
+	}
+
+	// Act
+	size_t num1 = sut.run_once();
+	size_t num2 = sut.run_once();
+	size_t num3 = sut.run_once();
+
+	// Assert
+	EXPECT_EQ( 10, num1 );
+	EXPECT_EQ( 10, num2 );
+	EXPECT_EQ( 5, num3 );
+	EXPECT_EQ( 25, log.size() );
+}
+
+TEST( Deferred_Event_Loop, posts_from_other_threads_wake_up_loop )
+{
+	// Arrange
+	deferred_event_loop      sut;
+	std::atomic<int>         num_of_done( 0 );
+	std::vector<std::thread> producers;
+	std::thread              loop_thread( [&sut]() {
+		sut.run();
+	} );
+
+	// Act
+	for ( int t = 0; t < 4; t++ ) {
+		producers.emplace_back( [&sut, &num_of_done]() {
+			for ( int i = 0; i < 1000; i++ ) {
+				sut.post( [&sut, &num_of_done]() {
+					EXPECT_TRUE( sut.running_in_this_thread() );
+					num_of_done++;
+				} );
+			}
+		} );
+	}
+	for ( auto& th : producers ) {
+		th.join();
+	}
+	sut.post( [&sut]() {
+		sut.stop();
+	} );
+	loop_thread.join();
+
+	// Assert
+	EXPECT_EQ( 4000, num_of_done.load() );
+	EXPECT_FALSE( sut.running_in_this_thread() );
+}
+
+TEST( Deferred_Event_Loop, stop_from_other_thread )
+{
+	// Arrange
+	deferred_event_loop sut;
+	std::thread         loop_thread( [&sut]() {
+		sut.run();
+	} );
+
+	// Act
+	std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+	sut.stop();
+	loop_thread.join();
+
+	// Assert
+	SUCCEED();
+}
+
+TEST( Deferred_Event_Loop, callback_of_registered_fd_receives_ready_events )
+{
+	// Arrange
+	deferred_event_loop   sut;
+	std::vector<uint32_t> events;
+	int                   fd    = ::eventfd( 0, EFD_NONBLOCK );
+	uint64_t              one   = 1;
+	ASSERT_LE( 0, fd );
+	sut.add_fd( fd, EPOLLIN, &on_readable, int( fd ), &events );
+
+	// Act
+	size_t num1 = sut.run_once();
+	ASSERT_EQ( sizeof( one ), ::write( fd, &one, sizeof( one ) ) );
+	size_t num2 = sut.run_once();
+	ASSERT_EQ( sizeof( one ), ::write( fd, &one, sizeof( one ) ) );
+	size_t num3 = sut.run_once();
+
+	// Assert
+	EXPECT_EQ( 0, num1 );
+	EXPECT_EQ( 1, num2 );
+	EXPECT_EQ( 1, num3 );
+	ASSERT_EQ( 2, events.size() );
+	EXPECT_NE( 0, events[0] & EPOLLIN );
+	EXPECT_TRUE( sut.remove_fd( fd ) );
+	EXPECT_FALSE( sut.remove_fd( fd ) );
+	::close( fd );
+}
+
+TEST( Deferred_Event_Loop, callback_can_remove_its_own_fd )
+{
+	// Arrange
+	deferred_event_loop sut;
+	int                 fd       = ::eventfd( 1, EFD_NONBLOCK );
+	int                 num_call = 0;
+	ASSERT_LE( 0, fd );
+	sut.add_fd( fd, EPOLLIN, [&sut, &num_call, fd]( uint32_t ) {
+		num_call++;
+		sut.remove_fd( fd );
+	} );
+
+	// Act
+	sut.run_once();
+	sut.run_once();
+
+	// Assert
+	EXPECT_EQ( 1, num_call );
+	EXPECT_EQ( 0, sut.number_of_fds() );
+	::close( fd );
+}
+
+TEST( Deferred_Event_Loop, add_same_fd_twice_throws )
+{
+	// Arrange
+	deferred_event_loop sut;
+	int                 fd = ::eventfd( 0, EFD_NONBLOCK );
+	ASSERT_LE( 0, fd );
+	sut.add_fd( fd, EPOLLIN, []( uint32_t ) {} );
+
+	// Act
+	// Assert
+	EXPECT_THROW( sut.add_fd( fd, EPOLLIN, []( uint32_t ) {} ), std::system_error );
+	EXPECT_EQ( 1, sut.number_of_fds() );
+	sut.remove_fd( fd );
+	::close( fd );
+}
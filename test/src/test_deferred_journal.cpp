@@ -0,0 +1,208 @@
+/**
+ * @file test_deferred_journal.cpp
+ * @author PFA03027@nifty.com
+ * @brief deferred_journalのテスト
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "deferred_journal.hpp"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+struct kv_command {
+	int    key_;
+	double value_;
+};
+
+std::vector<kv_command> g_applied;
+
+void set_value( int key, double value )
+{
+	g_applied.push_back( kv_command { key, value } );
+}
+
+int erase_key( int key )
+{
+	g_applied.push_back( kv_command { key, -1.0 } );
+	return key;
+}
+
+class Deferred_Journal : public ::testing::Test {
+protected:
+	void SetUp( void ) override
+	{
+		char tmpl[] = "/tmp/deferred_journal_test_XXXXXX";
+		int  fd     = mkstemp( tmpl );
+		ASSERT_GE( fd, 0 );
+		close( fd );
+		unlink( tmpl );
+		path_ = tmpl;
+		g_applied.clear();
+	}
+
+	void TearDown( void ) override
+	{
+		unlink( path_.c_str() );
+	}
+
+	void register_functions( deferred_journal& jr )
+	{
+		jr.register_function( 1, &set_value );
+		jr.register_function( 2, &erase_key );
+	}
+
+	std::string path_;
+};
+
+}   // namespace
+
+TEST_F( Deferred_Journal, append_then_replay_after_reopen )
+{
+	// Arrange
+	{
+		deferred_journal jr( path_.c_str() );
+		register_functions( jr );
+		jr.append( 1, 10, 3.5 );
+		jr.append( 2, 20 );
+		jr.append( 1, 30, 4.5 );
+		jr.sync();
+		EXPECT_EQ( 3, jr.number_of_records() );
+	}
+
+	// Act
+	deferred_journal sut( path_.c_str() );
+	register_functions( sut );
+	size_t ret = sut.replay();
+
+	// Assert
+	EXPECT_EQ( 3, ret );
+	EXPECT_EQ( 3, sut.number_of_records() );
+	ASSERT_EQ( 3, g_applied.size() );
+	EXPECT_EQ( 10, g_applied[0].key_ );
+	EXPECT_EQ( 3.5, g_applied[0].value_ );
+	EXPECT_EQ( 20, g_applied[1].key_ );
+	EXPECT_EQ( -1.0, g_applied[1].value_ );
+	EXPECT_EQ( 30, g_applied[2].key_ );
+	EXPECT_EQ( 4.5, g_applied[2].value_ );
+}
+
+TEST_F( Deferred_Journal, replay_into_sink_and_functor )
+{
+	// Arrange
+	int              sum = 0;
+	deferred_journal sut( path_.c_str() );
+	sut.register_function_as<int, int>( 3, [&sum]( int a, int b ) { sum += a * b; } );
+	sut.append( 3, 2, 3 );
+	sut.append( 3, 4, 5 );
+
+	// Act
+	std::vector<deferred_apply<void>> calls;
+	size_t                            ret = sut.replay( [&calls]( deferred_apply<void>&& da ) { calls.push_back( std::move( da ) ); } );
+	for ( auto& da : calls ) {
+		da.apply();
+	}
+
+	// Assert
+	EXPECT_EQ( 2, ret );
+	EXPECT_EQ( 26, sum );
+}
+
+TEST_F( Deferred_Journal, grow_file )
+{
+	// Arrange
+	{
+		deferred_journal jr( path_.c_str(), 4096, 100 );
+		register_functions( jr );
+		for ( int i = 0; i < 1000; i++ ) {
+			jr.append( 1, i, static_cast<double>( i ) );
+		}
+	}
+
+	// Act
+	deferred_journal sut( path_.c_str() );
+	register_functions( sut );
+	size_t ret = sut.replay();
+
+	// Assert
+	EXPECT_EQ( 1000, ret );
+	ASSERT_EQ( 1000, g_applied.size() );
+	EXPECT_EQ( 999, g_applied[999].key_ );
+}
+
+TEST_F( Deferred_Journal, torn_record_is_discarded )
+{
+	// Arrange
+	size_t used = 0;
+	{
+		deferred_journal jr( path_.c_str() );
+		register_functions( jr );
+		jr.append( 1, 1, 1.0 );
+		jr.append( 1, 2, 2.0 );
+		used = jr.used_bytes();
+	}
+	// 2つ目のレコードのペイロードを破壊する
+	FILE* fp = fopen( path_.c_str(), "r+b" );
+	ASSERT_NE( nullptr, fp );
+	fseek( fp, static_cast<long>( used - 6 ), SEEK_SET );   // ヘッダ24バイト+ペイロード12バイトを8バイト境界に切り上げたレコードの、ペイロードの末尾付近
+	fputc( 0x5A, fp );
+	fclose( fp );
+
+	// Act
+	deferred_journal sut( path_.c_str() );
+	register_functions( sut );
+	size_t ret = sut.replay();
+	sut.append( 1, 3, 3.0 );
+
+	// Assert
+	EXPECT_EQ( 1, ret );
+	EXPECT_EQ( 2, sut.number_of_records() );
+}
+
+TEST_F( Deferred_Journal, reset_discards_records )
+{
+	// Arrange
+	{
+		deferred_journal jr( path_.c_str() );
+		register_functions( jr );
+		jr.append( 1, 1, 1.0 );
+		jr.append( 1, 2, 2.0 );
+		jr.reset();
+		jr.append( 2, 3 );
+	}
+
+	// Act
+	deferred_journal sut( path_.c_str() );
+	register_functions( sut );
+	size_t ret = sut.replay();
+
+	// Assert
+	EXPECT_EQ( 1, ret );
+	ASSERT_EQ( 1, g_applied.size() );
+	EXPECT_EQ( 3, g_applied[0].key_ );
+}
+
+TEST_F( Deferred_Journal, append_with_wrong_arguments_then_throw )
+{
+	// Arrange
+	deferred_journal sut( path_.c_str() );
+	register_functions( sut );
+
+	// Act
+	// Assert
+	EXPECT_THROW( sut.append( 1, 1, 1.0f ), std::invalid_argument );
+	EXPECT_THROW( sut.append( 9, 1 ), std::invalid_argument );
+	EXPECT_EQ( 0, sut.number_of_records() );
+}
@@ -0,0 +1,167 @@
+/**
+ * @file test_deferred_memoizer.cpp
+ * @author PFA03027@nifty.com
+ * @brief deferred_memoizerのテスト
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "deferred_memoizer.hpp"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+struct counting_concat {
+	std::string operator()( int n, std::string s )
+	{
+		( *p_count_ )++;
+		return s + std::to_string( n );
+	}
+
+	std::atomic<int>* p_count_;
+};
+
+using memoizer_t = deferred_memoizer<counting_concat, deferred_applying_arguments<int&&, std::string&&>>;
+
+}   // namespace
+
+TEST( Deferred_Tuple_Hash, equal_tuples_have_equal_hash )
+{
+	// Arrange
+	deferred_tuple_hash<std::tuple<int, std::string>> sut;
+
+	// Act
+	size_t h1 = sut( std::make_tuple( 1, std::string( "abc" ) ) );
+	size_t h2 = sut( std::make_tuple( 1, std::string( "abc" ) ) );
+	size_t h3 = sut( std::make_tuple( 2, std::string( "abc" ) ) );
+
+	// Assert
+	EXPECT_EQ( h1, h2 );
+	EXPECT_NE( h1, h3 );
+}
+
+TEST( Deferred_Memoizer, hit_for_equal_arguments )
+{
+	// Arrange
+	std::atomic<int> count( 0 );
+	memoizer_t       sut( counting_concat { &count } );
+
+	// Act
+	std::string r1 = sut( 1, std::string( "a" ) );
+	std::string r2 = sut.apply( make_deferred_applying_values( 1, std::string( "a" ) ) );
+	std::string r3 = sut( 2, std::string( "a" ) );
+
+	// Assert
+	EXPECT_EQ( "a1", r1 );
+	EXPECT_EQ( "a1", r2 );
+	EXPECT_EQ( "a2", r3 );
+	EXPECT_EQ( 2, count.load() );
+	EXPECT_EQ( 1, sut.number_of_hits() );
+	EXPECT_EQ( 2, sut.number_of_misses() );
+	EXPECT_EQ( 2, sut.size() );
+}
+
+TEST( Deferred_Memoizer, lru_evicts_least_recently_used )
+{
+	// Arrange
+	std::atomic<int>   count( 0 );
+	memoizer_t::config cfg;
+	cfg.capacity         = 2;
+	cfg.number_of_shards = 1;
+	memoizer_t sut( counting_concat { &count }, cfg );
+	sut( 1, std::string( "a" ) );
+	sut( 2, std::string( "a" ) );
+	sut( 1, std::string( "a" ) );   // 1が最も新しくなる
+
+	// Act
+	sut( 3, std::string( "a" ) );   // 2を追い出す
+
+	// Assert
+	EXPECT_EQ( 2, sut.size() );
+	count = 0;
+	sut( 1, std::string( "a" ) );
+	EXPECT_EQ( 0, count.load() );
+	sut( 2, std::string( "a" ) );
+	EXPECT_EQ( 1, count.load() );
+}
+
+TEST( Deferred_Memoizer, fifo_evicts_oldest_entry )
+{
+	// Arrange
+	std::atomic<int>   count( 0 );
+	memoizer_t::config cfg;
+	cfg.capacity         = 2;
+	cfg.number_of_shards = 1;
+	cfg.policy           = memoize_eviction_policy::fifo;
+	memoizer_t sut( counting_concat { &count }, cfg );
+	sut( 1, std::string( "a" ) );
+	sut( 2, std::string( "a" ) );
+	sut( 1, std::string( "a" ) );   // ヒットしても順序は変わらない
+
+	// Act
+	sut( 3, std::string( "a" ) );   // 1を追い出す
+
+	// Assert
+	count = 0;
+	sut( 2, std::string( "a" ) );
+	EXPECT_EQ( 0, count.load() );
+	sut( 1, std::string( "a" ) );
+	EXPECT_EQ( 1, count.load() );
+}
+
+TEST( Deferred_Memoizer, expired_entry_is_recomputed )
+{
+	// Arrange
+	std::atomic<int>   count( 0 );
+	memoizer_t::config cfg;
+	cfg.max_age = std::chrono::milliseconds( 10 );
+	memoizer_t sut( counting_concat { &count }, cfg );
+	sut( 1, std::string( "a" ) );
+
+	// Act
+	std::this_thread::sleep_for( std::chrono::milliseconds( 30 ) );
+	sut( 1, std::string( "a" ) );
+
+	// Assert
+	EXPECT_EQ( 2, count.load() );
+}
+
+TEST( Deferred_Memoizer, concurrent_lookups )
+{
+	// Arrange
+	std::atomic<int>         count( 0 );
+	memoizer_t               sut( counting_concat { &count } );
+	std::atomic<int>         num_of_wrong( 0 );
+	std::vector<std::thread> threads;
+
+	// Act
+	for ( int t = 0; t < 4; t++ ) {
+		threads.emplace_back( [&sut, &num_of_wrong]() {
+			for ( int i = 0; i < 1000; i++ ) {
+				int n = i % 50;
+				if ( sut( static_cast<int>( n ), std::string( "k" ) ) != "k" + std::to_string( n ) ) {
+					num_of_wrong++;
+				}
+			}
+		} );
+	}
+	for ( auto& th : threads ) {
+		th.join();
+	}
+
+	// Assert
+	EXPECT_EQ( 0, num_of_wrong.load() );
+	EXPECT_EQ( 50, sut.size() );
+	EXPECT_EQ( 4000, sut.number_of_hits() + sut.number_of_misses() );
+}
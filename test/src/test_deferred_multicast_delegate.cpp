@@ -0,0 +1,286 @@
+/**
+ * @file test_deferred_multicast_delegate.cpp
+ * @author PFA03027@nifty.com
+ * @brief deferred_multicast_delegateのテスト
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "deferred_multicast_delegate.hpp"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+void record( std::vector<int>* p_log, int v )
+{
+	p_log->push_back( v );
+}
+
+void append_text( std::vector<std::string>* p_log, std::string s )
+{
+	p_log->push_back( std::move( s ) );
+}
+
+/**
+ * @brief コピーされた回数を数える引数
+ */
+struct copy_counter {
+	explicit copy_counter( int* p_num_of_copies )
+	  : p_num_of_copies_( p_num_of_copies )
+	{
+	}
+
+	copy_counter( const copy_counter& orig )
+	  : p_num_of_copies_( orig.p_num_of_copies_ )
+	{
+		( *p_num_of_copies_ )++;
+	}
+
+	copy_counter( copy_counter&& ) = default;
+
+	int* p_num_of_copies_;
+};
+
+void count_call( int* p_num_of_calls, const copy_counter& )
+{
+	( *p_num_of_calls )++;
+}
+
+void read_held_value( std::vector<int>* p_log, const std::unique_ptr<int>& up_value )
+{
+	p_log->push_back( *up_value );
+}
+
+}   // namespace
+
+TEST( Deferred_Multicast_Delegate, invoke_all_in_subscription_order )
+{
+	// Arrange
+	deferred_multicast_delegate sut;
+	std::vector<int>            log;
+	for ( int i = 0; i < 10; i++ ) {
+		sut.subscribe( &record, &log, int( i ) );
+	}
+
+	// Act
+	sut.invoke_all();
+
+	// Assert
+	ASSERT_EQ( 10, log.size() );
+	for ( int i = 0; i < 10; i++ ) {
+		EXPECT_EQ( i, log[i] );
+	}
+}
+
+TEST( Deferred_Multicast_Delegate, held_arguments_are_passed_at_each_invocation )
+{
+	// Arrange
+	deferred_multicast_delegate sut;
+	std::vector<std::string>    log;
+	sut.subscribe( &append_text, &log, std::string( "abc" ) );
+
+	// Act
+	sut.invoke_all();
+	sut.invoke_all();
+
+	// Assert
+	ASSERT_EQ( 2, log.size() );
+	EXPECT_EQ( "abc", log[0] );
+	EXPECT_EQ( "abc", log[1] );
+}
+
+TEST( Deferred_Multicast_Delegate, unsubscribe_removes_only_the_subscriber )
+{
+	// Arrange
+	deferred_multicast_delegate         sut;
+	std::vector<int>                    log;
+	deferred_multicast_delegate::handle h0 = sut.subscribe( &record, &log, 0 );
+	deferred_multicast_delegate::handle h1 = sut.subscribe( &record, &log, 1 );
+	deferred_multicast_delegate::handle h2 = sut.subscribe( &record, &log, 2 );
+
+	// Act
+	bool ret1 = sut.unsubscribe( h1 );
+	bool ret2 = sut.unsubscribe( h1 );
+	sut.invoke_all();
+
+	// Assert
+	EXPECT_TRUE( ret1 );
+	EXPECT_FALSE( ret2 );
+	EXPECT_TRUE( sut.is_subscribed( h0 ) );
+	EXPECT_FALSE( sut.is_subscribed( h1 ) );
+	EXPECT_TRUE( sut.is_subscribed( h2 ) );
+	EXPECT_EQ( 2, sut.size() );
+	ASSERT_EQ( 2, log.size() );
+	EXPECT_EQ( 0, log[0] );
+	EXPECT_EQ( 2, log[1] );
+}
+
+TEST( Deferred_Multicast_Delegate, handles_remain_valid_across_growth_and_compaction )
+{
+	// Arrange
+	deferred_multicast_delegate                      sut;
+	std::vector<int>                                 log;
+	std::vector<deferred_multicast_delegate::handle> handles;
+	for ( int i = 0; i < 1000; i++ ) {
+		handles.push_back( sut.subscribe( &record, &log, int( i ) ) );
+	}
+	size_t used_before = sut.arena_bytes_used();
+
+	// Act
+	for ( int i = 0; i < 1000; i++ ) {
+		if ( ( i % 10 ) != 0 ) {
+			sut.unsubscribe( handles[i] );
+		}
+	}
+	sut.invoke_all();
+
+	// Assert
+	EXPECT_LT( sut.arena_bytes_used(), used_before );
+	EXPECT_EQ( 100, sut.size() );
+	ASSERT_EQ( 100, log.size() );
+	for ( int i = 0; i < 100; i++ ) {
+		EXPECT_EQ( i * 10, log[i] );
+		EXPECT_TRUE( sut.unsubscribe( handles[i * 10] ) );
+	}
+	EXPECT_TRUE( sut.empty() );
+}
+
+TEST( Deferred_Multicast_Delegate, subscriber_can_unsubscribe_during_invoke_all )
+{
+	// Arrange
+	deferred_multicast_delegate         sut;
+	std::vector<int>                    log;
+	deferred_multicast_delegate::handle h_self;
+	deferred_multicast_delegate::handle h_next;
+	h_self = sut.subscribe( [&sut, &log, &h_self, &h_next]() {
+		log.push_back( -1 );
+		sut.unsubscribe( h_self );
+		sut.unsubscribe( h_next );
+	} );
+	h_next = sut.subscribe( &record, &log, 1 );
+	sut.subscribe( &record, &log, 2 );
+
+	// Act
+	sut.invoke_all();
+	sut.invoke_all();
+
+	// Assert
+	std::vector<int> expected { -1, 2, 2 };
+	EXPECT_EQ( expected, log );
+	EXPECT_EQ( 1, sut.size() );
+}
+
+TEST( Deferred_Multicast_Delegate, held_values_are_destructed_by_unsubscribe )
+{
+	// Arrange
+	deferred_multicast_delegate         sut;
+	std::shared_ptr<int>                sp_value = std::make_shared<int>( 1 );
+	deferred_multicast_delegate::handle h        = sut.subscribe( []( std::shared_ptr<int> ) {}, std::shared_ptr<int>( sp_value ) );
+	for ( int i = 0; i < 100; i++ ) {
+		sut.subscribe( []( std::shared_ptr<int> ) {}, std::shared_ptr<int>( sp_value ) );   // アリーナを拡張させる
+	}
+	EXPECT_EQ( 102, sp_value.use_count() );
+
+	// Act
+	sut.unsubscribe( h );
+
+	// Assert
+	EXPECT_EQ( 101, sp_value.use_count() );
+}
+
+TEST( Deferred_Multicast_Delegate, one_shot_subscriber_can_use_its_captures_after_unsubscribe )
+{
+	// Arrange
+	deferred_multicast_delegate         sut;
+	std::vector<std::string>            log;
+	deferred_multicast_delegate::handle h;
+	std::string                         text( "a long text that does not fit in the small string buffer" );
+	h = sut.subscribe( [&sut, &log, &h, text]() {
+		sut.unsubscribe( h );
+		log.push_back( text );   // 解除後も、実行中の購読者は破棄されていない
+	} );
+
+	// Act
+	sut.invoke_all();
+	sut.invoke_all();
+
+	// Assert
+	ASSERT_EQ( 1, log.size() );
+	EXPECT_EQ( text, log[0] );
+	EXPECT_TRUE( sut.empty() );
+}
+
+TEST( Deferred_Multicast_Delegate, subscribe_during_invoke_all_is_called_from_next_invocation )
+{
+	// Arrange
+	deferred_multicast_delegate sut;
+	std::vector<int>            log;
+	bool                        is_first = true;
+	sut.subscribe( [&sut, &log, &is_first]() {
+		log.push_back( -1 );
+		if ( !is_first ) return;
+		is_first = false;
+		for ( int i = 0; i < 100; i++ ) {
+			sut.subscribe( &record, &log, int( i ) );   // アリーナの拡張が必要となる数を追加する
+		}
+	} );
+
+	// Act
+	sut.invoke_all();
+	size_t num_of_first = log.size();
+	sut.invoke_all();
+
+	// Assert
+	EXPECT_EQ( 1, num_of_first );
+	EXPECT_EQ( 101, sut.size() );
+	ASSERT_EQ( 102, log.size() );
+	for ( int i = 0; i < 100; i++ ) {
+		EXPECT_EQ( i, log[i + 2] );
+	}
+}
+
+TEST( Deferred_Multicast_Delegate, held_arguments_are_not_copied_at_each_invocation )
+{
+	// Arrange
+	deferred_multicast_delegate sut;
+	std::vector<int>            log;
+	int                         num_of_copies = 0;
+	int                         num_of_calls  = 0;
+	sut.subscribe( &count_call, &num_of_calls, copy_counter( &num_of_copies ) );
+	for ( int i = 0; i < 100; i++ ) {
+		sut.subscribe( &record, &log, int( i ) );   // アリーナを拡張させ、ムーブで再配置させる
+	}
+
+	// Act
+	for ( int i = 0; i < 10; i++ ) {
+		sut.invoke_all();
+	}
+
+	// Assert
+	EXPECT_EQ( 0, num_of_copies );
+	EXPECT_EQ( 10, num_of_calls );
+	EXPECT_EQ( 1000, log.size() );
+}
+
+TEST( Deferred_Multicast_Delegate, move_only_argument_is_passed_as_lvalue )
+{
+	// Arrange
+	deferred_multicast_delegate sut;
+	std::vector<int>            log;
+	sut.subscribe( &read_held_value, &log, std::unique_ptr<int>( new int( 7 ) ) );
+
+	// Act
+	sut.invoke_all();
+	sut.invoke_all();
+
+	// Assert
+	EXPECT_EQ( ( std::vector<int> { 7, 7 } ), log );
+}
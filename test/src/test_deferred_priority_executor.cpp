@@ -0,0 +1,204 @@
+/**
+ * @file test_deferred_priority_executor.cpp
+ * @author PFA03027@nifty.com
+ * @brief deferred_priority_executorのテスト
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "deferred_priority_executor.hpp"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+class execution_recorder {
+public:
+	void record( int x )
+	{
+		std::lock_guard<std::mutex> lk( mtx_ );
+		order_.push_back( x );
+	}
+
+	std::vector<int> get( void )
+	{
+		std::lock_guard<std::mutex> lk( mtx_ );
+		return order_;
+	}
+
+private:
+	std::mutex       mtx_;
+	std::vector<int> order_;
+};
+
+void record_value( execution_recorder& rec, int x )
+{
+	rec.record( x );
+}
+
+void wait_gate( std::shared_future<void> gate )
+{
+	gate.wait();
+}
+
+}   // namespace
+
+TEST( Deferred_Priority_Executor, strict_policy_runs_high_priority_first )
+{
+	// Arrange
+	deferred_priority_executor<3>::config cfg;
+	cfg.starvation_threshold = std::chrono::steady_clock::duration::zero();
+	deferred_priority_executor<3> sut( 1, cfg );
+	execution_recorder            rec;
+	std::promise<void>            gate;
+	sut.post( 0, &wait_gate, gate.get_future().share() );   // ワーカーを止めておく
+
+	// Act
+	sut.post( 2, &record_value, std::ref( rec ), 20 );
+	sut.post( 1, &record_value, std::ref( rec ), 10 );
+	sut.post( 2, &record_value, std::ref( rec ), 21 );
+	sut.post( 0, &record_value, std::ref( rec ), 0 );
+	sut.post( 1, &record_value, std::ref( rec ), 11 );
+	gate.set_value();
+	sut.shutdown();
+
+	// Assert
+	std::vector<int> expect { 0, 10, 11, 20, 21 };
+	EXPECT_EQ( expect, rec.get() );
+}
+
+TEST( Deferred_Priority_Executor, weighted_policy )
+{
+	// Arrange
+	deferred_priority_executor<2>::config cfg;
+	cfg.policy               = priority_dequeue_policy::weighted;
+	cfg.weights[0]           = 2;
+	cfg.weights[1]           = 1;
+	cfg.starvation_threshold = std::chrono::steady_clock::duration::zero();
+	deferred_priority_executor<2> sut( 1, cfg );
+	execution_recorder            rec;
+	std::promise<void>            gate;
+	sut.post( 0, &wait_gate, gate.get_future().share() );   // ワーカーを止めておく。レーン0の持ち分を1つ消費する
+
+	// Act
+	for ( int i = 0; i < 4; i++ ) {
+		sut.post( 0, &record_value, std::ref( rec ), static_cast<int>( i ) );
+		sut.post( 1, &record_value, std::ref( rec ), 100 + i );
+	}
+	gate.set_value();
+	sut.shutdown();
+
+	// Assert
+	std::vector<int> expect { 0, 100, 1, 2, 101, 3, 102, 103 };
+	EXPECT_EQ( expect, rec.get() );
+}
+
+TEST( Deferred_Priority_Executor, starvation_protection )
+{
+	// Arrange
+	deferred_priority_executor<2>::config cfg;
+	cfg.starvation_threshold = std::chrono::milliseconds( 1 );
+	deferred_priority_executor<2> sut( 1, cfg );
+	execution_recorder            rec;
+	std::promise<void>            gate;
+	sut.post( 0, &wait_gate, gate.get_future().share() );   // ワーカーを止めておく
+	sut.post( 1, &record_value, std::ref( rec ), 100 );
+	std::this_thread::sleep_for( std::chrono::milliseconds( 5 ) );
+
+	// Act
+	for ( int i = 0; i < 3; i++ ) {
+		sut.post( 0, &record_value, std::ref( rec ), static_cast<int>( i ) );
+	}
+	gate.set_value();
+	sut.shutdown();
+
+	// Assert
+	std::vector<int> expect { 100, 0, 1, 2 };
+	EXPECT_EQ( expect, rec.get() );
+}
+
+TEST( Deferred_Priority_Executor, many_workers_run_all_tasks )
+{
+	// Arrange
+	struct local {
+		static void add( std::atomic<int>& counter, int x )
+		{
+			counter.fetch_add( x );
+		}
+	};
+	std::atomic<int> counter( 0 );
+
+	// Act
+	{
+		deferred_priority_executor<3> sut( 4 );
+		std::vector<std::thread>      producers;
+		for ( size_t lane = 0; lane < 3; lane++ ) {
+			producers.emplace_back( [&sut, &counter, lane]() {
+				for ( int i = 0; i < 1000; i++ ) {
+					sut.post( lane, &local::add, std::ref( counter ), 1 );
+				}
+			} );
+		}
+		for ( auto& t : producers ) {
+			t.join();
+		}
+	}   // destructor waits all tasks
+
+	// Assert
+	EXPECT_EQ( 3000, counter.load() );
+}
+
+TEST( Deferred_Priority_Executor, post_after_shutdown_runs_inline )
+{
+	// Arrange
+	deferred_priority_executor<2> sut( 2 );
+	execution_recorder            rec;
+	sut.shutdown();
+	std::thread::id               executed_on;
+
+	// Act
+	sut.post( 0, &record_value, std::ref( rec ), 1 );
+	sut.post( deferred_apply<void>( [&executed_on]() {
+		executed_on = std::this_thread::get_id();
+	} ) );
+
+	// Assert
+	EXPECT_EQ( ( std::vector<int> { 1 } ), rec.get() );
+	EXPECT_EQ( std::this_thread::get_id(), executed_on );
+}
+
+TEST( Deferred_Priority_Executor, post_racing_with_shutdown_is_not_lost )
+{
+	// Arrange
+	std::atomic<int>              counter( 0 );
+	deferred_priority_executor<2> sut( 2 );
+	std::vector<std::thread>      producers;
+
+	// Act
+	for ( size_t lane = 0; lane < 2; lane++ ) {
+		producers.emplace_back( [&sut, &counter, lane]() {
+			for ( int i = 0; i < 10000; i++ ) {
+				sut.post( lane, deferred_apply<void>( [&counter]() {
+					counter.fetch_add( 1 );
+				} ) );
+			}
+		} );
+	}
+	sut.shutdown();
+	for ( auto& t : producers ) {
+		t.join();
+	}
+
+	// Assert
+	EXPECT_EQ( 20000, counter.load() );
+}
@@ -0,0 +1,190 @@
+/**
+ * @file test_deferred_sharded_executor.cpp
+ * @author PFA03027@nifty.com
+ * @brief deferred_sharded_executorのテスト
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "deferred_sharded_executor.hpp"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+deferred_sharded_executor::config make_config( size_t num_of_workers, size_t ring_capacity = 256 )
+{
+	deferred_sharded_executor::config cfg;
+	cfg.num_of_workers = num_of_workers;
+	cfg.ring_capacity  = ring_capacity;
+	return cfg;
+}
+
+void wait_until( const std::atomic<int>& count, int expected )
+{
+	while ( count.load() < expected ) {
+		std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+	}
+}
+
+/**
+ * @brief シャード毎の状態。担当するワーカーだけが更新する
+ */
+struct shard_state {
+	shard_state( void )
+	  : log_()
+	  , num_of_wrong_core_( 0 )
+	{
+	}
+
+	std::vector<int> log_;
+	int              num_of_wrong_core_;
+};
+
+}   // namespace
+
+TEST( Deferred_Sharded_Executor, post_to_runs_task_on_the_core )
+{
+	// Arrange
+	deferred_sharded_executor sut( make_config( 4 ) );
+	std::vector<shard_state>  shards( 4 );
+	std::atomic<int>          num_of_done( 0 );
+
+	// Act
+	for ( int i = 0; i < 400; i++ ) {
+		size_t core = static_cast<size_t>( i ) % 4;
+		sut.post_to( core, [&sut, &shards, &num_of_done, core, i]() {
+			if ( sut.current_core() != core ) shards[core].num_of_wrong_core_++;
+			shards[core].log_.push_back( i );
+			num_of_done++;
+		} );
+	}
+	wait_until( num_of_done, 400 );
+
+	// Assert
+	for ( size_t core = 0; core < 4; core++ ) {
+		EXPECT_EQ( 0, shards[core].num_of_wrong_core_ );
+		ASSERT_EQ( 100, shards[core].log_.size() );
+		for ( int i = 0; i < 100; i++ ) {
+			EXPECT_EQ( i * 4 + static_cast<int>( core ), shards[core].log_[i] );
+		}
+	}
+}
+
+TEST( Deferred_Sharded_Executor, cross_core_posts_keep_order_even_if_ring_is_full )
+{
+	// Arrange
+	deferred_sharded_executor sut( make_config( 2, 4 ) );   // 小さいリングで、オーバーフローキューを使用させる
+	shard_state               dest;
+	std::atomic<int>          num_of_done( 0 );
+
+	// Act
+	sut.post_to( 0, [&sut, &dest, &num_of_done]() {
+		for ( int i = 0; i < 1000; i++ ) {
+			sut.post_to( 1, [&sut, &dest, &num_of_done, i]() {
+				if ( sut.current_core() != 1 ) dest.num_of_wrong_core_++;
+				dest.log_.push_back( i );
+				num_of_done++;
+			} );
+		}
+	} );
+	wait_until( num_of_done, 1000 );
+
+	// Assert
+	EXPECT_EQ( 0, dest.num_of_wrong_core_ );
+	ASSERT_EQ( 1000, dest.log_.size() );
+	for ( int i = 0; i < 1000; i++ ) {
+		EXPECT_EQ( i, dest.log_[i] );
+	}
+}
+
+TEST( Deferred_Sharded_Executor, post_from_worker_runs_on_the_same_core )
+{
+	// Arrange
+	deferred_sharded_executor sut( make_config( 3 ) );
+	std::atomic<int>          num_of_done( 0 );
+	std::atomic<int>          num_of_wrong_core( 0 );
+
+	// Act
+	sut.post_to( 2, [&sut, &num_of_done, &num_of_wrong_core]() {
+		sut.post( deferred_apply<void>( [&sut, &num_of_done, &num_of_wrong_core]() {
+			if ( sut.current_core() != 2 ) num_of_wrong_core++;
+			num_of_done++;
+		} ) );
+	} );
+	wait_until( num_of_done, 1 );
+
+	// Assert
+	EXPECT_EQ( 0, num_of_wrong_core.load() );
+	EXPECT_TRUE( sut.current_core() == deferred_sharded_executor::npos );
+}
+
+TEST( Deferred_Sharded_Executor, shutdown_runs_all_pending_tasks )
+{
+	// Arrange
+	deferred_sharded_executor sut( make_config( 4, 8 ) );
+	std::atomic<int>          num_of_done( 0 );
+
+	// Act
+	for ( size_t core = 0; core < 4; core++ ) {
+		sut.post_to( core, [&sut, &num_of_done, core]() {
+			for ( int i = 0; i < 100; i++ ) {
+				sut.post_to( core + 1, [&num_of_done]() {
+					num_of_done++;
+				} );
+			}
+		} );
+	}
+	sut.shutdown();
+
+	// Assert
+	EXPECT_EQ( 400, num_of_done.load() );
+}
+
+TEST( Deferred_Sharded_Executor, shutdown_from_worker_only_requests_stop )
+{
+	// Arrange
+	deferred_sharded_executor sut( make_config( 2 ) );
+	std::atomic<int>          num_of_done( 0 );
+	std::atomic<int>          num_of_returned( 0 );
+
+	// Act
+	sut.post_to( 0, [&sut, &num_of_done, &num_of_returned]() {
+		sut.post_to( 1, [&num_of_done]() {
+			num_of_done++;
+		} );
+		sut.shutdown();   // 自身をjoinせずに戻ること
+		num_of_returned++;
+	} );
+	wait_until( num_of_returned, 1 );
+	sut.shutdown();
+
+	// Assert
+	EXPECT_EQ( 1, num_of_done.load() );
+	EXPECT_EQ( 1, num_of_returned.load() );
+}
+
+TEST( Deferred_Sharded_Executor, workers_are_assigned_to_available_cpus )
+{
+	// Arrange
+	deferred_sharded_executor sut;
+
+	// Act
+	cpu_set_t cur_set;
+	CPU_ZERO( &cur_set );
+	ASSERT_EQ( 0, ::sched_getaffinity( 0, sizeof( cur_set ), &cur_set ) );
+
+	// Assert
+	EXPECT_EQ( static_cast<size_t>( CPU_COUNT( &cur_set ) ), sut.number_of_workers() );
+	for ( size_t core = 0; core < sut.number_of_workers(); core++ ) {
+		EXPECT_TRUE( CPU_ISSET( sut.cpu_of( core ), &cur_set ) );
+	}
+}
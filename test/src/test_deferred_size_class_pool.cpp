@@ -0,0 +1,146 @@
+/**
+ * @file test_deferred_size_class_pool.cpp
+ * @author PFA03027@nifty.com
+ * @brief deferred_size_class_poolのテスト
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <thread>
+#include <vector>
+
+#include "deferred_size_class_pool.hpp"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+struct big_functor {
+	void operator()( int* p_sum, int v )
+	{
+		*p_sum += v + buff_[0];
+	}
+	char buff_[256];
+};
+
+/**
+ * @brief テスト中だけ、deferred_applyのアロケータをプールに差し替える
+ */
+class pool_installer {
+public:
+	pool_installer( void )
+	  : old_allocator_( deferred_size_class_pool::install() )
+	{
+	}
+	~pool_installer()
+	{
+		set_deferred_apply_heap_allocator( old_allocator_ );
+	}
+
+private:
+	deferred_apply_heap_allocator old_allocator_;
+};
+
+}   // namespace
+
+TEST( Deferred_Size_Class_Pool, steady_churn_allocates_no_chunk )
+{
+	// Arrange
+	std::vector<void*> blocks;
+	for ( int i = 0; i < 100; i++ ) {
+		blocks.push_back( deferred_size_class_pool::allocate( 200 ) );
+	}
+	for ( auto p : blocks ) {
+		deferred_size_class_pool::deallocate( p, 200 );
+	}
+	blocks.clear();
+	size_t num_of_chunks = deferred_size_class_pool::number_of_chunks();
+
+	// Act
+	for ( int round = 0; round < 10; round++ ) {
+		for ( int i = 0; i < 100; i++ ) {
+			blocks.push_back( deferred_size_class_pool::allocate( 200 ) );
+		}
+		for ( auto p : blocks ) {
+			deferred_size_class_pool::deallocate( p, 200 );
+		}
+		blocks.clear();
+	}
+
+	// Assert
+	EXPECT_EQ( num_of_chunks, deferred_size_class_pool::number_of_chunks() );
+}
+
+TEST( Deferred_Size_Class_Pool, used_by_heap_fallback_of_deferred_apply )
+{
+	// Arrange
+	pool_installer installer;
+	int            sum = 0;
+
+	// Act
+	deferred_apply<void> sut( big_functor(), &sum, 1 );
+	deferred_apply<void> sut2( sut );
+	size_t               num_of_chunks = deferred_size_class_pool::number_of_chunks();
+	for ( int i = 0; i < 1000; i++ ) {
+		deferred_apply<void> tmp( sut );
+		tmp.apply();
+	}
+	sut.apply();
+	sut2.apply();
+
+	// Assert
+	EXPECT_EQ( deferred_apply_storage_mode::heap, sut.introspect().storage_mode );
+	EXPECT_EQ( 1002, sum );
+	EXPECT_EQ( num_of_chunks, deferred_size_class_pool::number_of_chunks() );
+}
+
+TEST( Deferred_Size_Class_Pool, destroy_after_uninstall )
+{
+	// Arrange
+	int                   sum = 0;
+	deferred_apply<void>* p_sut;
+	{
+		pool_installer installer;
+		p_sut = new deferred_apply<void>( big_functor(), &sum, 1 );
+	}
+
+	// Act
+	p_sut->apply();
+	delete p_sut;
+
+	// Assert
+	EXPECT_EQ( 1, sum );
+}
+
+TEST( Deferred_Size_Class_Pool, destroy_on_another_thread )
+{
+	// Arrange
+	pool_installer installer;
+	int            sum = 0;
+
+	// Act
+	size_t num_of_chunks_after_first_round = 0;
+	for ( int round = 0; round < 10; round++ ) {
+		std::vector<deferred_apply<void>> tasks;
+		for ( int i = 0; i < 200; i++ ) {
+			tasks.emplace_back( big_functor(), &sum, 1 );
+		}
+		std::thread consumer( [&tasks]() {
+			for ( auto& task : tasks ) {
+				task.apply();
+			}
+			tasks.clear();
+		} );
+		consumer.join();
+		if ( round == 0 ) {
+			num_of_chunks_after_first_round = deferred_size_class_pool::number_of_chunks();
+		}
+	}
+
+	// Assert
+	EXPECT_EQ( 2000, sum );
+	EXPECT_EQ( num_of_chunks_after_first_round, deferred_size_class_pool::number_of_chunks() );
+}
@@ -0,0 +1,177 @@
+/**
+ * @file test_deferred_strand.cpp
+ * @author PFA03027@nifty.com
+ * @brief deferred_strandのテスト
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "deferred_strand.hpp"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+/**
+ * @brief ストランドのタスクが並行に実行されていないことを検査する
+ */
+struct serial_checker {
+	serial_checker( void )
+	  : num_of_running_( 0 )
+	  , num_of_overlaps_( 0 )
+	  , log_()
+	{
+	}
+
+	void run( int v )
+	{
+		if ( num_of_running_.fetch_add( 1 ) != 0 ) {
+			num_of_overlaps_++;
+		}
+		log_.push_back( v );   // ストランドにより直列化されているため、ロックは不要
+		num_of_running_.fetch_sub( 1 );
+	}
+
+	std::atomic<int> num_of_running_;
+	std::atomic<int> num_of_overlaps_;
+	std::vector<int> log_;
+};
+
+void wait_until( const std::atomic<int>& count, int expected )
+{
+	while ( count.load() < expected ) {
+		std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+	}
+}
+
+}   // namespace
+
+TEST( Deferred_Strand, tasks_run_serially_in_order )
+{
+	// Arrange
+	deferred_priority_executor<1> ex( 4 );
+	deferred_strand<>             sut( ex, 8 );
+	serial_checker                checker;
+	std::atomic<int>              num_of_done( 0 );
+
+	// Act
+	for ( int i = 0; i < 1000; i++ ) {
+		sut.post( [&checker, &num_of_done, i]() {
+			checker.run( i );
+			num_of_done++;
+		} );
+	}
+	wait_until( num_of_done, 1000 );
+
+	// Assert
+	EXPECT_EQ( 0, checker.num_of_overlaps_.load() );
+	ASSERT_EQ( 1000, checker.log_.size() );
+	for ( int i = 0; i < 1000; i++ ) {
+		EXPECT_EQ( i, checker.log_[i] );
+	}
+}
+
+TEST( Deferred_Strand, concurrent_posts_are_serialized )
+{
+	// Arrange
+	deferred_priority_executor<1> ex( 4 );
+	deferred_strand<>             sut( ex );
+	serial_checker                checker;
+	std::atomic<int>              num_of_done( 0 );
+	std::vector<std::thread>      producers;
+
+	// Act
+	for ( int t = 0; t < 4; t++ ) {
+		producers.emplace_back( [&sut, &checker, &num_of_done]() {
+			for ( int i = 0; i < 500; i++ ) {
+				sut.post( [&checker, &num_of_done, i]() {
+					checker.run( i );
+					num_of_done++;
+				} );
+			}
+		} );
+	}
+	for ( auto& th : producers ) {
+		th.join();
+	}
+	wait_until( num_of_done, 2000 );
+
+	// Assert
+	EXPECT_EQ( 0, checker.num_of_overlaps_.load() );
+	EXPECT_EQ( 2000, checker.log_.size() );
+}
+
+TEST( Deferred_Strand, different_strands_run_in_parallel )
+{
+	// Arrange
+	deferred_priority_executor<1> ex( 2 );
+	deferred_strand<>             sut1( ex );
+	deferred_strand<>             sut2( ex );
+	std::atomic<int>              num_of_arrived( 0 );
+	std::atomic<int>              num_of_done( 0 );
+	auto                          rendezvous = [&num_of_arrived, &num_of_done]() {
+		// 2つのストランドが並行に実行されなければ、ここで待ち続ける
+		num_of_arrived++;
+		while ( num_of_arrived.load() < 2 ) {
+			std::this_thread::yield();
+		}
+		num_of_done++;
+	};
+
+	// Act
+	sut1.post( rendezvous );
+	sut2.post( rendezvous );
+	wait_until( num_of_done, 2 );
+
+	// Assert
+	EXPECT_EQ( 2, num_of_done.load() );
+}
+
+TEST( Deferred_Strand, running_in_this_thread )
+{
+	// Arrange
+	deferred_priority_executor<1> ex( 1 );
+	deferred_strand<>             sut( ex );
+	std::atomic<int>              num_of_done( 0 );
+	std::atomic<bool>             result( false );
+
+	// Act
+	sut.post( [&sut, &result, &num_of_done]() {
+		result = sut.running_in_this_thread();
+		num_of_done++;
+	} );
+	wait_until( num_of_done, 1 );
+
+	// Assert
+	EXPECT_TRUE( result.load() );
+	EXPECT_FALSE( sut.running_in_this_thread() );
+}
+
+TEST( Deferred_Strand, pending_tasks_run_after_strand_is_destroyed )
+{
+	// Arrange
+	deferred_priority_executor<1>      ex( 1 );
+	std::atomic<int>                   num_of_done( 0 );
+	std::unique_ptr<deferred_strand<>> up_sut( new deferred_strand<>( ex ) );
+
+	// Act
+	for ( int i = 0; i < 10; i++ ) {
+		up_sut->post( [&num_of_done]() {
+			num_of_done++;
+		} );
+	}
+	up_sut.reset();
+	wait_until( num_of_done, 10 );
+
+	// Assert
+	EXPECT_EQ( 10, num_of_done.load() );
+}
@@ -0,0 +1,224 @@
+/**
+ * @file test_deferred_task_graph.cpp
+ * @author PFA03027@nifty.com
+ * @brief deferred_task_graphのテスト
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "deferred_priority_executor.hpp"
+#include "deferred_task_graph.hpp"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+class order_log {
+public:
+	void record( std::string name )
+	{
+		std::lock_guard<std::mutex> lk( mtx_ );
+		names_.push_back( std::move( name ) );
+	}
+
+	size_t position_of( const std::string& name ) const
+	{
+		for ( size_t i = 0; i < names_.size(); i++ ) {
+			if ( names_[i] == name ) return i;
+		}
+		return names_.size();
+	}
+
+	std::mutex               mtx_;
+	std::vector<std::string> names_;
+};
+
+void record_name( order_log* p_log, std::string name )
+{
+	p_log->record( std::move( name ) );
+}
+
+void throw_runtime_error( void )
+{
+	throw std::runtime_error( "error in node" );
+}
+
+}   // namespace
+
+TEST( Deferred_Task_Graph, run_in_dependency_order )
+{
+	// Arrange
+	deferred_task_graph sut;
+	order_log           log;
+	size_t              a = sut.add_node( &record_name, &log, std::string( "a" ) );
+	size_t              b = sut.add_node( &record_name, &log, std::string( "b" ) );
+	size_t              c = sut.add_node( &record_name, &log, std::string( "c" ) );
+	size_t              d = sut.add_node( &record_name, &log, std::string( "d" ) );
+	sut.add_edge( a, b );
+	sut.add_edge( a, c );
+	sut.add_edge( b, d );
+	sut.add_edge( c, d );
+
+	// Act
+	sut.run();
+
+	// Assert
+	ASSERT_EQ( 4, log.names_.size() );
+	EXPECT_EQ( 0, log.position_of( "a" ) );
+	EXPECT_EQ( 3, log.position_of( "d" ) );
+}
+
+TEST( Deferred_Task_Graph, run_repeatedly_without_rebuilding )
+{
+	// Arrange
+	deferred_priority_executor<1> ex( 4 );
+	deferred_task_graph           sut;
+	std::atomic<int>              count( 0 );
+	auto                          f = [&count]( std::string s ) {
+		count += static_cast<int>( s.size() );
+	};
+	size_t root = sut.add_node( f, std::string( "x" ) );
+	for ( int i = 0; i < 10; i++ ) {
+		size_t child = sut.add_node( f, std::string( "x" ) );
+		sut.add_edge( root, child );
+	}
+
+	// Act
+	sut.run( ex );
+	sut.run( ex );
+	sut.run( ex );
+
+	// Assert
+	EXPECT_EQ( 33, count.load() );
+}
+
+TEST( Deferred_Task_Graph, cyclic_dependency_throws )
+{
+	// Arrange
+	deferred_task_graph sut;
+	int                 count = 0;
+	auto                f     = [&count]() {
+		count++;
+	};
+	size_t a = sut.add_node( f );
+	size_t b = sut.add_node( f );
+	sut.add_edge( a, b );
+	sut.add_edge( b, a );
+
+	// Act
+	// Assert
+	EXPECT_THROW( sut.run(), deferred_task_graph::cyclic_dependency );
+	EXPECT_EQ( 0, count );
+	EXPECT_THROW( sut.add_edge( a, 2 ), deferred_task_graph::bad_node_id );
+}
+
+TEST( Deferred_Task_Graph, exception_skips_successors )
+{
+	// Arrange
+	deferred_task_graph sut;
+	order_log           log;
+	size_t              a = sut.add_node( &throw_runtime_error );
+	size_t              b = sut.add_node( &record_name, &log, std::string( "b" ) );
+	sut.add_edge( a, b );
+
+	// Act
+	// Assert
+	EXPECT_THROW( sut.run(), std::runtime_error );
+	EXPECT_EQ( 0, log.names_.size() );
+}
+
+TEST( Deferred_Task_Graph, run_from_worker_of_the_same_executor )
+{
+	// Arrange
+	deferred_priority_executor<1> ex( 1 );   // ワーカーが1つだけのため、run()の呼び出し元が実行しなければ完了しない
+	deferred_task_graph           sut;
+	std::atomic<int>              count( 0 );
+	auto                          f = [&count]() {
+		count++;
+	};
+	size_t root = sut.add_node( f );
+	for ( int i = 0; i < 8; i++ ) {
+		sut.add_edge( root, sut.add_node( f ) );
+	}
+	std::atomic<bool> is_done( false );
+
+	// Act
+	ex.post( deferred_apply<void>( [&sut, &ex, &is_done]() {
+		sut.run( ex );
+		is_done.store( true );
+	} ) );
+	ex.shutdown();
+
+	// Assert
+	EXPECT_TRUE( is_done.load() );
+	EXPECT_EQ( 9, count.load() );
+}
+
+TEST( Deferred_Task_Graph, graph_can_be_destroyed_right_after_run )
+{
+	// Arrange
+	deferred_priority_executor<1> ex( 4 );
+	std::atomic<int>              count( 0 );
+	auto                          f = [&count]() {
+		count++;
+	};
+
+	// Act
+	for ( int i = 0; i < 200; i++ ) {
+		std::unique_ptr<deferred_task_graph> up_sut( new deferred_task_graph );
+		size_t                               root = up_sut->add_node( f );
+		size_t                               last = up_sut->add_node( f );
+		for ( int j = 0; j < 4; j++ ) {
+			size_t mid = up_sut->add_node( f );
+			up_sut->add_edge( root, mid );
+			up_sut->add_edge( mid, last );
+		}
+		up_sut->run( ex );
+		up_sut.reset();   // 最後のノードを実行したワーカーが、破棄後のグラフを参照しないこと
+	}
+	ex.shutdown();
+
+	// Assert
+	EXPECT_EQ( 200 * 6, count.load() );
+}
+
+TEST( Deferred_Task_Graph, graph_can_be_destroyed_while_posted_node_is_finishing )
+{
+	// Arrange
+	deferred_priority_executor<1> ex( 1 );
+	std::atomic<int>              num_of_posted_done( 0 );
+
+	// Act
+	for ( int i = 0; i < 2000; i++ ) {
+		// 呼び出し元が実行する最初のルートノードは、投入したルートノードのタスクの完了を待ってから完了する。
+		// そのため、投入したノードの完了処理の途中で、run()が戻りグラフが破棄される
+		std::atomic<bool>                    is_posted_applied( false );
+		std::unique_ptr<deferred_task_graph> up_sut( new deferred_task_graph );
+		up_sut->add_node( [&is_posted_applied]() {
+			while ( !is_posted_applied.load() ) {
+				std::this_thread::yield();
+			}
+		} );
+		up_sut->add_node( [&is_posted_applied, &num_of_posted_done]() {
+			num_of_posted_done++;
+			is_posted_applied.store( true );
+		} );
+		up_sut->run( ex );
+		up_sut.reset();
+	}
+	ex.shutdown();
+
+	// Assert
+	EXPECT_EQ( 2000, num_of_posted_done.load() );
+}
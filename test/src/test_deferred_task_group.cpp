@@ -0,0 +1,107 @@
+/**
+ * @file test_deferred_task_group.cpp
+ * @author PFA03027@nifty.com
+ * @brief deferred_task_groupのテスト
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "deferred_task_group.hpp"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+void store_twice( int v, int* p_out )
+{
+	*p_out = v * 2;
+}
+
+void throw_runtime_error( void )
+{
+	throw std::runtime_error( "error in task" );
+}
+
+}   // namespace
+
+TEST( Deferred_Task_Group, run_and_wait_all_tasks )
+{
+	// Arrange
+	deferred_task_group<> sut;
+	std::vector<int>      results( 16, -1 );
+
+	// Act
+	for ( int i = 0; i < 16; i++ ) {
+		sut.run( &store_twice, static_cast<int>( i ), &results[i] );
+	}
+	sut.wait();
+
+	// Assert
+	for ( int i = 0; i < 16; i++ ) {
+		EXPECT_EQ( i * 2, results[i] );
+	}
+}
+
+TEST( Deferred_Task_Group, waiter_helps_without_workers )
+{
+	// Arrange
+	deferred_priority_executor<1> ex( 0 );   // ワーカースレッドがないため、待機するスレッドがすべて実行する
+	deferred_task_group<>         sut( ex );
+	int                           result = 0;
+
+	// Act
+	sut.run( &store_twice, 21, &result );
+	sut.wait();
+
+	// Assert
+	EXPECT_EQ( 42, result );
+}
+
+TEST( Deferred_Task_Group, exception_propagates_to_waiter )
+{
+	// Arrange
+	deferred_task_group<> sut;
+	std::atomic<int>      count( 0 );
+
+	// Act
+	sut.run( &throw_runtime_error );
+	for ( int i = 0; i < 8; i++ ) {
+		sut.run( [&count]() {
+			count++;
+		} );
+	}
+
+	// Assert
+	EXPECT_THROW( sut.wait(), std::runtime_error );
+	EXPECT_EQ( 8, count.load() );
+	EXPECT_NO_THROW( sut.wait() );
+}
+
+TEST( Deferred_Task_Group, reuse_after_wait_with_move_only_argument )
+{
+	// Arrange
+	deferred_task_group<> sut;
+	std::atomic<int>      sum( 0 );
+	auto                  f = [&sum]( std::unique_ptr<int> up ) {
+		sum += *up;
+	};
+
+	// Act
+	for ( int round = 0; round < 3; round++ ) {
+		for ( int i = 0; i < 20; i++ ) {
+			sut.run( f, std::unique_ptr<int>( new int( 1 ) ) );
+		}
+		sut.wait();
+	}
+
+	// Assert
+	EXPECT_EQ( 60, sum.load() );
+}
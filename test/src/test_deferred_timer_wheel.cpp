@@ -0,0 +1,222 @@
+/**
+ * @file test_deferred_timer_wheel.cpp
+ * @author PFA03027@nifty.com
+ * @brief deferred_timer_wheelのテスト
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "deferred_timer_wheel.hpp"
+
+#include "gtest/gtest.h"
+
+namespace {
+
+/**
+ * @brief 実際にsleepせずに時刻を進めるための偽のクロック
+ */
+struct fake_clock {
+	using rep                       = int64_t;
+	using period                    = std::milli;
+	using duration                  = std::chrono::duration<rep, period>;
+	using time_point                = std::chrono::time_point<fake_clock>;
+	static constexpr bool is_steady = true;
+
+	static time_point now( void )
+	{
+		return current_;
+	}
+
+	static void advance( duration d )
+	{
+		current_ += d;
+	}
+
+	static time_point current_;
+};
+
+fake_clock::time_point fake_clock::current_ = fake_clock::time_point( fake_clock::duration( 1000 ) );
+
+void push_value( std::vector<int>& v, int x )
+{
+	v.push_back( x );
+}
+
+}   // namespace
+
+TEST( Deferred_Timer_Wheel, execute_at_expiry )
+{
+	// Arrange
+	deferred_timer_wheel<fake_clock> sut( fake_clock::duration( 1 ) );
+	std::vector<int>                 result;
+	sut.schedule_after( fake_clock::duration( 10 ), &push_value, std::ref( result ), 10 );
+	sut.schedule_after( fake_clock::duration( 5 ), &push_value, std::ref( result ), 5 );
+	EXPECT_EQ( 2, sut.size() );
+
+	// Act
+	fake_clock::advance( fake_clock::duration( 4 ) );
+	size_t ret1 = sut.tick();
+	fake_clock::advance( fake_clock::duration( 1 ) );
+	size_t ret2 = sut.tick();
+	fake_clock::advance( fake_clock::duration( 5 ) );
+	size_t ret3 = sut.tick();
+
+	// Assert
+	EXPECT_EQ( 0, ret1 );
+	EXPECT_EQ( 1, ret2 );
+	EXPECT_EQ( 1, ret3 );
+	ASSERT_EQ( 2, result.size() );
+	EXPECT_EQ( 5, result[0] );
+	EXPECT_EQ( 10, result[1] );
+	EXPECT_TRUE( sut.empty() );
+}
+
+TEST( Deferred_Timer_Wheel, cancel )
+{
+	// Arrange
+	deferred_timer_wheel<fake_clock> sut( fake_clock::duration( 1 ) );
+	std::vector<int>                 result;
+	auto                             h1 = sut.schedule_after( fake_clock::duration( 3 ), &push_value, std::ref( result ), 1 );
+	auto                             h2 = sut.schedule_after( fake_clock::duration( 3 ), &push_value, std::ref( result ), 2 );
+
+	// Act
+	bool ret1 = sut.cancel( h1 );
+	bool ret2 = sut.cancel( h1 );
+	fake_clock::advance( fake_clock::duration( 3 ) );
+	sut.tick();
+	bool ret3 = sut.cancel( h2 );
+
+	// Assert
+	EXPECT_TRUE( ret1 );
+	EXPECT_FALSE( ret2 );
+	EXPECT_FALSE( ret3 );
+	ASSERT_EQ( 1, result.size() );
+	EXPECT_EQ( 2, result[0] );
+	EXPECT_FALSE( sut.cancel( decltype( sut )::timer_handle() ) );
+}
+
+TEST( Deferred_Timer_Wheel, cascade_over_levels )
+{
+	// Arrange
+	auto                             origin = fake_clock::now();
+	deferred_timer_wheel<fake_clock> sut( fake_clock::duration( 1 ), origin );
+	std::vector<int>                 result;
+	const int                        delays[] = { 1, 255, 256, 257, 300, 65535, 65536, 65537, 70000, 16777217 };
+	for ( int d : delays ) {
+		sut.schedule_at( origin + fake_clock::duration( d ), &push_value, std::ref( result ), static_cast<int>( d ) );   // dはループ変数のため、参照ではなく値として保持させる
+	}
+
+	// Act
+	// Assert
+	for ( int d : delays ) {
+		EXPECT_EQ( 0, sut.run_until( origin + fake_clock::duration( d - 1 ) ) );
+		EXPECT_EQ( 1, sut.run_until( origin + fake_clock::duration( d ) ) );
+		ASSERT_FALSE( result.empty() );
+		EXPECT_EQ( d, result.back() );
+	}
+	EXPECT_TRUE( sut.empty() );
+}
+
+TEST( Deferred_Timer_Wheel, schedule_from_unaligned_tick_crosses_slot_boundary )
+{
+	// Arrange
+	auto                             origin = fake_clock::now();
+	deferred_timer_wheel<fake_clock> sut( fake_clock::duration( 1 ), origin );
+	std::vector<int>                 result;
+	sut.run_until( origin + fake_clock::duration( 200 ) );   // スロット数の境界に揃っていないtickから登録する
+	const int expiries[] = { 300, 65600, 65836, 16777500 };
+	for ( int e : expiries ) {
+		sut.schedule_at( origin + fake_clock::duration( e ), &push_value, std::ref( result ), static_cast<int>( e ) );
+	}
+
+	// Act
+	size_t ret1 = sut.run_until( origin + fake_clock::duration( 1000 ) );
+	size_t ret2 = sut.run_until( origin + fake_clock::duration( 100000 ) );
+	size_t ret3 = sut.run_until( origin + fake_clock::duration( 20000000 ) );
+
+	// Assert
+	EXPECT_EQ( 1, ret1 );
+	EXPECT_EQ( 2, ret2 );
+	EXPECT_EQ( 1, ret3 );
+	ASSERT_EQ( 4, result.size() );
+	for ( size_t i = 0; i < 4; i++ ) {
+		EXPECT_EQ( expiries[i], result[i] );
+	}
+	EXPECT_TRUE( sut.empty() );
+}
+
+TEST( Deferred_Timer_Wheel, overflow_beyond_top_level )
+{
+	// Arrange
+	auto                             origin = fake_clock::now();
+	deferred_timer_wheel<fake_clock> sut( fake_clock::duration( 1 ), origin );
+	std::vector<int>                 result;
+	const int64_t                    far    = ( static_cast<int64_t>( 1 ) << 32 ) + 5;
+	sut.schedule_at( origin + fake_clock::duration( far ), &push_value, std::ref( result ), 1 );
+	sut.schedule_at( origin + fake_clock::duration( 1 ), &push_value, std::ref( result ), 0 );
+	sut.run_until( origin + fake_clock::duration( 1 ) );
+
+	// Act
+	size_t ret1 = sut.run_until( origin + fake_clock::duration( far - 1 ) );
+	size_t ret2 = sut.run_until( origin + fake_clock::duration( far ) );
+
+	// Assert
+	EXPECT_EQ( 0, ret1 );
+	EXPECT_EQ( 1, ret2 );
+	ASSERT_EQ( 2, result.size() );
+	EXPECT_EQ( 1, result[1] );
+}
+
+TEST( Deferred_Timer_Wheel, schedule_from_task )
+{
+	// Arrange
+	struct local {
+		static void reschedule( deferred_timer_wheel<fake_clock>& tw, int& counter )
+		{
+			counter++;
+			if ( counter < 3 ) {
+				tw.schedule_after( fake_clock::duration( 2 ), &local::reschedule, std::ref( tw ), std::ref( counter ) );
+			}
+		}
+	};
+	deferred_timer_wheel<fake_clock> sut( fake_clock::duration( 1 ) );
+	int                              counter = 0;
+	sut.schedule_after( fake_clock::duration( 2 ), &local::reschedule, std::ref( sut ), std::ref( counter ) );
+
+	// Act
+	for ( int i = 0; i < 10; i++ ) {
+		fake_clock::advance( fake_clock::duration( 1 ) );
+		sut.tick();
+	}
+
+	// Assert
+	EXPECT_EQ( 3, counter );
+	EXPECT_TRUE( sut.empty() );
+}
+
+TEST( Deferred_Timer_Wheel, past_deadline_runs_on_next_tick )
+{
+	// Arrange
+	deferred_timer_wheel<fake_clock> sut( fake_clock::duration( 10 ) );
+	std::vector<int>                 result;
+	fake_clock::advance( fake_clock::duration( 100 ) );
+	sut.tick();
+
+	// Act
+	sut.schedule_at( fake_clock::now() - fake_clock::duration( 50 ), &push_value, std::ref( result ), 1 );
+	size_t ret1 = sut.tick();
+	fake_clock::advance( fake_clock::duration( 10 ) );
+	size_t ret2 = sut.tick();
+
+	// Assert
+	EXPECT_EQ( 0, ret1 );
+	EXPECT_EQ( 1, ret2 );
+	EXPECT_EQ( 1, result.size() );
+}
@@ -0,0 +1,127 @@
+/**
+ * @file test_deferred_apply_no_exceptions.cpp
+ * @author PFA03027@nifty.com
+ * @brief -fno-exceptionsでビルドした場合のdeferred_applyのテスト
+ * @version 0.1
+ * @date 2026-10-18
+ *
+ * @copyright Copyright (c) 2023
+ *
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+#include "deferred_apply.hpp"
+#include "deferred_apply_batch.hpp"
+#include "deferred_coalescing_queue.hpp"
+#include "deferred_timer_wheel.hpp"
+
+#include "gtest/gtest.h"
+
+static_assert( DEFERRED_APPLY_HAS_EXCEPTIONS == 0, "this test should be built with -fno-exceptions" );
+
+namespace {
+
+int add( int a, int b ) noexcept
+{
+	return a + b;
+}
+
+int add_may_throw( int a, int b )
+{
+	return a + b;
+}
+
+void move_only_func( std::unique_ptr<int> )
+{
+}
+
+void test_error_handler( const char* p_what )
+{
+	fprintf( stderr, "test_error_handler: %s\n", p_what );
+	std::abort();
+}
+
+}   // namespace
+
+TEST( Deferred_Apply_No_Exceptions, apply )
+{
+	// Arrange
+	auto sut = make_deferred_apply( &add, 1, 2 );
+
+	// Act
+	auto sut2 = sut;
+
+	// Assert
+	EXPECT_EQ( 3, sut.apply() );
+	EXPECT_EQ( 3, sut2.apply() );
+}
+
+TEST( Deferred_Apply_No_Exceptions, noexcept_apply_of_arguments )
+{
+	// Arrange
+	auto sut = make_deferred_applying_arguments( 1, 2 );
+
+	// Act
+	// Assert
+	static_assert( noexcept( sut.apply( add ) ), "apply() should be noexcept when f is noexcept" );
+	static_assert( !noexcept( sut.apply( add_may_throw ) ), "apply() should not be noexcept when f is not noexcept" );
+	EXPECT_EQ( 3, sut.apply( add ) );
+}
+
+TEST( Deferred_Apply_No_Exceptions, noexcept_signature )
+{
+	// Arrange
+	deferred_apply<int() noexcept> sut( &add, 1, 2 );
+
+	// Act
+	int ret = sut.apply();
+
+	// Assert
+	static_assert( deferred_apply<int() noexcept>::is_nothrow_apply, "apply() should be noexcept" );
+	static_assert( noexcept( sut.apply() ), "apply() should be noexcept" );
+	static_assert( !deferred_apply<int()>::is_nothrow_apply, "apply() should not be noexcept" );
+	EXPECT_EQ( 3, ret );
+	// deferred_apply<int() noexcept> sut2( &add_may_throw, 1, 2 );   // static_assert failure
+}
+
+TEST( Deferred_Apply_No_Exceptions_DeathTest, copy_of_move_only_calls_error_handler )
+{
+	// Arrange
+	deferred_apply<void> sut( &move_only_func, std::unique_ptr<int>( new int( 1 ) ) );
+	auto                 old_handler = set_deferred_apply_error_handler( &test_error_handler );
+
+	// Act
+	// Assert
+	EXPECT_DEATH( { deferred_apply<void> sut2( sut ); }, "test_error_handler: there is no copy constructor" );
+	set_deferred_apply_error_handler( old_handler );
+}
+
+TEST( Deferred_Apply_No_Exceptions_DeathTest, copy_of_move_only_aborts_without_handler )
+{
+	// Arrange
+	deferred_apply<void> sut( &move_only_func, std::unique_ptr<int>( new int( 1 ) ) );
+
+	// Act
+	// Assert
+	EXPECT_DEATH( { deferred_apply<void> sut2( sut ); }, "" );
+}
+
+TEST( Deferred_Apply_No_Exceptions, batch_and_queue )
+{
+	// Arrange
+	int                            out = 0;
+	deferred_apply_batch           batch;
+	deferred_coalescing_queue<int> q;
+	batch.push( []( int* p_out, int v ) { *p_out += v; }, &out, 1 );
+	q.push( 1, []( int* p_out, int v ) { *p_out += v; }, &out, 10 );
+
+	// Act
+	batch.drain();
+	q.run_all();
+
+	// Assert
+	EXPECT_EQ( 11, out );
+}